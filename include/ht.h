@@ -10,6 +10,7 @@
 #define __HT_H__
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -22,50 +23,140 @@ typedef struct ht_strdouble ht_strdouble_t;
 typedef struct ht_strfloat ht_strfloat_t;
 typedef struct ht_strint ht_strint_t;
 typedef struct ht_strstr ht_strstr_t;
+typedef struct ht_concurrent ht_concurrent_t;
+typedef struct ht_concurrent_enum ht_concurrent_enum_t;
+typedef struct ht_rcu ht_rcu_t;
+typedef struct ht_rcu_reader ht_rcu_reader_t;
+typedef struct ht_mmap ht_mmap_t;
 
 typedef enum {
     HT_STR_NONE = 0,
     HT_STR_CASECMP,
     HT_SEED_RANDOM,
+    HT_ENGINE_SWISS = 4,
+    HT_ENGINE_ROBINHOOD = 8,
+    HT_REHASH_INCREMENTAL = 16,
+    HT_STR_PACKED = 32,
+    HT_STR_ARENA = 64,
+    HT_HASH_WYHASH = 128,
+    HT_STR_INLINE = 256,
 } ht_flags_enum_t;
 
+// Flags of ht_insert_many
+typedef enum {
+    HT_INSERT_NONE = 0,
+    HT_INSERT_UNIQUE, // Keys are new to the table and to each other
+} ht_insert_flags_enum_t;
+
 #if defined(CPU_32_BIT)
+typedef uint32_t ht_hashval_t;
 typedef uint32_t (*ht_hash)(const void *, uint32_t);
+typedef uint32_t (*ht_hash_n)(const void *, size_t, uint32_t);
 #else
+typedef uint64_t ht_hashval_t;
 typedef uint64_t (*ht_hash)(const void *, uint64_t);
+typedef uint64_t (*ht_hash_n)(const void *, size_t, uint64_t);
 #endif
 typedef bool (*ht_keyeq)(const void *, const void *);
+typedef bool (*ht_keyeq_n)(const void *, size_t, const void *, size_t);
+typedef int (*ht_keycmp)(const void *, const void *);
+typedef int (*ht_keycmp_n)(const void *, size_t, const void *, size_t);
 typedef void *(*ht_kcopy)(const void *);
 typedef void (*ht_kfree)(const void *);
 typedef void *(*ht_vcopy)(const void *);
 typedef void (*ht_vfree)(const void *);
+typedef void *(*ht_pcopy)(const void *, const void *, const void **);
+typedef void (*ht_visit)(const void *, void *);
 
+// Optional pair_copy copies a key and it's value into one allocation, returns
+// the key and stores the value through it's last argument. key_free then
+// releases both, val_copy and val_free are not used.
 typedef struct {
     ht_kcopy key_copy;
     ht_kfree key_free;
     ht_vcopy val_copy;
     ht_vfree val_free;
+    ht_pcopy pair_copy;
 } ht_callbacks_t;
 
+// Sizing policy of a table, fields left 0 keep the engine's defaults. Tables
+// grow by growth_factor, between 1 and 4, once their load reaches
+// max_load_factor, up to 4, and never past max_capacity buckets. Swiss and
+// Robin Hood tables round capacities to powers of two, growth to 2 or 4 and
+// cap their load at 7/8.
+// Every engine holds at most max_load_factor * max_capacity keys. Inserting a
+// new key into a table full at max_capacity fails and returns false, values
+// of keys already in it are still replaced.
+typedef struct {
+    double max_load_factor;
+    double growth_factor;
+    size_t initial_capacity;
+    size_t max_capacity;
+} ht_options_t;
+
 #if defined(CPU_32_BIT)
 #define FNV1A_PRIME (0x01000193)  // 16777619 (32 bit)
 #define FNV1A_OFFSET (0x811C9DC5) // 2166136261 (32 bit)
 uint32_t fnv1a_hash_str(const void *, uint32_t);
 uint32_t fnv1a_hash_str_casecmp(const void *, uint32_t);
+uint32_t fnv1a_hash_str_n(const void *, size_t, uint32_t);
+uint32_t fnv1a_hash_str_casecmp_n(const void *, size_t, uint32_t);
+uint32_t wy_hash_str(const void *, uint32_t);
+uint32_t wy_hash_str_casecmp(const void *, uint32_t);
+uint32_t wy_hash_str_n(const void *, size_t, uint32_t);
+uint32_t wy_hash_str_casecmp_n(const void *, size_t, uint32_t);
+uint32_t sip_hash_str(const void *, uint32_t);
+uint32_t sip_hash_str_casecmp(const void *, uint32_t);
+uint32_t sip_hash_str_n(const void *, size_t, uint32_t);
+uint32_t sip_hash_str_casecmp_n(const void *, size_t, uint32_t);
 #else
 #define FNV1A_PRIME (0x00000100000001B3)  // 1099511628211 (64 bit)
 #define FNV1A_OFFSET (0xCBF29CE484222325) // 14695981039346656037 (64 bit)
 uint64_t fnv1a_hash_str(const void *, uint64_t);
 uint64_t fnv1a_hash_str_casecmp(const void *, uint64_t);
+uint64_t fnv1a_hash_str_n(const void *, size_t, uint64_t);
+uint64_t fnv1a_hash_str_casecmp_n(const void *, size_t, uint64_t);
+uint64_t wy_hash_str(const void *, uint64_t);
+uint64_t wy_hash_str_casecmp(const void *, uint64_t);
+uint64_t wy_hash_str_n(const void *, size_t, uint64_t);
+uint64_t wy_hash_str_casecmp_n(const void *, size_t, uint64_t);
+uint64_t sip_hash_str(const void *, uint64_t);
+uint64_t sip_hash_str_casecmp(const void *, uint64_t);
+uint64_t sip_hash_str_n(const void *, size_t, uint64_t);
+uint64_t sip_hash_str_casecmp_n(const void *, size_t, uint64_t);
 #endif
 
-// String key equality functinos
+// String key equality and ordering functinos
 bool str_eq(const void *, const void *);
 bool str_caseeq(const void *, const void *);
+bool str_eq_n(const void *, size_t, const void *, size_t);
+bool str_caseeq_n(const void *, size_t, const void *, size_t);
+int str_cmp(const void *, const void *);
+int str_casecmp(const void *, const void *);
+int str_cmp_n(const void *, size_t, const void *, size_t);
+int str_casecmp_n(const void *, size_t, const void *, size_t);
+
+// Length prefixed string keys, each one allocation holding the key's length
+// and bytes, and for str_pack_pairdup it's string value too. Packing saves the
+// value's allocation and lets lookups compare lengths first. HT_STR_INLINE
+// tables keep short keys packed in their slots, and HT_STR_ARENA tables do
+// without an allocation per key.
+void *str_pack_dup(const void *);
+void *str_pack_pairdup(const void *, const void *, const void **);
+void str_pack_free(const void *);
+size_t str_pack_len(const void *);
 
 // Creation and destruction
 ht_t *ht_create(const ht_hash, const ht_keyeq, const ht_callbacks_t *,
                 const unsigned int);
+ht_t *ht_create_n(const ht_hash_n, const ht_keyeq_n, const ht_callbacks_t *,
+                  const unsigned int);
+ht_t *ht_create_with_capacity(const ht_hash, const ht_keyeq,
+                              const ht_callbacks_t *, const unsigned int,
+                              size_t);
+ht_t *ht_create_with_options(const ht_hash, const ht_keyeq,
+                             const ht_callbacks_t *, const unsigned int,
+                             const ht_options_t *);
 void ht_destroy(ht_t *);
 ht_strdouble_t *ht_strdouble_create(unsigned int);
 void ht_strdouble_destroy(ht_strdouble_t *);
@@ -76,24 +167,102 @@ void ht_strint_destroy(ht_strint_t *);
 ht_strstr_t *ht_strstr_create(unsigned int);
 void ht_strstr_destroy(ht_strstr_t *);
 
+// Tuning
+bool ht_set_options(ht_t *, const ht_options_t *);
+void ht_get_options(const ht_t *, ht_options_t *);
+size_t ht_capacity(const ht_t *);
+bool ht_strdouble_set_options(ht_strdouble_t *, const ht_options_t *);
+bool ht_strfloat_set_options(ht_strfloat_t *, const ht_options_t *);
+bool ht_strint_set_options(ht_strint_t *, const ht_options_t *);
+bool ht_strstr_set_options(ht_strstr_t *, const ht_options_t *);
+bool ht_reserve(ht_t *, size_t);
+bool ht_strdouble_reserve(ht_strdouble_t *, size_t);
+bool ht_strfloat_reserve(ht_strfloat_t *, size_t);
+bool ht_strint_reserve(ht_strint_t *, size_t);
+bool ht_strstr_reserve(ht_strstr_t *, size_t);
+bool ht_shrink_to_fit(ht_t *);
+bool ht_strdouble_shrink_to_fit(ht_strdouble_t *);
+bool ht_strfloat_shrink_to_fit(ht_strfloat_t *);
+bool ht_strint_shrink_to_fit(ht_strint_t *);
+bool ht_strstr_shrink_to_fit(ht_strstr_t *);
+void ht_set_rehash_step(ht_t *, size_t);
+void ht_set_resize_threads(ht_t *, size_t);
+void ht_pool_stats(const ht_t *, size_t *, size_t *);
+bool ht_set_inline_val(ht_t *, size_t);
+bool ht_set_inline_keys(ht_t *);
+bool ht_set_str_arena(ht_t *, bool);
+bool ht_set_keycmp(ht_t *, ht_keycmp);
+bool ht_set_keycmp_n(ht_t *, ht_keycmp_n);
+bool ht_arena_compact(ht_t *);
+void ht_arena_stats(const ht_t *, size_t *, size_t *);
+bool ht_strdouble_compact(ht_strdouble_t *);
+bool ht_strfloat_compact(ht_strfloat_t *);
+bool ht_strint_compact(ht_strint_t *);
+bool ht_strstr_compact(ht_strstr_t *);
+
 // Insertion and removal
-void ht_insert(ht_t *, const void *, const void *);
+bool ht_insert(ht_t *, const void *, const void *);
 void ht_remove(ht_t *, const void *);
-void ht_strdouble_insert(ht_strdouble_t *, const char *, const double *);
+bool ht_insert_n(ht_t *, const void *, size_t, const void *);
+void ht_remove_n(ht_t *, const void *, size_t);
+size_t ht_insert_many(ht_t *, const void *const *, const void *const *,
+                      size_t, unsigned int);
+void **ht_get_or_insert(ht_t *, const void *, bool *);
+bool ht_insert_take(ht_t *, void *, void *);
+bool ht_remove_take(ht_t *, const void *, void **, void **);
+void *ht_take(ht_t *, const void *);
+bool ht_strdouble_insert(ht_strdouble_t *, const char *, const double *);
 void ht_strdouble_remove(ht_strdouble_t *, const char *);
-void ht_strfloat_insert(ht_strfloat_t *, const char *, const float *);
+bool ht_strfloat_insert(ht_strfloat_t *, const char *, const float *);
 void ht_strfloat_remove(ht_strfloat_t *, const char *);
-void ht_strint_insert(ht_strint_t *, const char *, const int *);
+bool ht_strint_insert(ht_strint_t *, const char *, const int *);
 void ht_strint_remove(ht_strint_t *, const char *);
-void ht_strstr_insert(ht_strstr_t *, const char *, const char *);
+bool ht_strstr_insert(ht_strstr_t *, const char *, const char *);
 void ht_strstr_remove(ht_strstr_t *, const char *);
+bool ht_strstr_insert_n(ht_strstr_t *, const char *, size_t, const char *);
+void ht_strstr_remove_n(ht_strstr_t *, const char *, size_t);
+size_t ht_strint_insert_many(ht_strint_t *, const char *const *,
+                             const int *, size_t, unsigned int);
+double ht_strdouble_add(ht_strdouble_t *, const char *, double);
+int ht_strint_add(ht_strint_t *, const char *, int);
+size_t ht_strstr_insert_many(ht_strstr_t *, const char *const *,
+                             const char *const *, size_t, unsigned int);
+bool ht_strstr_insert_take(ht_strstr_t *, char *, char *);
+char *ht_strstr_take(ht_strstr_t *, const char *);
 
 // Getting
 void *ht_get(const ht_t *, const void *);
+void *ht_get_n(const ht_t *, const void *, size_t);
+size_t ht_get_many(const ht_t *, const void *const *, size_t, void **);
 void *ht_strdouble_get(ht_strdouble_t *, const char *);
 void *ht_strfloat_get(ht_strfloat_t *, const char *);
 void *ht_strint_get(ht_strint_t *, const char *);
+bool ht_strdouble_get_val(ht_strdouble_t *, const char *, double *);
+bool ht_strfloat_get_val(ht_strfloat_t *, const char *, float *);
+bool ht_strint_get_val(ht_strint_t *, const char *, int *);
 const char *ht_strstr_get(ht_strstr_t *, const char *);
+const char *ht_strstr_get_n(ht_strstr_t *, const char *, size_t);
+size_t ht_strdouble_get_many(ht_strdouble_t *, const char *const *, size_t,
+                             void **);
+size_t ht_strfloat_get_many(ht_strfloat_t *, const char *const *, size_t,
+                            void **);
+size_t ht_strint_get_many(ht_strint_t *, const char *const *, size_t,
+                          void **);
+size_t ht_strstr_get_many(ht_strstr_t *, const char *const *, size_t,
+                          const char **);
+
+// Prehashed keys, one hash serving every table hashing alike
+ht_hashval_t ht_hash_key(const ht_t *, const void *);
+bool ht_share_seed(ht_t *, const ht_t *);
+bool ht_insert_hashed(ht_t *, const void *, ht_hashval_t, const void *);
+void ht_remove_hashed(ht_t *, const void *, ht_hashval_t);
+void *ht_get_hashed(const ht_t *, const void *, ht_hashval_t);
+ht_hashval_t ht_strstr_hash_key(ht_strstr_t *, const char *);
+bool ht_strstr_share_seed(ht_strstr_t *, ht_strstr_t *);
+bool ht_strstr_insert_hashed(ht_strstr_t *, const char *, ht_hashval_t,
+                             const char *);
+void ht_strstr_remove_hashed(ht_strstr_t *, const char *, ht_hashval_t);
+const char *ht_strstr_get_hashed(ht_strstr_t *, const char *, ht_hashval_t);
 
 // Enumeration
 ht_enum_t *ht_enum_create(ht_t *);
@@ -112,6 +281,51 @@ ht_enum_t *ht_strstr_enum_create(ht_strstr_t *);
 bool ht_strstr_enum_next(ht_enum_t *, const char **, const char **);
 void ht_strstr_enum_destroy(ht_enum_t *);
 
+// Concurrent tables
+ht_concurrent_t *ht_concurrent_create(const ht_hash, const ht_keyeq,
+                                      const ht_callbacks_t *,
+                                      const unsigned int, size_t);
+void ht_concurrent_destroy(ht_concurrent_t *);
+size_t ht_concurrent_shards(const ht_concurrent_t *);
+bool ht_concurrent_insert(ht_concurrent_t *, const void *, const void *);
+void ht_concurrent_remove(ht_concurrent_t *, const void *);
+void *ht_concurrent_get(ht_concurrent_t *, const void *);
+bool ht_concurrent_get_with(ht_concurrent_t *, const void *, ht_visit,
+                            void *);
+ht_concurrent_enum_t *ht_concurrent_enum_create(ht_concurrent_t *);
+ht_concurrent_enum_t *ht_concurrent_shard_enum_create(ht_concurrent_t *,
+                                                      size_t);
+bool ht_concurrent_enum_next(ht_concurrent_enum_t *, const void **,
+                             const void **);
+void ht_concurrent_enum_destroy(ht_concurrent_enum_t *);
+
+// Read mostly tables with lock free readers
+ht_rcu_t *ht_rcu_create(const ht_hash, const ht_keyeq, const ht_callbacks_t *,
+                        const unsigned int);
+void ht_rcu_destroy(ht_rcu_t *);
+bool ht_rcu_insert(ht_rcu_t *, const void *, const void *);
+void ht_rcu_remove(ht_rcu_t *, const void *);
+void ht_rcu_synchronize(ht_rcu_t *);
+ht_rcu_reader_t *ht_rcu_reader_create(ht_rcu_t *);
+void ht_rcu_reader_destroy(ht_rcu_reader_t *);
+void ht_rcu_read_lock(ht_rcu_reader_t *);
+void ht_rcu_read_unlock(ht_rcu_reader_t *);
+void *ht_rcu_get(ht_rcu_reader_t *, const void *);
+
+// Snapshots looked up in place from a mapped file
+bool ht_save(ht_t *, const char *);
+ht_mmap_t *ht_open_mmap(const char *);
+void ht_mmap_close(ht_mmap_t *);
+const void *ht_mmap_get(const ht_mmap_t *, const void *);
+size_t ht_mmap_count(const ht_mmap_t *);
+size_t ht_mmap_inline_val(const ht_mmap_t *);
+bool ht_strint_save(ht_strint_t *, const char *);
+ht_mmap_t *ht_strint_open_mmap(const char *);
+bool ht_strint_mmap_get_val(ht_mmap_t *, const char *, int *);
+bool ht_strstr_save(ht_strstr_t *, const char *);
+ht_mmap_t *ht_strstr_open_mmap(const char *);
+const char *ht_strstr_mmap_get(ht_mmap_t *, const char *);
+
 #ifdef __cplusplus
 }
 #endif
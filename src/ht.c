@@ -6,60 +6,77 @@
  * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
  */
 
-#include "ht.h"
+#include "ht_private.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
-#define INITIAL_BUCKETS (16) // Initial table size
-#define MAX_LOAD_FACTOR                                                        \
-    (0.75) // Capacity point at which a table needs to grow and rehash
-#define MAX_CAPACITY                                                           \
-    (1 << 31) // Maximum capacity of table when it should not grow and rehash
-              // (2147483648)
-#define GROWTH_FACTOR (2) // Factor by which a table's capacity should grow
-
-typedef struct ht_bucket {
-    const void *key;
-    const void *val;
-    struct ht_bucket *next;
-} ht_bucket_t;
-
-struct ht { // typedefed to ht_t in ht.h for external scope
-    ht_hash hfunc;
-    ht_keyeq keyeq;
-    ht_callbacks_t callbacks;
-    ht_bucket_t *buckets;
-    size_t capacity;
-    size_t used_buckets;
-#if defined(CPU_32_BIT)
-    uint32_t seed;
-#else
-    uint64_t seed;
+#if defined(__linux__)
+#include <sys/random.h>
 #endif
-};
 
-struct ht_enum { // typedefed to ht_enum_t in ht.h for external scope
-    ht_t *ht;
-    ht_bucket_t *cur;
-    size_t idx;
-};
+#define INITIAL_BUCKETS (16) // Default initial table size
+#define MAX_LOAD_FACTOR                                                        \
+    (0.75) // Default capacity point at which a table needs to grow and rehash
+#define MAX_CAPACITY                                                           \
+    ((size_t)1 << 31) // Maximum capacity of table when it should not grow and
+                      // rehash (2147483648)
+#define GROWTH_FACTOR                                                          \
+    (2) // Default factor by which a table's capacity should grow, keeps
+        // capacity a power of two
+#define MAX_OPTION_LOAD (4)   // Highest max load factor a table can be given
+#define MAX_OPTION_GROWTH (4) // Highest growth factor a table can be given
+#define SHRINK_LOAD_RATIO                                                      \
+    (6) // Tables shrink below this fraction of their max load, far enough
+        // under it that they don't grow straight back, 1/8 at the default
+#define REHASH_STEP                                                            \
+    (16) // Old buckets migrated per operation by an incremental rehash
+#define KEY_BUF_SIZE                                                           \
+    (256) // Stack buffer for terminating length delimited keys
+#define CHAIN_TREEIFY                                                          \
+    (8) // Chains longer than this get a sorted index, see ht_chain.c
+#define CHAIN_UNTREEIFY                                                        \
+    (6) // Indexed chains shorter than this drop their index
+#define PARALLEL_MIN_BUCKETS                                                   \
+    ((size_t)1 << 16) // Old buckets a migration needs to be split up
+#define MAX_RESIZE_THREADS (64) // Most threads a migration is split between
+#define GET_BATCH                                                              \
+    (16) // Keys ht_get_many hashes and prefetches ahead of looking them up
+#define INSERT_BATCH                                                           \
+    (16) // Keys ht_insert_many hashes and prefetches ahead of adding them
 
 /**
  * __random_seed:
- *      Generate a random hash offset.
+ *      Generate a random hash seed from the kernel's random number generator,
+ * falling back to the time and addresses only if it can't be read.
  */
 static void __random_seed(ht_t *ht) {
-#if defined(CPU_32_BIT)
-    uint32_t seed = (uint32_t)time(NULL);
-    seed ^= ((uint32_t)ht_create << 16) | (uint32_t)&ht;
-    seed ^= (uint32_t)&ht;
-#else
-    uint64_t seed = (uint64_t)time(NULL);
-    seed ^= ((uint64_t)ht_create << 32) | (uint64_t)&ht;
-    seed ^= (uint64_t)&ht;
+    ht_hashval_t seed = 0;
+    FILE *f = NULL;
+
+#if defined(__linux__)
+    if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) == sizeof(seed)) {
+        ht->seed = seed;
+        return;
+    }
 #endif
+
+    f = fopen("/dev/urandom", "rb");
+    if (f) {
+        const size_t n = fread(&seed, sizeof(seed), 1, f);
+
+        fclose(f);
+        if (n == 1) {
+            ht->seed = seed;
+            return;
+        }
+    }
+
+    seed = (ht_hashval_t)time(NULL);
+    seed ^= (ht_hashval_t)(uintptr_t)ht_create << (sizeof(seed) * 4);
+    seed ^= (ht_hashval_t)(uintptr_t)&ht;
     ht->seed = seed;
 }
 
@@ -83,16 +100,106 @@ static void __ht_passthrough_destroy(const void *v) { return; }
 
 /**
  * __ht_bucket_index:
- *      Return the table index of a bucket given it's key.
+ *      Return the index of the bucket a hash maps to in an array of capacity
+ * buckets. Power of two capacities, the default, mask the hash instead of
+ * dividing it.
+ */
+static inline size_t __ht_bucket_index(ht_hashval_t hash, size_t capacity) {
+    if (capacity & (capacity - 1)) {
+        return (size_t)(hash % capacity);
+    }
+
+    return (size_t)hash & (capacity - 1);
+}
+
+/**
+ * __ht_treeify:
+ *      Index the chain of a bucket, so lookups in it take log n compares.
+ *      Without memory for the index the chain is only walked as before.
+ */
+static void __ht_treeify(ht_t *ht, size_t idx) {
+    if (!ht->chains) {
+        ht->chains = calloc(ht->capacity, sizeof(*ht->chains));
+        if (!ht->chains) {
+            perror("__ht_treeify");
+            return;
+        }
+    }
+
+    ht->chains[idx] = __ht_chain_build(ht, ht->buckets + idx);
+}
+
+/**
+ * __ht_untreeify:
+ *      Drop the index of the chain of a bucket.
+ */
+static void __ht_untreeify(ht_t *ht, size_t idx) {
+    free(ht->chains[idx]);
+    ht->chains[idx] = NULL;
+}
+
+/**
+ * __ht_add_to_chain:
+ *      Add a key value pair to the indexed chain of a bucket, new entries go
+ * right after the bucket.
+ *      Returns false if the bucket has no index, and the chain is to be walked
+ * instead. Otherwise entry is set to the entry added or updated, or NULL if
+ * out of memory.
  */
-static size_t __ht_bucket_index(const ht_t *ht, const void *key) {
-    return ht->hfunc(key, ht->seed) % ht->capacity;
+static bool __ht_add_to_chain(ht_t *ht, size_t idx, const ht_key_t *k,
+                              const void *val, bool rehash,
+                              ht_bucket_t **entry) {
+    ht_bucket_t *cur = NULL, *head = ht->buckets + idx;
+    size_t pos = 0;
+
+    if (!ht->chains || !ht->chains[idx]) {
+        return false;
+    }
+
+    cur = __ht_chain_find(ht, ht->chains[idx], k, &pos);
+    if (cur) {
+        __ht_entry_set_val(ht, &cur->key, &cur->val, val);
+        *entry = cur;
+        return true;
+    }
+
+    if (!__ht_chain_reserve(&ht->chains[idx])) {
+        __ht_untreeify(ht, idx);
+        return false;
+    }
+
+    cur = __ht_pool_alloc(&ht->pool);
+    *entry = cur;
+    if (!cur) {
+        perror("__ht_add_to_chain");
+        return true;
+    }
+
+    if (rehash) {
+        cur->key = k->ptr;
+        cur->val = val;
+    } else {
+        __ht_entry_fill(ht, &cur->key, &cur->val, k, val);
+        ht->used_buckets++;
+    }
+
+    cur->hash = k->hash;
+    cur->next = head->next;
+    head->next = cur;
+    __ht_chain_insert(ht->chains[idx], pos, cur);
+
+    return true;
 }
 
 /**
  * __ht_add_to_bucket:
- *      Fill a bucket with a key and value.
+ *      Fill a bucket with a key, value and the hash of the key.
  *      If part of a rehash operation do not make copies of the key value pair.
+ * A unique key, such as a migrated key that is never in the new buckets, is
+ * not looked for.
+ *      Chain nodes whose stored hash differs from the key's hash are skipped
+ * without calling keyeq. Chains get an index once they pass CHAIN_TREEIFY
+ * entries and are searched through it from then on.
  *      Case 1:
  *            Check if the index of the bucket has something already.
  *            If not then we add the key and value to the bucket.
@@ -108,356 +215,1604 @@ static size_t __ht_bucket_index(const ht_t *ht, const void *key) {
  *             If yes, replace the value and we’re done.
  *             If not we’ll hit the end and create a new node to add to the
  * chain.
+ *      Returns the entry added or updated, or NULL if out of memory.
  */
-static void __ht_add_to_bucket(ht_t *ht, const void *key, const void *val,
-                               bool rehash) {
+static ht_bucket_t *__ht_add_to_bucket(ht_t *ht, const ht_key_t *k,
+                                       const void *val, bool rehash,
+                                       bool unique) {
     ht_bucket_t *cur = NULL, *prev = NULL;
-    const size_t idx = __ht_bucket_index(ht, key);
+    const size_t idx = __ht_bucket_index(k->hash, ht->capacity);
+    size_t len = 0;
 
     if (!ht->buckets[idx].key) {
-        if (!rehash) {
-            key = ht->callbacks.key_copy(key);
-
-            if (val) {
-                val = ht->callbacks.val_copy(val);
-            }
-        }
-
-        ht->buckets[idx].key = key;
-        ht->buckets[idx].val = val;
-
-        if (!rehash) {
+        if (rehash) {
+            ht->buckets[idx].key = k->ptr;
+            ht->buckets[idx].val = val;
+        } else {
+            __ht_entry_fill(ht, &ht->buckets[idx].key, &ht->buckets[idx].val,
+                            k, val);
             ht->used_buckets++;
         }
-    } else {
+
+        ht->buckets[idx].hash = k->hash;
+        cur = ht->buckets + idx;
+    } else if (!__ht_add_to_chain(ht, idx, k, val, rehash, &cur)) {
         cur = ht->buckets + idx;
 
         do {
-            if (ht->keyeq(key, cur->key)) {
-                if (cur->val) {
-                    ht->callbacks.val_free(cur->val);
-                }
-
-                if (!rehash && val) {
-                    val = ht->callbacks.val_copy(val);
-                }
-
-                cur->val = val;
+            if (!unique && __ht_key_match(ht, k, cur->hash, cur->key)) {
+                __ht_entry_set_val(ht, &cur->key, &cur->val, val);
                 prev = NULL;
                 break;
             }
 
             prev = cur;
             cur = cur->next;
+            len++;
         } while (cur);
 
         if (prev) {
-            cur = calloc(1, sizeof(*cur->next));
+            cur = __ht_pool_alloc(&ht->pool);
             if (!cur) {
                 perror("__ht_add_to_bucket");
-                return;
+                return NULL;
             }
 
-            if (!rehash) {
-                key = ht->callbacks.key_copy(key);
-
-                if (val) {
-                    val = ht->callbacks.val_copy(val);
-                }
+            if (rehash) {
+                cur->key = k->ptr;
+                cur->val = val;
+            } else {
+                __ht_entry_fill(ht, &cur->key, &cur->val, k, val);
+                ht->used_buckets++;
             }
 
-            cur->key = key;
-            cur->val = val;
+            cur->hash = k->hash;
             prev->next = cur;
 
-            if (!rehash) {
-                ht->used_buckets++;
+            if (len >= CHAIN_TREEIFY) {
+                __ht_treeify(ht, idx);
             }
         }
     }
+
+    return cur;
 }
 
 /**
- * __ht_rehash:
- *      Rehash a table growing it's capacity by GROWTH_FACTOR if it has reached
- * MAX_LOAD_FACTOR, but do not grow table if it's capacity has reached
- * MAX_CAPACITY.
+ * __ht_migrate_bucket:
+ *      Move the entry of an old bucket and it's chain into the current buckets
+ * of a table, leaving the old bucket empty. Entries are placed by their stored
+ * hash, keys are not hashed again. The old chain nodes go back to pool, or are
+ * left to be released with the pool they came from if it is NULL.
  */
-static void __ht_rehash(ht_t *ht) {
-    ht_bucket_t *buckets = NULL, *cur = NULL, *next = NULL;
-    size_t capacity;
-
-    if (ht->used_buckets + 1 < (size_t)(ht->capacity * MAX_LOAD_FACTOR) ||
-        ht->capacity >= MAX_CAPACITY) {
-        return;
-    }
+static void __ht_migrate_bucket(ht_t *ht, size_t idx, ht_pool_t *pool) {
+    ht_bucket_t *bucket = ht->old_buckets + idx;
+    ht_bucket_t *cur = NULL, *next = NULL;
+    ht_key_t k = {bucket->key, 0, bucket->hash, false};
 
-    capacity = ht->capacity;
-    buckets = ht->buckets;
-    ht->capacity *= GROWTH_FACTOR;
-    ht->buckets = calloc(ht->capacity, sizeof(*buckets));
-    if (!ht->buckets) {
-        perror("__ht_rehash");
+    if (!bucket->key) {
         return;
     }
 
-    for (size_t i = 0; i < capacity; i++) {
-        if (!buckets[i].key) {
-            continue;
-        }
+    k.len = ht->keyeq_n ? str_pack_len(k.ptr) : 0;
 
-        __ht_add_to_bucket(ht, buckets[i].key, buckets[i].val, true);
+    if (ht->old_chains) {
+        free(ht->old_chains[idx]);
+        ht->old_chains[idx] = NULL;
+    }
 
-        if (buckets[i].next) {
-            cur = buckets[i].next;
+    __ht_add_to_bucket(ht, &k, bucket->val, true, true);
 
-            do {
-                __ht_add_to_bucket(ht, cur->key, cur->val, true);
-                next = cur->next;
-                free(cur);
-                cur = next;
-            } while (cur);
+    cur = bucket->next;
+    while (cur) {
+        k.ptr = cur->key;
+        k.len = ht->keyeq_n ? str_pack_len(cur->key) : 0;
+        k.hash = cur->hash;
+        __ht_add_to_bucket(ht, &k, cur->val, true, true);
+        next = cur->next;
+        if (pool) {
+            __ht_pool_free(pool, cur);
         }
+        cur = next;
     }
 
-    free(buckets);
-    buckets = NULL;
+    bucket->key = NULL;
+    bucket->val = NULL;
+    bucket->next = NULL;
 }
 
 /**
- * ht_create:
- *      Create a new hash table of INITIAL_CAPACITY, it requires a hash
- * function, a key equality comparison function, and optionally bucket
- * operations function callbacks structure.
+ * __ht_rehash_step:
+ *      Migrate up to steps old buckets of a running rehash, and release the
+ * old buckets once all of them have moved.
  */
-ht_t *ht_create(const ht_hash hfunc, const ht_keyeq keyeq,
-                const ht_callbacks_t *callbacks, const unsigned int flags) {
-    ht_t *ht = NULL;
+static void __ht_rehash_step(ht_t *ht, size_t steps) {
+    while (steps-- && ht->rehash_idx < ht->old_capacity) {
+        __ht_migrate_bucket(ht, ht->rehash_idx++, &ht->pool);
+    }
 
-    if (!hfunc || !keyeq) {
-        return NULL;
+    if (ht->rehash_idx >= ht->old_capacity) {
+        free(ht->old_buckets);
+        free(ht->old_chains);
+        ht->old_buckets = NULL;
+        ht->old_chains = NULL;
+        ht->old_capacity = 0;
+        ht->rehash_idx = 0;
     }
+}
 
-    ht = calloc(1, sizeof(*ht));
-    if (!ht) {
-        perror("ht_create");
-        return NULL;
+/**
+ * __ht_rehash_continue:
+ *      Do a bounded share of a running incremental rehash. Migration pauses
+ * while the table is being enumerated so no entry is skipped or seen twice.
+ */
+static void __ht_rehash_continue(ht_t *ht) {
+    if (ht->old_buckets && !ht->enumerators) {
+        __ht_rehash_step(ht, ht->rehash_pace);
     }
+}
 
-    ht->hfunc = hfunc;
-    ht->keyeq = keyeq;
+/**
+ * __ht_rehash_key:
+ *      Migrate the old bucket a key hash maps to during an incremental rehash,
+ * so if the key is in the table it is in the current buckets. Paused like
+ * __ht_rehash_continue while the table is enumerated, the key may then still
+ * be in the old buckets.
+ */
+static void __ht_rehash_key(ht_t *ht, ht_hashval_t hash) {
+    if (ht->old_buckets && !ht->enumerators) {
+        __ht_migrate_bucket(ht, __ht_bucket_index(hash, ht->old_capacity),
+                            &ht->pool);
+    }
+}
 
-    ht->callbacks.key_copy = __ht_passthrough_copy;
-    ht->callbacks.key_free = __ht_passthrough_destroy;
-    ht->callbacks.val_copy = __ht_passthrough_copy;
-    ht->callbacks.val_free = __ht_passthrough_destroy;
+// A share of the old buckets of a migration split between threads
+typedef struct {
+    ht_t ht;      // Copy of the table with a chain node pool of it's own
+    size_t first; // Old buckets migrated, first up to end
+    size_t end;
+    pthread_t thread;
+    bool started;
+} ht_resize_job_t;
 
-    if (callbacks) {
-        if (callbacks->key_copy) {
-            ht->callbacks.key_copy = callbacks->key_copy;
-        }
-        if (callbacks->key_free) {
-            ht->callbacks.key_free = callbacks->key_free;
-        }
-        if (callbacks->val_copy) {
-            ht->callbacks.val_copy = callbacks->val_copy;
-        }
-        if (callbacks->val_free) {
-            ht->callbacks.val_free = callbacks->val_free;
-        }
+/**
+ * __ht_resize_worker:
+ *      Migrate the old buckets of a share of a split migration.
+ */
+static void *__ht_resize_worker(void *arg) {
+    ht_resize_job_t *job = arg;
+
+    for (size_t i = job->first; i < job->end; i++) {
+        __ht_migrate_bucket(&job->ht, i, &job->ht.pool);
     }
 
-    ht->capacity = INITIAL_BUCKETS;
-    ht->buckets = calloc(ht->capacity, sizeof(*ht->buckets));
-    if (!ht->buckets) {
-        perror("ht_create");
-        return NULL;
+    return NULL;
+}
+
+/**
+ * __ht_resize_join:
+ *      Take back the chain nodes and chain indexes of a finished share of a
+ * split migration.
+ */
+static void __ht_resize_join(ht_t *ht, ht_resize_job_t *job) {
+    ht_chain_t **chains = job->ht.chains;
+
+    __ht_pool_merge(&ht->pool, &job->ht.pool);
+
+    if (!chains || chains == ht->chains) {
+        return;
     }
 
-    if (flags & HT_SEED_RANDOM) {
-        __random_seed(ht);
-    } else {
-        __default_seed(ht);
+    // The share had to index a chain before the table had indexes
+    if (!ht->chains) {
+        ht->chains = chains;
+        return;
     }
 
-    return ht;
+    for (size_t i = 0; i < ht->capacity; i++) {
+        if (chains[i]) {
+            ht->chains[i] = chains[i];
+        }
+    }
+    free(chains);
 }
 
 /**
- * ht_destroy:
- *      Destroy a hash table first by freeing all buckets then the table itself.
+ * __ht_rehash_parallel:
+ *      Migrate every old bucket of a table on it's resize threads.
+ *      A table growing from a power of two capacity to a larger one moves the
+ * entries of old bucket i only to new buckets i, i + old capacity and so on,
+ * so threads migrating separate ranges of old buckets never touch the same
+ * new bucket, and each new chain is built in the same order as by one thread.
+ * Each thread works on a copy of the table allocating chain nodes from a pool
+ * of it's own, merged back into the table's pool once all are done.
+ *      Returns false, having moved nothing, for a small table, a table that
+ * isn't growing between powers of two, or if out of memory.
  */
-void ht_destroy(ht_t *ht) {
-    ht_bucket_t *next = NULL, *cur = NULL;
+static bool __ht_rehash_parallel(ht_t *ht) {
+    const size_t old = ht->old_capacity;
+    size_t threads = ht->resize_threads;
+    ht_resize_job_t *jobs = NULL;
 
-    if (!ht) {
-        return;
+    if (threads < 2 || old < PARALLEL_MIN_BUCKETS || ht->capacity <= old ||
+        (old & (old - 1)) || (ht->capacity & (ht->capacity - 1))) {
+        return false;
     }
 
-    for (size_t idx = 0; idx < ht->capacity; idx++) {
-        if (!ht->buckets[idx].key) {
-            continue;
-        }
+    threads = threads < MAX_RESIZE_THREADS ? threads : MAX_RESIZE_THREADS;
 
-        ht->callbacks.key_free(ht->buckets[idx].key);
-        if (ht->buckets[idx].val) {
-            ht->callbacks.val_free(ht->buckets[idx].val);
+    jobs = calloc(threads, sizeof(*jobs));
+    if (!jobs) {
+        perror("__ht_rehash_parallel");
+        return false;
+    }
+
+    // Indexed chains keep their index, the threads share one array
+    if (ht->old_chains && !ht->chains) {
+        ht->chains = calloc(ht->capacity, sizeof(*ht->chains));
+        if (!ht->chains) {
+            perror("__ht_rehash_parallel");
+            free(jobs);
+            return false;
         }
+    }
 
-        next = ht->buckets[idx].next;
-        while (next) {
-            cur = next;
-            ht->callbacks.key_free(cur->key);
-            if (cur->val) {
-                ht->callbacks.val_free(cur->val);
-            }
-            next = cur->next;
-            free(cur);
-            cur = NULL;
+    for (size_t t = 0; t < threads; t++) {
+        jobs[t].ht = *ht;
+        memset(&jobs[t].ht.pool, 0, sizeof(jobs[t].ht.pool));
+        jobs[t].ht.pool.slab_nodes = ht->pool.slab_nodes;
+        jobs[t].first = old / threads * t;
+        jobs[t].end = t + 1 < threads ? old / threads * (t + 1) : old;
+    }
+
+    for (size_t t = 1; t < threads; t++) {
+        jobs[t].started = !pthread_create(&jobs[t].thread, NULL,
+                                          __ht_resize_worker, jobs + t);
+    }
+
+    // The calling thread takes the first share, and any without a thread
+    __ht_resize_worker(jobs);
+    for (size_t t = 1; t < threads; t++) {
+        if (jobs[t].started) {
+            pthread_join(jobs[t].thread, NULL);
+        } else {
+            __ht_resize_worker(jobs + t);
         }
     }
 
-    free(ht->buckets);
-    ht->buckets = NULL;
-    free(ht);
-    ht = NULL;
+    for (size_t t = 0; t < threads; t++) {
+        __ht_resize_join(ht, jobs + t);
+    }
+
+    ht->rehash_idx = old;
+    free(jobs);
+
+    return true;
 }
 
 /**
- * ht_insert:
- *      Insert a key value pair into a table bucket.
+ * __ht_rehash_all:
+ *      Finish a migration at once, split between the table's resize threads
+ * when it can be, and release the old buckets.
  */
-void ht_insert(ht_t *ht, const void *key, const void *val) {
-    if (!ht || !key) {
-        return;
+static void __ht_rehash_all(ht_t *ht) {
+    if (ht->old_buckets) {
+        __ht_rehash_parallel(ht);
     }
 
-    __ht_rehash(ht);
-    __ht_add_to_bucket(ht, key, val, false);
+    __ht_rehash_step(ht, ht->old_capacity);
 }
 
 /**
- * ht_remove:
- *      Remove a bucket from the table.
- *      Step 1:
- *            Get the bucket index using it's hash.
- *      Step 2:
- *            Check the bucket and chains for a key match.
- *      Step 3:
- *            Remove the entry if match is made.
- *      Step 4:
- *            Relink the chain if necessary.
+ * __ht_rehash_pace:
+ *      Return how many old buckets each operation migrates, at least the rehash
+ * step, so a migration just started is done before inserts bring the table to
+ * it's next growth. Otherwise that growth would migrate what is left all at
+ * once, which small steps and growth factors would make the common case.
  */
-void ht_remove(ht_t *ht, const void *key) {
-    if (!ht || !key) {
-        return;
+static size_t __ht_rehash_pace(const ht_t *ht) {
+    const size_t limit = (size_t)(ht->capacity * ht->max_load);
+    const size_t ops = limit > ht->used_buckets + 1
+                           ? limit - ht->used_buckets - 1
+                           : 1;
+    const size_t pace = (ht->old_capacity + ops - 1) / ops;
+
+    return pace > ht->rehash_step ? pace : ht->rehash_step;
+}
+
+/**
+ * __ht_new_buckets:
+ *      Give a table a new empty array of capacity buckets, keeping the current
+ * ones as the old buckets to migrate from.
+ */
+static bool __ht_new_buckets(ht_t *ht, size_t capacity) {
+    ht_bucket_t *buckets = NULL;
+
+    // Finish a migration that is still running before starting the next one
+    if (ht->old_buckets) {
+        __ht_rehash_all(ht);
     }
 
-    ht_bucket_t *cur = NULL, *prev = NULL;
-    const size_t idx = __ht_bucket_index(ht, key);
-    ;
+    buckets = calloc(capacity, sizeof(*buckets));
+    if (!buckets) {
+        perror("__ht_new_buckets");
+        return false;
+    }
 
-    if (!ht->buckets[idx].key) {
-        return;
+    ht->old_buckets = ht->buckets;
+    ht->old_chains = ht->chains;
+    ht->chains = NULL;
+    ht->old_capacity = ht->capacity;
+    ht->rehash_idx = 0;
+    ht->buckets = buckets;
+    ht->capacity = capacity;
+    ht->rehash_pace = __ht_rehash_pace(ht);
+
+    return true;
+}
+
+/**
+ * __ht_resize:
+ *      Move a table to a new array of capacity buckets.
+ *      Tables with a rehash step keep the old buckets next to the new ones and
+ * migrate them a few at a time as the table is used, any other table migrates
+ * every bucket right away.
+ */
+static bool __ht_resize(ht_t *ht, size_t capacity) {
+    if (!__ht_new_buckets(ht, capacity)) {
+        return false;
     }
 
-    if (ht->keyeq(ht->buckets[idx].key, key)) {
-        ht->callbacks.key_free(ht->buckets[idx].key);
-        if (ht->buckets[idx].val) {
-            ht->callbacks.val_free(ht->buckets[idx].val);
-        }
-        ht->buckets[idx].key = NULL;
-        ht->buckets[idx].val = NULL;
+    if (!ht->rehash_step) {
+        __ht_rehash_all(ht);
+    }
 
-        cur = ht->buckets[idx].next;
-        if (cur) {
-            ht->buckets[idx].key = ht->callbacks.key_copy(cur->key);
-            if (cur->val) {
-                ht->buckets[idx].val = ht->callbacks.val_copy(cur->val);
-            }
-            ht->buckets[idx].next = cur->next;
-            ht->callbacks.key_free(cur->key);
-            if (cur->val) {
-                ht->callbacks.val_free(cur->val);
-            }
-            cur->key = NULL;
-            cur->val = NULL;
-            free(cur);
-            cur = NULL;
-        }
+    return true;
+}
 
-        ht->used_buckets--;
+/**
+ * __ht_grow:
+ *      Return the capacity a table of capacity grows to, by at least one
+ * bucket and at most to the table's max capacity.
+ */
+static size_t __ht_grow(const ht_t *ht, size_t capacity) {
+    size_t grown = (size_t)(capacity * ht->growth);
+
+    if (grown <= capacity) {
+        grown = capacity + 1;
+    }
 
+    return grown < ht->max_capacity ? grown : ht->max_capacity;
+}
+
+/**
+ * __ht_rehash:
+ *      Rehash a table growing it's capacity by it's growth factor if it has
+ * reached it's max load factor, but do not grow table if it's capacity has
+ * reached it's max capacity. A table being enumerated keeps it's buckets, and
+ * chains longer until it is done.
+ */
+static void __ht_rehash(ht_t *ht) {
+    if (ht->used_buckets + 1 < (size_t)(ht->capacity * ht->max_load) ||
+        ht->capacity >= ht->max_capacity || ht->enumerators) {
         return;
     }
 
-    prev = ht->buckets + idx;
-    cur = prev->next;
+    __ht_resize(ht, __ht_grow(ht, ht->capacity));
+}
 
-    while (cur) {
-        if (ht->keyeq(key, cur->key)) {
-            prev->next = cur->next;
-            ht->callbacks.key_free(cur->key);
-            if (cur->val) {
-                ht->callbacks.val_free(cur->val);
-            }
-            cur->key = NULL;
-            cur->val = NULL;
-            free(cur);
-            cur = NULL;
-            ht->used_buckets--;
-            break;
-        }
+/**
+ * __ht_full:
+ *      Tell if a table takes no new key, it's load has reached it's max load
+ * factor at it's max capacity.
+ */
+static bool __ht_full(const ht_t *ht) {
+    return ht->capacity >= ht->max_capacity &&
+           ht->used_buckets + 1 > (size_t)(ht->capacity * ht->max_load);
+}
 
-        prev = cur;
-        cur = cur->next;
+/**
+ * __ht_capacity_for:
+ *      Return the smallest capacity a table holding n entries can have.
+ */
+static size_t __ht_capacity_for(const ht_t *ht, size_t n) {
+    size_t capacity = ht->initial_capacity;
+
+    while (n >= (size_t)(capacity * ht->max_load) &&
+           capacity < ht->max_capacity) {
+        capacity = __ht_grow(ht, capacity);
     }
+
+    return capacity;
 }
 
 /**
- * __ht_get:
- *      Get a table bucket value given it's key and a pointer to store it's
- * value.
+ * __ht_reserve:
+ *      Size the buckets of a table once to hold n entries without growing
+ * again. A reserving table is migrated right away, even with a rehash step.
  */
-static bool __ht_get(const ht_t *ht, const void *key, void **val) {
-    if (!ht || !key) {
+static bool __ht_reserve(ht_t *ht, size_t n) {
+    const size_t capacity = __ht_capacity_for(ht, n);
+
+    if (n >= (size_t)(capacity * ht->max_load)) {
         return false;
     }
 
-    const ht_bucket_t *cur = NULL;
-    const size_t idx = __ht_bucket_index(ht, key);
+    if (capacity <= ht->capacity) {
+        return true;
+    }
 
-    if (!ht->buckets[idx].key) {
+    if (!__ht_resize(ht, capacity)) {
         return false;
     }
 
-    cur = ht->buckets + idx;
-    while (cur) {
-        if (ht->keyeq(key, cur->key)) {
-            *val = (void *)cur->val;
-            return true;
-        }
-        cur = cur->next;
+    if (ht->old_buckets) {
+        __ht_rehash_all(ht);
     }
 
-    return false;
+    return true;
 }
 
 /**
- * ht_get:
- *      Get a table bucket value given it's key. It's a wrapper around __ht_get.
+ * __ht_shrink:
+ *      Shrink a table by it's growth factor once it's load falls below
+ * 1/SHRINK_LOAD_RATIO of it's max load, so memory taken at a peak is returned
+ * as entries are removed. Tables don't shrink below their initial capacity or
+ * the capacity reserved for them, while enumerated, or while still migrating.
  */
-void *ht_get(const ht_t *ht, const void *key) {
-    void *val = NULL;
-    __ht_get(ht, key, &val);
-    return val;
+void __ht_shrink(ht_t *ht) {
+    const size_t capacity = (size_t)(ht->capacity / ht->growth);
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        __ht_swiss_shrink(ht);
+        return;
+    case HT_ROBINHOOD:
+        __ht_robinhood_shrink(ht);
+        return;
+    default:
+        break;
+    }
+
+    if (capacity < ht->initial_capacity || ht->old_buckets ||
+        ht->enumerators ||
+        ht->used_buckets >=
+            (size_t)(ht->capacity * ht->max_load / SHRINK_LOAD_RATIO) ||
+        ht->reserved >= (size_t)(capacity * ht->max_load)) {
+        return;
+    }
+
+    __ht_resize(ht, capacity);
 }
 
 /**
- * ht_enum_create:
- *      Create a table enumeration object.
+ * __ht_shrink_to_fit:
+ *      Move a table to the smallest array of buckets holding it's entries,
+ * migrating right away. Chain nodes move to a fresh pool and the old pool is
+ * released whole, slabs left over from a peak included.
  */
-ht_enum_t *ht_enum_create(ht_t *ht) {
+static bool __ht_shrink_to_fit(ht_t *ht) {
+    ht_pool_t pool = ht->pool;
+
+    if (!__ht_new_buckets(ht, __ht_capacity_for(ht, ht->used_buckets))) {
+        return false;
+    }
+
+    memset(&ht->pool, 0, sizeof(ht->pool));
+
+    while (ht->rehash_idx < ht->old_capacity) {
+        __ht_migrate_bucket(ht, ht->rehash_idx++, NULL);
+    }
+
+    // Every old bucket has moved, release them
+    __ht_rehash_step(ht, 0);
+    __ht_pool_destroy(&pool);
+
+    return true;
+}
+
+/**
+ * __ht_free_buckets:
+ *      Free the entries of an array of buckets, their chains and the array.
+ *      Chain nodes themselves are left to be released with the table's pool,
+ * and arena strings with the table's arena.
+ */
+static void __ht_free_buckets(ht_t *ht, ht_bucket_t *buckets,
+                              size_t capacity) {
+    const ht_bucket_t *cur = NULL;
+
+    for (size_t idx = 0; idx < capacity && __ht_entries_need_free(ht); idx++) {
+        if (!buckets[idx].key) {
+            continue;
+        }
+
+        __ht_key_free(ht, buckets[idx].key);
+        __ht_val_free(ht, buckets[idx].val);
+
+        for (cur = buckets[idx].next; cur; cur = cur->next) {
+            __ht_key_free(ht, cur->key);
+            __ht_val_free(ht, cur->val);
+        }
+    }
+
+    free(buckets);
+}
+
+/**
+ * __ht_create:
+ *      Allocate a table with it's callbacks, storage engine and seed, leaving
+ * the hash and key equality functions to the caller.
+ */
+static ht_t *__ht_create(const ht_callbacks_t *callbacks,
+                         const unsigned int flags) {
+    ht_t *ht = calloc(1, sizeof(*ht));
+
+    if (!ht) {
+        perror("ht_create");
+        return NULL;
+    }
+
+    ht->callbacks.key_copy = __ht_passthrough_copy;
+    ht->callbacks.key_free = __ht_passthrough_destroy;
+    ht->callbacks.val_copy = __ht_passthrough_copy;
+    ht->callbacks.val_free = __ht_passthrough_destroy;
+
+    if (callbacks) {
+        if (callbacks->key_copy) {
+            ht->callbacks.key_copy = callbacks->key_copy;
+        }
+        if (callbacks->key_free) {
+            ht->callbacks.key_free = callbacks->key_free;
+        }
+        if (callbacks->val_copy) {
+            ht->callbacks.val_copy = callbacks->val_copy;
+        }
+        if (callbacks->val_free) {
+            ht->callbacks.val_free = callbacks->val_free;
+        }
+        ht->callbacks.pair_copy = callbacks->pair_copy;
+    }
+
+    if (flags & HT_ENGINE_SWISS) {
+        ht->engine = HT_SWISS;
+        if (!__ht_swiss_init(ht)) {
+            free(ht);
+            return NULL;
+        }
+    } else if (flags & HT_ENGINE_ROBINHOOD) {
+        ht->engine = HT_ROBINHOOD;
+        if (!__ht_robinhood_init(ht)) {
+            free(ht);
+            return NULL;
+        }
+    } else {
+        ht->max_load = MAX_LOAD_FACTOR;
+        ht->growth = GROWTH_FACTOR;
+        ht->initial_capacity = INITIAL_BUCKETS;
+        ht->max_capacity = MAX_CAPACITY;
+        ht->capacity = INITIAL_BUCKETS;
+        ht->buckets = calloc(ht->capacity, sizeof(*ht->buckets));
+        if (!ht->buckets) {
+            perror("ht_create");
+            free(ht);
+            return NULL;
+        }
+    }
+
+    if (flags & HT_REHASH_INCREMENTAL) {
+        ht->rehash_step = REHASH_STEP;
+    }
+
+    if (flags & HT_SEED_RANDOM) {
+        __random_seed(ht);
+    } else {
+        __default_seed(ht);
+    }
+
+    return ht;
+}
+
+/**
+ * ht_create:
+ *      Create a new hash table of INITIAL_CAPACITY, it requires a hash
+ * function, a key equality comparison function, and optionally bucket
+ * operations function callbacks structure.
+ *      Passing HT_ENGINE_SWISS in flags stores entries in open addressed slots
+ * probed with SIMD compares of 1-byte hash tags instead of chained buckets.
+ * HT_ENGINE_ROBINHOOD stores them in Robin Hood ordered linear probed slots.
+ * HT_REHASH_INCREMENTAL spreads the growth of chained buckets over later
+ * operations, see ht_set_rehash_step. HT_SEED_RANDOM passes hfunc a secret
+ * seed read from the kernel, pair it with a keyed hash like sip_hash_str when
+ * keys come from untrusted input.
+ */
+ht_t *ht_create(const ht_hash hfunc, const ht_keyeq keyeq,
+                const ht_callbacks_t *callbacks, const unsigned int flags) {
+    ht_t *ht = NULL;
+
+    if (!hfunc || !keyeq) {
+        return NULL;
+    }
+
+    ht = __ht_create(callbacks, flags);
+    if (ht) {
+        ht->hfunc = hfunc;
+        ht->keyeq = keyeq;
+    }
+
+    return ht;
+}
+
+/**
+ * ht_create_n:
+ *      Create a new hash table whose keys are runs of bytes of known length,
+ * which may hold zeros and need no terminator. The hash and key equality
+ * functions are passed each key's length.
+ *      The table copies keys itself as packed keys, str_pack_len gives the
+ * length of a key returned by enumeration, key_copy and key_free are not
+ * used. Keys of different lengths are told apart without calling keyeq. A
+ * pair_copy callback stores string values in the same allocation as their
+ * key. Flags are those of ht_create.
+ */
+ht_t *ht_create_n(const ht_hash_n hfunc, const ht_keyeq_n keyeq,
+                  const ht_callbacks_t *callbacks, const unsigned int flags) {
+    ht_t *ht = NULL;
+
+    if (!hfunc || !keyeq) {
+        return NULL;
+    }
+
+    ht = __ht_create(callbacks, flags);
+    if (ht) {
+        ht->hfunc_n = hfunc;
+        ht->keyeq_n = keyeq;
+    }
+
+    return ht;
+}
+
+/**
+ * ht_create_with_capacity:
+ *      ht_create for a table sized once to hold n entries, so filling it
+ * never has to grow and rehash it. Returns NULL if the table can't be sized.
+ */
+ht_t *ht_create_with_capacity(const ht_hash hfunc, const ht_keyeq keyeq,
+                              const ht_callbacks_t *callbacks,
+                              const unsigned int flags, size_t n) {
+    ht_t *ht = ht_create(hfunc, keyeq, callbacks, flags);
+
+    if (ht && !ht_reserve(ht, n)) {
+        ht_destroy(ht);
+        return NULL;
+    }
+
+    return ht;
+}
+
+/**
+ * ht_create_with_options:
+ *      ht_create for a table with it's own sizing policy, see ht_set_options.
+ * Returns NULL if the options are not valid.
+ */
+ht_t *ht_create_with_options(const ht_hash hfunc, const ht_keyeq keyeq,
+                             const ht_callbacks_t *callbacks,
+                             const unsigned int flags,
+                             const ht_options_t *opts) {
+    ht_t *ht = ht_create(hfunc, keyeq, callbacks, flags);
+
+    if (ht && !ht_set_options(ht, opts)) {
+        ht_destroy(ht);
+        return NULL;
+    }
+
+    return ht;
+}
+
+/**
+ * __ht_presize:
+ *      Size the buckets of a table of any engine once to hold n entries.
+ */
+static bool __ht_presize(ht_t *ht, size_t n) {
+    switch (ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_reserve(ht, n);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_reserve(ht, n);
+    default:
+        return __ht_reserve(ht, n);
+    }
+}
+
+/**
+ * ht_reserve:
+ *      Grow a table once so it holds n entries, counting those already in
+ * it, without growing again. Reserving never shrinks a table, and removes
+ * don't shrink it below n entries until ht_shrink_to_fit. Returns false if the
+ * table can't hold n entries or is out of memory, it is left as it was.
+ */
+bool ht_reserve(ht_t *ht, size_t n) {
+    bool reserved = false;
+
+    if (!ht) {
+        return false;
+    }
+
+    reserved = __ht_presize(ht, n);
+
+    // Removes don't shrink the table below what was reserved
+    if (reserved && n > ht->reserved) {
+        ht->reserved = n;
+    }
+
+    return reserved;
+}
+
+/**
+ * ht_shrink_to_fit:
+ *      Shrink a table to the smallest capacity holding the entries it has,
+ * returning the memory of it's peak size, and drop any capacity reserved for
+ * it. Tables also halve on their own as removes take their load below 1/8,
+ * this frees everything at once. Returns false if the table is being
+ * enumerated or out of memory, it is left as it was.
+ */
+bool ht_shrink_to_fit(ht_t *ht) {
+    if (!ht || ht->enumerators) {
+        return false;
+    }
+
+    ht->reserved = 0;
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_shrink_to_fit(ht);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_shrink_to_fit(ht);
+    default:
+        return __ht_shrink_to_fit(ht);
+    }
+}
+
+/**
+ * ht_destroy:
+ *      Destroy a hash table first by freeing all buckets then the table itself.
+ *      Strings kept in an arena are released a chunk at a time without visiting
+ * the entries. Enumeration objects of the table still live are detached,
+ * they enumerate nothing more and may still be destroyed afterwards.
+ */
+void ht_destroy(ht_t *ht) {
+    if (!ht) {
+        return;
+    }
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        __ht_swiss_destroy(ht);
+        break;
+    case HT_ROBINHOOD:
+        __ht_robinhood_destroy(ht);
+        break;
+    default:
+        if (ht->old_buckets) {
+            __ht_free_buckets(ht, ht->old_buckets, ht->old_capacity);
+            __ht_chains_free(ht->old_chains, ht->old_capacity);
+            ht->old_buckets = NULL;
+        }
+
+        __ht_free_buckets(ht, ht->buckets, ht->capacity);
+        __ht_chains_free(ht->chains, ht->capacity);
+        ht->buckets = NULL;
+        __ht_pool_destroy(&ht->pool);
+        break;
+    }
+
+    // Enumeration objects outliving the table only end their enumeration
+    for (ht_enum_t *he = ht->enums; he; he = he->next) {
+        he->ht = NULL;
+    }
+
+    __ht_arena_destroy(ht->arena);
+    free(ht);
+    ht = NULL;
+}
+
+/**
+ * __ht_key_nul:
+ *      Copy len bytes of key into buf, or a new allocation if it is too small,
+ * and terminate the copy. Used to hand length delimited keys to tables whose
+ * callbacks expect terminated ones.
+ */
+static const void *__ht_key_nul(const void *key, size_t len, char *buf) {
+    char *p = len < KEY_BUF_SIZE ? buf : malloc(len + 1);
+
+    if (!p) {
+        perror("__ht_key_nul");
+        return NULL;
+    }
+
+    memcpy(p, key, len);
+    p[len] = '\0';
+
+    return p;
+}
+
+/**
+ * __ht_key_view:
+ *      Fill in the key view of a terminated key.
+ */
+void __ht_key_view(const ht_t *ht, ht_key_t *k, const void *key) {
+    __ht_key_init(ht, k, key, ht->keyeq_n ? strlen(key) : 0);
+}
+
+/**
+ * __ht_key_hashed:
+ *      Fill in the key view of a key the caller already hashed.
+ */
+static void __ht_key_hashed(const ht_t *ht, ht_key_t *k, const void *key,
+                            ht_hashval_t hash) {
+    k->ptr = key;
+    k->len = ht->keyeq_n ? strlen(key) : 0;
+    k->hash = hash;
+    k->take = false;
+}
+
+/**
+ * __ht_find:
+ *      Return the entry of a key in a chained table, or NULL if the key is
+ * not in it.
+ */
+static ht_bucket_t *__ht_find(const ht_t *ht, const ht_key_t *k) {
+    ht_bucket_t *cur = NULL;
+    ht_chain_t *const *chains = NULL;
+    size_t idx = 0, pos = 0;
+
+    // Keys move with their whole old bucket, if it still has entries the key
+    // can only be there
+    if (ht->old_buckets) {
+        idx = __ht_bucket_index(k->hash, ht->old_capacity);
+        cur = ht->old_buckets + idx;
+        chains = ht->old_chains;
+    }
+
+    if (!cur || !cur->key) {
+        idx = __ht_bucket_index(k->hash, ht->capacity);
+        cur = ht->buckets + idx;
+        chains = ht->chains;
+    }
+
+    if (!cur->key) {
+        return NULL;
+    }
+
+    if (chains && chains[idx]) {
+        return __ht_chain_find(ht, chains[idx], k, &pos);
+    }
+
+    while (cur) {
+        if (__ht_key_match(ht, k, cur->hash, cur->key)) {
+            return cur;
+        }
+        cur = cur->next;
+    }
+
+    return NULL;
+}
+
+/**
+ * __ht_prefetch:
+ *      Start loading the bucket a key maps to, or once it is loaded, the key
+ * stored in it or the next node of it's chain.
+ */
+static void __ht_prefetch(const ht_t *ht, const ht_key_t *k, bool deep) {
+    const ht_bucket_t *bucket = NULL;
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        __ht_swiss_prefetch(ht, k, deep);
+        return;
+    case HT_ROBINHOOD:
+        __ht_robinhood_prefetch(ht, k, deep);
+        return;
+    default:
+        break;
+    }
+
+    bucket = ht->buckets + __ht_bucket_index(k->hash, ht->capacity);
+
+    if (!deep) {
+        HT_PREFETCH(bucket);
+        if (ht->old_buckets) {
+            HT_PREFETCH(ht->old_buckets +
+                        __ht_bucket_index(k->hash, ht->old_capacity));
+        }
+    } else if (bucket->key && bucket->hash == k->hash) {
+        HT_PREFETCH(bucket->key);
+    } else if (bucket->next) {
+        HT_PREFETCH(bucket->next);
+    }
+}
+
+/**
+ * __ht_insert:
+ *      Insert a key value pair into a table bucket. A key the caller knows is
+ * unique, not in the table, is added without being looked for. Returns false
+ * if a new key does not fit or is out of memory.
+ */
+bool __ht_insert(ht_t *ht, const ht_key_t *k, const void *val, bool unique) {
+    ht_bucket_t *cur = NULL;
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_insert(ht, k, val, unique);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_insert(ht, k, val, unique);
+    default:
+        break;
+    }
+
+    __ht_rehash_continue(ht);
+    __ht_rehash(ht);
+    __ht_rehash_key(ht, k->hash);
+
+    // A paused migration may have left the key in the old buckets
+    if (ht->old_buckets && ht->enumerators && !unique) {
+        cur = __ht_find(ht, k);
+        if (cur) {
+            __ht_entry_set_val(ht, &cur->key, &cur->val, val);
+            return true;
+        }
+        unique = true;
+    }
+
+    // A full table still replaces the values of it's keys
+    if (__ht_full(ht) && (unique || !__ht_find(ht, k))) {
+        return false;
+    }
+
+    return __ht_add_to_bucket(ht, k, val, false, unique) != NULL;
+}
+
+/**
+ * ht_insert:
+ *      Insert a key value pair into a table bucket. Returns false if the key
+ * is new and the table is full at it's max capacity, see ht_options_t, or out
+ * of memory.
+ */
+bool ht_insert(ht_t *ht, const void *key, const void *val) {
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return false;
+    }
+
+    __ht_key_view(ht, &k, key);
+
+    return __ht_insert(ht, &k, val, false);
+}
+
+/**
+ * ht_insert_n:
+ *      Insert a key of len bytes and it's value into a table, the key needs
+ * no terminator. Tables not made by ht_create_n get a terminated copy of the
+ * key, which ends at any zero byte in it. Returns false like ht_insert.
+ */
+bool ht_insert_n(ht_t *ht, const void *key, size_t len, const void *val) {
+    char buf[KEY_BUF_SIZE];
+    const void *nul = NULL;
+    bool inserted = false;
+    ht_key_t k;
+
+    if (!ht || !key || len > UINT32_MAX) {
+        return false;
+    }
+
+    if (ht->keyeq_n) {
+        __ht_key_init(ht, &k, key, len);
+        return __ht_insert(ht, &k, val, false);
+    }
+
+    nul = __ht_key_nul(key, len, buf);
+    inserted = ht_insert(ht, nul, val);
+    if (nul != buf) {
+        free((void *)nul);
+    }
+
+    return inserted;
+}
+
+/**
+ * __ht_get_or_insert:
+ *      Return the val field of the entry of a key, adding the key with a NULL
+ * value if it is not there, or NULL if it does not fit or out of memory.
+ */
+static const void **__ht_get_or_insert(ht_t *ht, const ht_key_t *k,
+                                       bool *inserted) {
+    ht_bucket_t *cur = NULL;
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_get_or_insert(ht, k, inserted);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_get_or_insert(ht, k, inserted);
+    default:
+        break;
+    }
+
+    __ht_rehash_continue(ht);
+    __ht_rehash(ht);
+    __ht_rehash_key(ht, k->hash);
+
+    cur = __ht_find(ht, k);
+    if (!cur && !__ht_full(ht)) {
+        cur = __ht_add_to_bucket(ht, k, NULL, false, true);
+        *inserted = cur != NULL;
+    }
+
+    return cur ? &cur->val : NULL;
+}
+
+/**
+ * ht_get_or_insert:
+ *      Find a key, adding it if it is not in the table, in a single lookup.
+ * Returns the slot holding the key's value, or NULL if a new key does not
+ * fit, as for ht_insert, or out of memory, and sets inserted, if given, to
+ * tell if the key was added.
+ *      A new key's slot holds a NULL value, or zeroes for tables with inline
+ * values. The slot holds the value pointer, or the value itself for tables
+ * with inline values, so counters and the like are updated in place instead
+ * of through another insert. A value stored through the slot is owned by the
+ * table and freed with val_free, val_copy is not called on it. The slot is
+ * only valid until the table is next changed.
+ *      Tables storing values with their keys, with pair_copy or in an arena,
+ * have no value slots and return NULL.
+ */
+void **ht_get_or_insert(ht_t *ht, const void *key, bool *inserted) {
+    const void **slot = NULL;
+    bool added = false;
+    ht_key_t k;
+
+    if (ht && key && !ht->callbacks.pair_copy &&
+        !(ht->arena && ht->arena->vals)) {
+        __ht_key_view(ht, &k, key);
+        slot = __ht_get_or_insert(ht, &k, &added);
+    }
+
+    if (inserted) {
+        *inserted = added;
+    }
+
+    return (void **)slot;
+}
+
+/**
+ * ht_insert_take:
+ *      Insert a key value pair the table adopts as they are, without calling
+ * key_copy or val_copy, and frees with key_free and val_free. Replacing the
+ * value of a key already there frees the old value and the key passed in.
+ * Returns false, leaving both with the caller, if the key does not fit or out
+ * of memory.
+ *      Inline values are copied as usual. Arena, length aware and pair_copy
+ * tables allocate their entries themselves and return false.
+ */
+bool ht_insert_take(ht_t *ht, void *key, void *val) {
+    const void **slot = NULL;
+    bool added = false;
+    ht_key_t k;
+
+    if (!ht || !key || !__ht_can_take(ht)) {
+        return false;
+    }
+
+    __ht_key_view(ht, &k, key);
+    k.take = true;
+
+    slot = __ht_get_or_insert(ht, &k, &added);
+    if (!slot) {
+        return false;
+    }
+
+    if (!added) {
+        __ht_key_free(ht, key);
+        __ht_val_free(ht, *slot);
+    }
+
+    *slot = ht->val_inline ? __ht_val_copy(ht, val) : val;
+
+    return true;
+}
+
+/**
+ * ht_insert_many:
+ *      Insert n key value pairs at once, as ht_insert would one by one. vals
+ * may be NULL to give every key a NULL value, NULL keys are skipped and so
+ * are new keys a table full at it's max capacity does not take. Returns the
+ * number of pairs stored, n less skipped and refused keys, the pairs of any
+ * key not stored are left out and the rest still go in.
+ *      The table is sized for all of them up front instead of growing as they
+ * go in, without reserving that size as ht_reserve does, and keys are taken
+ * INSERT_BATCH at a time, hashed and their buckets prefetched before any is
+ * added. With HT_INSERT_UNIQUE the caller promises no key is in the table or
+ * given twice, and keys are added without being looked for first.
+ */
+size_t ht_insert_many(ht_t *ht, const void *const *keys,
+                      const void *const *vals, size_t n, unsigned int flags) {
+    const bool unique = flags & HT_INSERT_UNIQUE;
+    ht_key_t k[INSERT_BATCH];
+    bool presized = false;
+    size_t stored = 0;
+
+    if (!ht || !keys) {
+        return 0;
+    }
+
+    // A table that can't be sized for the whole batch, past it's max
+    // capacity or out of memory, grows as the keys go in like ht_insert.
+    // Buckets prefetched ahead could move then, keys are only hashed ahead.
+    presized = n < MAX_CAPACITY && __ht_presize(ht, ht->used_buckets + n);
+
+    for (size_t base = 0; base < n; base += INSERT_BATCH) {
+        const size_t batch = n - base < INSERT_BATCH ? n - base : INSERT_BATCH;
+
+        for (size_t i = 0; i < batch; i++) {
+            if (keys[base + i]) {
+                __ht_key_view(ht, k + i, keys[base + i]);
+                if (presized) {
+                    __ht_prefetch(ht, k + i, false);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            if (keys[base + i] &&
+                __ht_insert(ht, k + i, vals ? vals[base + i] : NULL, unique)) {
+                stored++;
+            }
+        }
+    }
+
+    return stored;
+}
+
+/**
+ * __ht_remove_from_chain:
+ *      Remove a key from the indexed chain of a bucket, handing it's key and
+ * value to the caller through key and val where those are not NULL.
+ *      The entry of the node after the bucket is moved into the node of the
+ * removed key and that node is unlinked instead, so no chain walk is needed
+ * to find the node before it.
+ */
+static bool __ht_remove_from_chain(ht_t *ht, size_t idx, const ht_key_t *k,
+                                   const void **key, const void **val) {
+    ht_chain_t *chain = ht->chains[idx];
+    ht_bucket_t *node = NULL, *second = NULL;
+    size_t pos = 0;
+
+    node = __ht_chain_find(ht, chain, k, &pos);
+    if (!node) {
+        return false;
+    }
+
+    __ht_entry_release(ht, node->key, node->val, key, val);
+    __ht_chain_erase(chain, pos);
+
+    second = ht->buckets[idx].next;
+    if (node != second) {
+        node->key = second->key;
+        node->val = second->val;
+        node->hash = second->hash;
+        __ht_chain_repoint(ht, chain, second, node);
+    }
+
+    ht->buckets[idx].next = second->next;
+    __ht_pool_free(&ht->pool, second);
+    ht->used_buckets--;
+
+    if (chain->count < CHAIN_UNTREEIFY) {
+        __ht_untreeify(ht, idx);
+    }
+
+    return true;
+}
+
+/**
+ * __ht_remove_bucket:
+ *      Remove a key from the current buckets of a chained table, handing it's
+ * key and value to the caller as __ht_remove does.
+ */
+static bool __ht_remove_bucket(ht_t *ht, const ht_key_t *k, const void **key,
+                               const void **val) {
+    const size_t idx = __ht_bucket_index(k->hash, ht->capacity);
+    ht_bucket_t *cur = NULL, *prev = NULL;
+
+    if (!ht->buckets[idx].key) {
+        return false;
+    }
+
+    if (ht->chains && ht->chains[idx]) {
+        return __ht_remove_from_chain(ht, idx, k, key, val);
+    }
+
+    if (__ht_key_match(ht, k, ht->buckets[idx].hash, ht->buckets[idx].key)) {
+        __ht_entry_release(ht, ht->buckets[idx].key, ht->buckets[idx].val,
+                           key, val);
+
+        // The head bucket lives in the array, move the next entry of the
+        // chain into it whole and give back it's node
+        cur = ht->buckets[idx].next;
+        if (cur) {
+            ht->buckets[idx] = *cur;
+            __ht_pool_free(&ht->pool, cur);
+        } else {
+            ht->buckets[idx].key = NULL;
+            ht->buckets[idx].val = NULL;
+        }
+
+        ht->used_buckets--;
+
+        return true;
+    }
+
+    prev = ht->buckets + idx;
+    cur = prev->next;
+
+    while (cur) {
+        if (__ht_key_match(ht, k, cur->hash, cur->key)) {
+            prev->next = cur->next;
+            __ht_entry_release(ht, cur->key, cur->val, key, val);
+            __ht_pool_free(&ht->pool, cur);
+            ht->used_buckets--;
+            return true;
+        }
+
+        prev = cur;
+        cur = cur->next;
+    }
+
+    return false;
+}
+
+/**
+ * __ht_remove_old:
+ *      Remove a key from a chained table whose migration is paused, looking
+ * in the old bucket the key maps to first as __ht_find does. The old buckets
+ * are removed from through a copy of the table viewing them as it's current
+ * ones, sharing the table's chain node pool.
+ */
+static bool __ht_remove_old(ht_t *ht, const ht_key_t *k, const void **key,
+                            const void **val) {
+    const size_t idx = __ht_bucket_index(k->hash, ht->old_capacity);
+    ht_t old;
+    bool removed = false;
+
+    if (!ht->old_buckets[idx].key) {
+        return __ht_remove_bucket(ht, k, key, val);
+    }
+
+    old = *ht;
+    old.buckets = ht->old_buckets;
+    old.chains = ht->old_chains;
+    old.capacity = ht->old_capacity;
+    old.old_buckets = NULL;
+
+    removed = __ht_remove_bucket(&old, k, key, val);
+    ht->pool = old.pool;
+    ht->used_buckets = old.used_buckets;
+
+    return removed;
+}
+
+/**
+ * __ht_remove:
+ *      Remove a bucket from the table, handing it's key and value to the
+ * caller through key and val where those are not NULL. Returns false if the
+ * key is not there.
+ *      Step 1:
+ *            Get the bucket index using it's hash.
+ *      Step 2:
+ *            Check the bucket and chains for a key match.
+ *      Step 3:
+ *            Remove the entry if match is made.
+ *      Step 4:
+ *            Relink the chain if necessary.
+ */
+bool __ht_remove(ht_t *ht, const ht_key_t *k, const void **key,
+                 const void **val) {
+    switch (ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_remove(ht, k, key, val);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_remove(ht, k, key, val);
+    default:
+        break;
+    }
+
+    __ht_rehash_continue(ht);
+    __ht_rehash_key(ht, k->hash);
+
+    if (ht->old_buckets && ht->enumerators) {
+        return __ht_remove_old(ht, k, key, val);
+    }
+
+    return __ht_remove_bucket(ht, k, key, val);
+}
+
+/**
+ * ht_remove:
+ *      Remove a bucket from the table.
+ */
+void ht_remove(ht_t *ht, const void *key) {
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return;
+    }
+
+    __ht_key_view(ht, &k, key);
+    __ht_remove(ht, &k, NULL, NULL);
+    __ht_shrink(ht);
+}
+
+/**
+ * ht_remove_n:
+ *      Remove a key of len bytes from a table, the key needs no terminator.
+ */
+void ht_remove_n(ht_t *ht, const void *key, size_t len) {
+    char buf[KEY_BUF_SIZE];
+    const void *nul = NULL;
+    ht_key_t k;
+
+    if (!ht || !key || len > UINT32_MAX) {
+        return;
+    }
+
+    if (ht->keyeq_n) {
+        __ht_key_init(ht, &k, key, len);
+        __ht_remove(ht, &k, NULL, NULL);
+        __ht_shrink(ht);
+        return;
+    }
+
+    nul = __ht_key_nul(key, len, buf);
+    ht_remove(ht, nul);
+    if (nul != buf) {
+        free((void *)nul);
+    }
+}
+
+/**
+ * ht_remove_take:
+ *      Remove a key from the table, handing the key and value it stored to
+ * the caller through stored_key and val instead of freeing them. Either may
+ * be NULL to free that part as ht_remove does. Returns false if the key is
+ * not there.
+ *      Inline values are handed back in the bytes of *val. Arena, length
+ * aware and pair_copy tables own the storage of their entries and return
+ * false without removing anything.
+ */
+bool ht_remove_take(ht_t *ht, const void *key, void **stored_key,
+                    void **val) {
+    bool found = false;
+    ht_key_t k;
+
+    if (!ht || !key || !__ht_can_take(ht)) {
+        return false;
+    }
+
+    __ht_key_view(ht, &k, key);
+    found = __ht_remove(ht, &k, (const void **)stored_key, (const void **)val);
+    __ht_shrink(ht);
+
+    return found;
+}
+
+/**
+ * ht_take:
+ *      Remove a key from the table and return it's value, which the caller
+ * then frees, or NULL if the key is not there. See ht_remove_take.
+ */
+void *ht_take(ht_t *ht, const void *key) {
+    void *val = NULL;
+
+    return ht_remove_take(ht, key, NULL, &val) ? val : NULL;
+}
+
+/**
+ * __ht_get:
+ *      Get a table bucket value given it's key and a pointer to store it's
+ * value.
+ */
+bool __ht_get(const ht_t *ht, const ht_key_t *k, void **val) {
+    const ht_bucket_t *cur = NULL;
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_get(ht, k, val);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_get(ht, k, val);
+    default:
+        break;
+    }
+
+    // Lookups only read, a running incremental rehash is left to inserts
+    // and removals and the key is looked for in the old buckets too
+    cur = __ht_find(ht, k);
+    if (!cur) {
+        return false;
+    }
+
+    *val = __ht_val_ref(ht, &cur->val);
+
+    return true;
+}
+
+/**
+ * ht_get_many:
+ *      Get the values of n keys at once into vals, NULL for keys not found.
+ *      Keys are taken GET_BATCH at a time, all of them hashed and their
+ * buckets prefetched before the first is looked up, so the cache misses of a
+ * table much larger than the cache overlap instead of following each other.
+ *      Returns the number of keys found.
+ */
+size_t ht_get_many(const ht_t *ht, const void *const *keys, size_t n,
+                   void **vals) {
+    ht_key_t k[GET_BATCH];
+    size_t found = 0;
+
+    if (!ht || !keys || !vals) {
+        return 0;
+    }
+
+    for (size_t base = 0; base < n; base += GET_BATCH) {
+        const size_t batch = n - base < GET_BATCH ? n - base : GET_BATCH;
+
+        for (size_t i = 0; i < batch; i++) {
+            vals[base + i] = NULL;
+            if (keys[base + i]) {
+                __ht_key_view(ht, k + i, keys[base + i]);
+                __ht_prefetch(ht, k + i, false);
+            }
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            if (keys[base + i]) {
+                __ht_prefetch(ht, k + i, true);
+            }
+        }
+
+        for (size_t i = 0; i < batch; i++) {
+            if (keys[base + i] && __ht_get(ht, k + i, vals + base + i)) {
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * ht_get:
+ *      Get a table bucket value given it's key. It's a wrapper around __ht_get.
+ */
+void *ht_get(const ht_t *ht, const void *key) {
+    void *val = NULL;
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return NULL;
+    }
+
+    __ht_key_view(ht, &k, key);
+    __ht_get(ht, &k, &val);
+
+    return val;
+}
+
+/**
+ * ht_get_n:
+ *      Get the value of a key of len bytes, the key needs no terminator.
+ *      Lookups in tables made by ht_create_n use the key where it is, without
+ * copying it.
+ */
+void *ht_get_n(const ht_t *ht, const void *key, size_t len) {
+    char buf[KEY_BUF_SIZE];
+    const void *nul = NULL;
+    void *val = NULL;
+    ht_key_t k;
+
+    if (!ht || !key || len > UINT32_MAX) {
+        return NULL;
+    }
+
+    if (ht->keyeq_n) {
+        __ht_key_init(ht, &k, key, len);
+        __ht_get(ht, &k, &val);
+        return val;
+    }
+
+    nul = __ht_key_nul(key, len, buf);
+    val = ht_get(ht, nul);
+    if (nul != buf) {
+        free((void *)nul);
+    }
+
+    return val;
+}
+
+/**
+ * ht_hash_key:
+ *      Hash a key as the table does, for the _hashed variants of lookups,
+ * inserts and removals. The hash serves any table created with the same hash
+ * function and seed, see ht_share_seed, so a key probed against several
+ * tables is hashed once.
+ */
+ht_hashval_t ht_hash_key(const ht_t *ht, const void *key) {
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return 0;
+    }
+
+    __ht_key_view(ht, &k, key);
+
+    return k.hash;
+}
+
+/**
+ * ht_insert_hashed:
+ *      ht_insert with the key's hash from ht_hash_key. A hash not made by a
+ * table hashing alike files the key where lookups won't find it.
+ */
+bool ht_insert_hashed(ht_t *ht, const void *key, ht_hashval_t hash,
+                      const void *val) {
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return false;
+    }
+
+    __ht_key_hashed(ht, &k, key, hash);
+
+    return __ht_insert(ht, &k, val, false);
+}
+
+/**
+ * ht_remove_hashed:
+ *      ht_remove with the key's hash from ht_hash_key.
+ */
+void ht_remove_hashed(ht_t *ht, const void *key, ht_hashval_t hash) {
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return;
+    }
+
+    __ht_key_hashed(ht, &k, key, hash);
+    __ht_remove(ht, &k, NULL, NULL);
+    __ht_shrink(ht);
+}
+
+/**
+ * ht_get_hashed:
+ *      ht_get with the key's hash from ht_hash_key.
+ */
+void *ht_get_hashed(const ht_t *ht, const void *key, ht_hashval_t hash) {
+    void *val = NULL;
+    ht_key_t k;
+
+    if (!ht || !key) {
+        return NULL;
+    }
+
+    __ht_key_hashed(ht, &k, key, hash);
+    __ht_get(ht, &k, &val);
+
+    return val;
+}
+
+/**
+ * ht_enum_create:
+ *      Create a table enumeration object. It may be destroyed before or after
+ * the table, see ht_destroy.
+ */
+ht_enum_t *ht_enum_create(ht_t *ht) {
     ht_enum_t *he = NULL;
 
     if (!ht) {
@@ -470,10 +1825,31 @@ ht_enum_t *ht_enum_create(ht_t *ht) {
         return NULL;
     }
     he->ht = ht;
+    he->next = ht->enums;
+    if (ht->enums) {
+        ht->enums->prev = he;
+    }
+    ht->enums = he;
+    ht->enumerators++;
 
     return he;
 }
 
+/**
+ * __ht_enum_bucket:
+ *      Return the bucket at an enumeration position, the old buckets of an
+ * incremental rehash come first, or NULL past the last bucket.
+ */
+static ht_bucket_t *__ht_enum_bucket(const ht_t *ht, size_t idx) {
+    if (idx < ht->old_capacity) {
+        return ht->old_buckets + idx;
+    }
+
+    idx -= ht->old_capacity;
+
+    return idx < ht->capacity ? ht->buckets + idx : NULL;
+}
+
 /**
  * ht_enum_next:
  *      Get the key value information of the next bucket in a table.
@@ -492,7 +1868,7 @@ ht_enum_t *ht_enum_create(ht_t *ht) {
 bool ht_enum_next(ht_enum_t *he, const void **key, const void **val) {
     const void *mykey = NULL, *myval = NULL;
 
-    if (!he || he->idx >= he->ht->capacity) {
+    if (!he || !he->ht) {
         return false;
     }
 
@@ -504,26 +1880,65 @@ bool ht_enum_next(ht_enum_t *he, const void **key, const void **val) {
         val = &myval;
     }
 
+    switch (he->ht->engine) {
+    case HT_SWISS:
+        return __ht_swiss_enum_next(he, key, val);
+    case HT_ROBINHOOD:
+        return __ht_robinhood_enum_next(he, key, val);
+    default:
+        break;
+    }
+
     if (!he->cur) {
-        while (he->idx < he->ht->capacity && !he->ht->buckets[he->idx].key) {
+        while ((he->cur = __ht_enum_bucket(he->ht, he->idx)) &&
+               !he->cur->key) {
             he->idx++;
         }
 
-        if (he->idx >= he->ht->capacity) {
+        if (!he->cur) {
             return false;
         }
 
-        he->cur = he->ht->buckets + he->idx;
         he->idx++;
     }
 
     *key = he->cur->key;
-    *val = he->cur->val;
+    *val = __ht_val_ref(he->ht, &he->cur->val);
     he->cur = he->cur->next;
 
     return true;
 }
 
+/**
+ * __ht_foreach:
+ *      Call fn with the key and value fields of every entry of a table,
+ * including entries still waiting in old buckets.
+ */
+static void __ht_foreach(ht_t *ht, ht_entry_fn fn, void *ctx) {
+    ht_bucket_t *cur = NULL;
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        __ht_swiss_foreach(ht, fn, ctx);
+        return;
+    case HT_ROBINHOOD:
+        __ht_robinhood_foreach(ht, fn, ctx);
+        return;
+    default:
+        break;
+    }
+
+    for (size_t idx = 0; (cur = __ht_enum_bucket(ht, idx)); idx++) {
+        if (!cur->key) {
+            continue;
+        }
+
+        for (; cur; cur = cur->next) {
+            fn(&cur->key, &cur->val, ctx);
+        }
+    }
+}
+
 /**
  * ht_enum_destroy:
  *      Destroy an enumeration object.
@@ -533,6 +1948,369 @@ void ht_enum_destroy(ht_enum_t *he) {
         return;
     }
 
+    if (he->ht) {
+        if (he->prev) {
+            he->prev->next = he->next;
+        } else {
+            he->ht->enums = he->next;
+        }
+        if (he->next) {
+            he->next->prev = he->prev;
+        }
+        he->ht->enumerators--;
+    }
+
     free(he);
     he = NULL;
 }
+
+/**
+ * ht_set_rehash_step:
+ *      Set how many old buckets each insert and remove migrates while a
+ * chained table grows, bounding the work done by any one call. Lookups never
+ * migrate, so they stay reads threads can share. A step of 0
+ * migrates every bucket at once when the table grows. Tables created with
+ * HT_REHASH_INCREMENTAL start with a step of REHASH_STEP, open addressed
+ * tables always grow at once.
+ *      A step too small to finish a migration before the table's next growth
+ * is raised for that migration to old capacity / inserts left before it,
+ * rounded up, about 2 buckets per insert at the default load and growth.
+ */
+void ht_set_rehash_step(ht_t *ht, size_t steps) {
+    if (!ht) {
+        return;
+    }
+
+    ht->rehash_step = steps;
+}
+
+/**
+ * ht_set_resize_threads:
+ *      Set how many threads migrate the buckets of a chained table growing
+ * at once, when it grows, reserves or finishes an incremental rehash.
+ * Migrations are only split for tables of PARALLEL_MIN_BUCKETS or more
+ * buckets growing between power of two capacities, the default, and leave
+ * the table as one thread would. 0 or 1, the default, migrates on the calling
+ * thread, more than MAX_RESIZE_THREADS uses that many.
+ */
+void ht_set_resize_threads(ht_t *ht, size_t threads) {
+    if (!ht) {
+        return;
+    }
+
+    ht->resize_threads = threads;
+}
+
+/**
+ * __ht_set_options:
+ *      Apply sizing options to an empty chained table, 0 fields keep their
+ * defaults.
+ */
+static bool __ht_set_options(ht_t *ht, const ht_options_t *opts) {
+    size_t max = opts->max_capacity ? opts->max_capacity : MAX_CAPACITY;
+    size_t initial =
+        opts->initial_capacity ? opts->initial_capacity : INITIAL_BUCKETS;
+
+    max = max < MAX_CAPACITY ? max : MAX_CAPACITY;
+    initial = initial < max ? initial : max;
+
+    if (!__ht_new_buckets(ht, initial)) {
+        return false;
+    }
+
+    // The table is empty, release the old buckets
+    __ht_rehash_step(ht, ht->old_capacity);
+
+    ht->max_load =
+        opts->max_load_factor ? opts->max_load_factor : MAX_LOAD_FACTOR;
+    ht->growth = opts->growth_factor ? opts->growth_factor : GROWTH_FACTOR;
+    ht->initial_capacity = initial;
+    ht->max_capacity = max;
+
+    return true;
+}
+
+/**
+ * ht_set_options:
+ *      Give a table it's own sizing policy, so tables of cold data can be
+ * kept dense and tables on hot paths sparse in the same program. Only an
+ * empty table can change it's options, it is resized to the initial capacity
+ * and any reservation is dropped. Returns false for a table that isn't empty,
+ * a max load factor outside 0 to MAX_OPTION_LOAD, a growth factor outside 1
+ * to MAX_OPTION_GROWTH, or an initial capacity above the max capacity.
+ */
+bool ht_set_options(ht_t *ht, const ht_options_t *opts) {
+    bool set = false;
+
+    if (!ht || !opts || ht->used_buckets || ht->enumerators) {
+        return false;
+    }
+
+    // Written so NaN fails every check
+    if (!(opts->max_load_factor >= 0 &&
+          opts->max_load_factor <= MAX_OPTION_LOAD) ||
+        !(opts->growth_factor == 0 ||
+          (opts->growth_factor > 1 &&
+           opts->growth_factor <= MAX_OPTION_GROWTH)) ||
+        (opts->max_capacity && opts->initial_capacity > opts->max_capacity)) {
+        return false;
+    }
+
+    switch (ht->engine) {
+    case HT_SWISS:
+        set = __ht_swiss_set_options(ht, opts);
+        break;
+    case HT_ROBINHOOD:
+        set = __ht_robinhood_set_options(ht, opts);
+        break;
+    default:
+        set = __ht_set_options(ht, opts);
+        break;
+    }
+
+    if (set) {
+        ht->reserved = 0;
+    }
+
+    return set;
+}
+
+/**
+ * ht_get_options:
+ *      Store the sizing policy a table is using in opts, with defaults filled
+ * in and values rounded as the table's engine needs.
+ */
+void ht_get_options(const ht_t *ht, ht_options_t *opts) {
+    if (!ht || !opts) {
+        return;
+    }
+
+    opts->max_load_factor = ht->max_load;
+    opts->growth_factor = ht->growth;
+    opts->initial_capacity = ht->initial_capacity;
+    opts->max_capacity = ht->max_capacity;
+}
+
+/**
+ * ht_capacity:
+ *      Return the number of buckets or slots a table has now.
+ */
+size_t ht_capacity(const ht_t *ht) { return ht ? ht->capacity : 0; }
+
+/**
+ * ht_pool_stats:
+ *      Report how many collision chain nodes of a table are in use and how
+ * many are allocated but free for reuse. Open addressed tables have no chain
+ * nodes and report 0 for both.
+ */
+void ht_pool_stats(const ht_t *ht, size_t *live_nodes, size_t *free_nodes) {
+    if (live_nodes) {
+        *live_nodes = ht ? ht->pool.live : 0;
+    }
+
+    if (free_nodes) {
+        *free_nodes = ht ? ht->pool.free : 0;
+    }
+}
+
+/**
+ * ht_set_inline_val:
+ *      Store values of size bytes directly in the value field of each entry
+ * instead of calling the value copy and free callbacks. Inserts copy size
+ * bytes from the value pointer, a NULL value stores zeroes. Gets and
+ * enumeration return a pointer into the entry, valid until the table is next
+ * changed.
+ *      Only an empty table can switch, and only to values no bigger than a
+ * pointer, and not if it copies keys and values with pair_copy. Returns false
+ * if the table can't store values of size inline.
+ */
+bool ht_set_inline_val(ht_t *ht, size_t size) {
+    if (!ht || ht->used_buckets || size > sizeof(void *) ||
+        ht->callbacks.pair_copy) {
+        return false;
+    }
+
+    ht->val_inline = size;
+
+    return true;
+}
+
+/**
+ * ht_set_inline_keys:
+ *      Store keys of up to HT_KEY_INLINE - 1 bytes, 27, packed in the slots
+ * of an open addressed length aware table instead of allocating them.
+ * Lookups compare such keys without leaving the slot. With pair_copy a key
+ * is kept in it's slot together with it's string value while both fit, and
+ * packed with it in one allocation otherwise. Slots grow by HT_KEY_INLINE
+ * and a length to make room, to 56 bytes on 64 bit systems. Enumeration
+ * returns a pointer into the slot for inline keys, valid until the table is
+ * next changed.
+ *      Only an empty table made by ht_create_n on the Swiss or Robin Hood
+ * engine can switch, and not one using an arena. Returns false if the table
+ * can't store keys inline.
+ */
+bool ht_set_inline_keys(ht_t *ht) {
+    ht_slot_t *slots = NULL;
+
+    if (!ht || ht->used_buckets || !ht->keyeq_n || ht->arena ||
+        ht->engine == HT_CHAINED) {
+        return false;
+    }
+
+    slots = calloc(ht->capacity, sizeof(ht_islot_t));
+    if (!slots) {
+        perror("ht_set_inline_keys");
+        return false;
+    }
+
+    free(ht->slots);
+    ht->slots = slots;
+    ht->slot_size = sizeof(ht_islot_t);
+
+    return true;
+}
+
+/**
+ * ht_set_str_arena:
+ *      Copy the string keys of a table, and it's string values if vals is
+ * true, into chunks of a per-table arena instead of calling the copy and free
+ * callbacks they replace. Keys are stored packed, str_pack_len gives their
+ * length. Removed and replaced strings keep their space until ht_arena_compact
+ * is called, and ht_destroy frees every chunk at once.
+ *      Only an empty table can switch, not one storing keys inline, and not
+ * to string values if it stores values inline. Returns false if the table
+ * can't use an arena.
+ */
+bool ht_set_str_arena(ht_t *ht, bool vals) {
+    if (!ht || ht->used_buckets || ht->arena || (vals && ht->val_inline) ||
+        ht->slot_size > sizeof(ht_slot_t)) {
+        return false;
+    }
+
+    ht->arena = __ht_arena_create(vals);
+
+    return ht->arena != NULL;
+}
+
+/**
+ * ht_set_keycmp:
+ *      Order the keys of long collision chains with keycmp, a function
+ * returning less than, equal to or greater than zero like strcmp, and zero
+ * exactly for keys keyeq finds equal.
+ *      Chains of more than a few keys are indexed by the full hash of their
+ * keys whether or not a compare function is set, it is only needed to keep
+ * lookups logarithmic among keys whose full hashes collide.
+ *      Only an empty table made by ht_create can take one. Returns false
+ * otherwise.
+ */
+bool ht_set_keycmp(ht_t *ht, ht_keycmp keycmp) {
+    if (!ht || ht->used_buckets || ht->keyeq_n) {
+        return false;
+    }
+
+    ht->keycmp = keycmp;
+
+    return true;
+}
+
+/**
+ * ht_set_keycmp_n:
+ *      ht_set_keycmp for tables made by ht_create_n, keycmp is passed the
+ * length of each key.
+ */
+bool ht_set_keycmp_n(ht_t *ht, ht_keycmp_n keycmp) {
+    if (!ht || ht->used_buckets || !ht->keyeq_n) {
+        return false;
+    }
+
+    ht->keycmp_n = keycmp;
+
+    return true;
+}
+
+/**
+ * ht_share_seed:
+ *      Give an empty table the seed of another with the same hash function,
+ * so a hash from ht_hash_key of either serves both. Tables made with
+ * HT_SEED_RANDOM otherwise each draw their own seed.
+ */
+bool ht_share_seed(ht_t *ht, const ht_t *from) {
+    if (!ht || !from || ht->used_buckets || ht->hfunc != from->hfunc ||
+        ht->hfunc_n != from->hfunc_n) {
+        return false;
+    }
+
+    ht->seed = from->seed;
+
+    return true;
+}
+
+/**
+ * __ht_arena_move:
+ *      Copy the strings of an entry into the arena passed in ctx.
+ */
+static void __ht_arena_move(const void **key, const void **val, void *ctx) {
+    ht_arena_t *arena = ctx;
+
+    *key = __ht_arena_strdup(arena, *key, str_pack_len(*key), true);
+
+    if (arena->vals && *val) {
+        *val = __ht_arena_strdup(arena, *val, strlen(*val), false);
+    }
+}
+
+/**
+ * ht_arena_compact:
+ *      Copy the live strings of an arena table into a new arena and free the
+ * old one, giving back the space of removed and replaced strings. Entries keep
+ * their place and hash, only their string pointers change. Returns false if
+ * the table has no arena or a new one could not be allocated, the table is
+ * unchanged then.
+ */
+bool ht_arena_compact(ht_t *ht) {
+    ht_arena_t *arena = NULL;
+
+    if (!ht || !ht->arena) {
+        return false;
+    }
+
+    if (!ht->arena->dead) {
+        return true;
+    }
+
+    arena = __ht_arena_create(ht->arena->vals);
+    if (!arena) {
+        return false;
+    }
+
+    // Reserve the whole live size up front, so a failure can't leave the
+    // table split between two arenas
+    if (!__ht_arena_reserve(arena, ht->arena->used - ht->arena->dead)) {
+        __ht_arena_destroy(arena);
+        return false;
+    }
+
+    __ht_foreach(ht, __ht_arena_move, arena);
+    __ht_arena_destroy(ht->arena);
+    ht->arena = arena;
+
+    return true;
+}
+
+/**
+ * ht_arena_stats:
+ *      Report how many bytes of a table's arena hold strings and how many are
+ * held by removed or replaced strings that compaction would give back. Tables
+ * without an arena report 0 for both.
+ */
+void ht_arena_stats(const ht_t *ht, size_t *live_bytes, size_t *dead_bytes) {
+    const ht_arena_t *arena = ht ? ht->arena : NULL;
+
+    if (live_bytes) {
+        *live_bytes = arena ? arena->used - arena->dead : 0;
+    }
+
+    if (dead_bytes) {
+        *dead_bytes = arena ? arena->dead : 0;
+    }
+}
@@ -0,0 +1,183 @@
+/* ht_arena.c - Bump allocated string storage released with it's table.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024) // Bytes in a regular arena chunk
+#define ARENA_ALIGN (sizeof(void *)) // Alignment of every arena allocation
+
+/**
+ * __arena_size:
+ *      Return the number of arena bytes an allocation of size takes up.
+ */
+static size_t __arena_size(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+/**
+ * __arena_chunk:
+ *      Allocate a chunk with room for at least size bytes.
+ */
+static ht_chunk_t *__arena_chunk(size_t size) {
+    const size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    ht_chunk_t *chunk = malloc(sizeof(*chunk) + chunk_size);
+
+    if (!chunk) {
+        perror("__arena_chunk");
+        return NULL;
+    }
+
+    chunk->next = NULL;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+/**
+ * __arena_alloc:
+ *      Bump allocate size bytes from the newest chunk of an arena, starting a
+ * new chunk when it is full. Strings too big for a regular chunk get a chunk
+ * of their own behind the newest one, which keeps filling up.
+ */
+static void *__arena_alloc(ht_arena_t *arena, size_t size) {
+    ht_chunk_t *chunk = arena->chunks;
+
+    size = __arena_size(size);
+
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = __arena_chunk(size);
+        if (!chunk) {
+            return NULL;
+        }
+
+        if (arena->chunks && size > ARENA_CHUNK_SIZE) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+    }
+
+    chunk->used += size;
+    arena->used += size;
+
+    return chunk->data + chunk->used - size;
+}
+
+/**
+ * __ht_arena_create:
+ *      Create an empty arena, vals tells if values are stored in it as well
+ * as keys.
+ */
+ht_arena_t *__ht_arena_create(bool vals) {
+    ht_arena_t *arena = calloc(1, sizeof(*arena));
+
+    if (!arena) {
+        perror("__ht_arena_create");
+        return NULL;
+    }
+
+    arena->vals = vals;
+
+    return arena;
+}
+
+/**
+ * __ht_arena_destroy:
+ *      Free every chunk of an arena and the arena.
+ */
+void __ht_arena_destroy(ht_arena_t *arena) {
+    ht_chunk_t *chunk = NULL, *next = NULL;
+
+    if (!arena) {
+        return;
+    }
+
+    for (chunk = arena->chunks; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+
+    free(arena);
+}
+
+/**
+ * __ht_arena_reserve:
+ *      Make sure the newest chunk of an arena has size free bytes, so the next
+ * allocations adding up to size can't fail.
+ */
+bool __ht_arena_reserve(ht_arena_t *arena, size_t size) {
+    ht_chunk_t *chunk = arena->chunks;
+
+    if (chunk && chunk->size - chunk->used >= size) {
+        return true;
+    }
+
+    chunk = __arena_chunk(size);
+    if (!chunk) {
+        return false;
+    }
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+
+    return true;
+}
+
+/**
+ * __ht_arena_strdup:
+ *      Copy len bytes of a string into an arena and terminate the copy. Keys
+ * are copied as packed keys so their length is stored in front of them.
+ */
+const void *__ht_arena_strdup(ht_arena_t *arena, const char *s, size_t len,
+                              bool key) {
+    str_pack_t *pack = NULL;
+    char *p = NULL;
+
+    if (key) {
+        if (len >= STR_PACK_INLINE) {
+            return NULL;
+        }
+
+        pack = __arena_alloc(arena, sizeof(*pack) + len + 1);
+        if (!pack) {
+            return NULL;
+        }
+
+        pack->len = (uint32_t)len;
+        p = pack->str;
+    } else {
+        p = __arena_alloc(arena, len + 1);
+        if (!p) {
+            return NULL;
+        }
+    }
+
+    memcpy(p, s, len);
+    p[len] = '\0';
+
+    return p;
+}
+
+/**
+ * __ht_arena_release:
+ *      Account for a string of an arena that is no longer used. It's bytes
+ * are reclaimed by compaction or when the arena is destroyed.
+ */
+void __ht_arena_release(ht_arena_t *arena, const char *s, bool key) {
+    if (key) {
+        arena->dead += __arena_size(sizeof(str_pack_t) + str_pack_len(s) + 1);
+    } else {
+        arena->dead += __arena_size(strlen(s) + 1);
+    }
+}
@@ -0,0 +1,190 @@
+/* ht_casefold.c - Case folding and comparison of case insensitive keys.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <ctype.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Keys are compared 16 bytes at a time with SSE2 or NEON, 8 bytes at a time
+ * on other CPUs. ASCII letters are folded without a libc call, any byte with
+ * the top bit set goes through tolower so comparing agrees with strcasecmp in
+ * every locale. Keys shorter than a chunk are read as two overlapping chunks,
+ * or words, covering the whole key.
+ */
+
+#define FOLD_CHUNK (16) // Bytes compared per vector step
+
+/**
+ * __ht_fold_word_bytes:
+ *      Fold the case of the 8 bytes of a word holding non-ASCII bytes.
+ */
+uint64_t __ht_fold_word_bytes(uint64_t v) {
+    unsigned char *p = (unsigned char *)&v;
+
+    for (size_t i = 0; i < sizeof(v); i++) {
+        p[i] = (unsigned char)tolower(p[i]);
+    }
+
+    return v;
+}
+
+#if defined(__SSE2__)
+
+/**
+ * __fold_chunk:
+ *      Fold the case of 16 bytes, returning a mask of the bytes that are not
+ * ASCII and were left as they are.
+ */
+static inline unsigned int __fold_chunk(const unsigned char *src,
+                                        __m128i *out) {
+    const __m128i v = _mm_loadu_si128((const __m128i *)src);
+
+    // 'A'..'Z' become the 26 smallest signed bytes, non-ASCII ones don't
+    const __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8(0x3f));
+    const __m128i upper =
+        _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+
+    *out = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+
+    return (unsigned int)_mm_movemask_epi8(v);
+}
+
+/**
+ * __fold_chunk_eq:
+ *      Compare two folded chunks.
+ */
+static inline bool __fold_chunk_eq(__m128i a, __m128i b) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF;
+}
+
+#define FOLD_VECTOR __m128i
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+/**
+ * __fold_chunk:
+ *      Fold the case of 16 bytes, returning non zero if any of them is not
+ * ASCII and was left as it is.
+ */
+static inline unsigned int __fold_chunk(const unsigned char *src,
+                                        uint8x16_t *out) {
+    const uint8x16_t v = vld1q_u8(src);
+    const uint8x16_t upper =
+        vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(26));
+    const uint64x2_t w = vreinterpretq_u64_u8(v);
+
+    *out = vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+
+    return ((vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1)) & HT_FOLD_HIGH) != 0;
+}
+
+/**
+ * __fold_chunk_eq:
+ *      Compare two folded chunks.
+ */
+static inline bool __fold_chunk_eq(uint8x16_t a, uint8x16_t b) {
+    const uint64x2_t ne = vreinterpretq_u64_u8(veorq_u8(a, b));
+
+    return !(vgetq_lane_u64(ne, 0) | vgetq_lane_u64(ne, 1));
+}
+
+#define FOLD_VECTOR uint8x16_t
+
+#endif
+
+/**
+ * __fold_word_eq:
+ *      Compare n bytes, 4 or 8, of two keys ignoring case.
+ *      Bytes may only differ in the case bit of letters, so the words are
+ * equal if every bit set in their difference is the case bit of a byte that
+ * is a letter once lowered.
+ */
+static inline bool __fold_word_eq(const unsigned char *a,
+                                  const unsigned char *b, size_t n) {
+    const uint64_t case_bits = HT_FOLD_HIGH >> 2;
+    uint64_t x = 0, y = 0, lower, letters;
+
+    memcpy(&x, a, n);
+    memcpy(&y, b, n);
+
+    if (x == y) {
+        return true;
+    }
+
+    if ((x | y) & HT_FOLD_HIGH) {
+        return __ht_fold_word_bytes(x) == __ht_fold_word_bytes(y);
+    }
+
+    // Top bit of each byte of x from 'a' to 'z' once lowered
+    lower = x | case_bits;
+    letters = (lower + 0x1f1f1f1f1f1f1f1f) & ~(lower + 0x0505050505050505);
+
+    return !((x ^ y) & ~((letters & HT_FOLD_HIGH) >> 2));
+}
+
+/**
+ * __ht_caseeq:
+ *      Compare len bytes of two keys ignoring case.
+ */
+bool __ht_caseeq(const unsigned char *a, const unsigned char *b, size_t len) {
+#if defined(FOLD_VECTOR)
+    FOLD_VECTOR va, vb;
+
+    if (len >= FOLD_CHUNK) {
+        for (size_t i = 0;; i += FOLD_CHUNK) {
+            if (i + FOLD_CHUNK > len) {
+                i = len - FOLD_CHUNK;
+            }
+
+            if (__fold_chunk(a + i, &va) | __fold_chunk(b + i, &vb)) {
+                for (size_t j = i; j < i + FOLD_CHUNK; j++) {
+                    if (tolower(a[j]) != tolower(b[j])) {
+                        return false;
+                    }
+                }
+            } else if (!__fold_chunk_eq(va, vb)) {
+                return false;
+            }
+
+            if (i + FOLD_CHUNK == len) {
+                return true;
+            }
+        }
+    }
+#endif
+
+    if (len >= 8) {
+        for (size_t i = 0; i + 8 < len; i += 8) {
+            if (!__fold_word_eq(a + i, b + i, 8)) {
+                return false;
+            }
+        }
+
+        return __fold_word_eq(a + len - 8, b + len - 8, 8);
+    }
+
+    if (len >= 4) {
+        return __fold_word_eq(a, b, 4) &&
+               __fold_word_eq(a + len - 4, b + len - 4, 4);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (a[i] != b[i] && tolower(a[i]) != tolower(b[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,219 @@
+/* ht_chain.c - Sorted indexes of long collision chains.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHAIN_INITIAL_NODES (16) // Node slots of a new index
+
+/*
+ * A chain that grows past CHAIN_TREEIFY entries gets an index, an array of
+ * pointers to it's nodes sorted by full hash and then by key with the table's
+ * key compare function. Lookups binary search the index, so a chain of n keys
+ * costs log n compares instead of n. Keys of equal hash are only ordered when
+ * the table has a key compare function, without one they are compared one by
+ * one, which only matters for keys whose full hashes collide.
+ *
+ * The nodes stay linked in the chain, enumeration and rehashing walk it as
+ * before. The index is dropped once the chain shrinks below CHAIN_UNTREEIFY.
+ */
+
+/**
+ * __chain_cmp:
+ *      Order a key against the key of a node, by hash and then, if the table
+ * has a key compare function, by key. Keys of equal hash compare equal
+ * otherwise.
+ */
+static int __chain_cmp(const ht_t *ht, const ht_key_t *k,
+                       const ht_bucket_t *node) {
+    if (k->hash != node->hash) {
+        return k->hash < node->hash ? -1 : 1;
+    }
+
+    if (ht->keycmp_n) {
+        return ht->keycmp_n(k->ptr, k->len, node->key,
+                            str_pack_len(node->key));
+    }
+
+    return ht->keycmp ? ht->keycmp(k->ptr, node->key) : 0;
+}
+
+/**
+ * __chain_lower_bound:
+ *      Return the position of the first node of an index not ordered before
+ * a key.
+ */
+static size_t __chain_lower_bound(const ht_t *ht, const ht_chain_t *chain,
+                                  const ht_key_t *k) {
+    size_t lo = 0, hi = chain->count;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (__chain_cmp(ht, k, chain->nodes[mid]) > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * __chain_node_key:
+ *      Fill in the key view of the key stored in a node.
+ */
+static void __chain_node_key(const ht_t *ht, const ht_bucket_t *node,
+                             ht_key_t *k) {
+    k->ptr = node->key;
+    k->len = ht->keyeq_n ? str_pack_len(node->key) : 0;
+    k->hash = node->hash;
+}
+
+/**
+ * __ht_chain_find:
+ *      Return the node of an index holding a key, or NULL if it is not in the
+ * chain. pos is set to the position of the node, or the position a node with
+ * the key would be inserted at.
+ */
+ht_bucket_t *__ht_chain_find(const ht_t *ht, const ht_chain_t *chain,
+                             const ht_key_t *k, size_t *pos) {
+    size_t i = __chain_lower_bound(ht, chain, k);
+
+    // Keys of equal hash in no particular order are compared one by one
+    for (; i < chain->count && chain->nodes[i]->hash == k->hash; i++) {
+        if (__ht_key_match(ht, k, chain->nodes[i]->hash,
+                           chain->nodes[i]->key)) {
+            *pos = i;
+            return chain->nodes[i];
+        }
+
+        if (ht->keycmp || ht->keycmp_n) {
+            break;
+        }
+    }
+
+    *pos = i;
+
+    return NULL;
+}
+
+/**
+ * __ht_chain_reserve:
+ *      Make room in an index for one more node, growing it if full.
+ */
+bool __ht_chain_reserve(ht_chain_t **chain) {
+    ht_chain_t *grown = NULL;
+    const size_t size = (*chain)->size * 2;
+
+    if ((*chain)->count < (*chain)->size) {
+        return true;
+    }
+
+    grown = realloc(*chain, sizeof(*grown) + size * sizeof(grown->nodes[0]));
+    if (!grown) {
+        perror("__ht_chain_reserve");
+        return false;
+    }
+
+    grown->size = size;
+    *chain = grown;
+
+    return true;
+}
+
+/**
+ * __ht_chain_insert:
+ *      Insert a node into an index with room for it at the position returned
+ * by __ht_chain_find.
+ */
+void __ht_chain_insert(ht_chain_t *chain, size_t pos, ht_bucket_t *node) {
+    memmove(chain->nodes + pos + 1, chain->nodes + pos,
+            (chain->count - pos) * sizeof(chain->nodes[0]));
+    chain->nodes[pos] = node;
+    chain->count++;
+}
+
+/**
+ * __ht_chain_erase:
+ *      Remove the node at a position of an index.
+ */
+void __ht_chain_erase(ht_chain_t *chain, size_t pos) {
+    chain->count--;
+    memmove(chain->nodes + pos, chain->nodes + pos + 1,
+            (chain->count - pos) * sizeof(chain->nodes[0]));
+}
+
+/**
+ * __ht_chain_repoint:
+ *      Point the index entry of an entry moved from node from to node to.
+ */
+void __ht_chain_repoint(const ht_t *ht, ht_chain_t *chain,
+                        const ht_bucket_t *from, ht_bucket_t *to) {
+    ht_key_t k;
+
+    __chain_node_key(ht, to, &k);
+
+    for (size_t i = __chain_lower_bound(ht, chain, &k); i < chain->count;
+         i++) {
+        if (chain->nodes[i] == from) {
+            chain->nodes[i] = to;
+            return;
+        }
+    }
+}
+
+/**
+ * __ht_chain_build:
+ *      Build the index of the chain starting at head, or return NULL if out
+ * of memory.
+ */
+ht_chain_t *__ht_chain_build(const ht_t *ht, ht_bucket_t *head) {
+    size_t size = CHAIN_INITIAL_NODES, count = 0;
+    ht_chain_t *chain = NULL;
+    ht_key_t k;
+
+    for (const ht_bucket_t *cur = head; cur; cur = cur->next) {
+        count++;
+    }
+
+    while (size < count) {
+        size *= 2;
+    }
+
+    chain = malloc(sizeof(*chain) + size * sizeof(chain->nodes[0]));
+    if (!chain) {
+        perror("__ht_chain_build");
+        return NULL;
+    }
+
+    chain->count = 0;
+    chain->size = size;
+
+    for (ht_bucket_t *cur = head; cur; cur = cur->next) {
+        __chain_node_key(ht, cur, &k);
+        __ht_chain_insert(chain, __chain_lower_bound(ht, chain, &k), cur);
+    }
+
+    return chain;
+}
+
+/**
+ * __ht_chains_free:
+ *      Free the indexes of an array of capacity buckets and the array.
+ */
+void __ht_chains_free(ht_chain_t **chains, size_t capacity) {
+    for (size_t i = 0; chains && i < capacity; i++) {
+        free(chains[i]);
+    }
+
+    free(chains);
+}
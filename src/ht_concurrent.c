@@ -0,0 +1,395 @@
+/* ht_concurrent.c - Lock striped hash table shared by many threads.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CACHE_LINE (64)     // Bytes of a cache line, shards are padded to it
+#define SHARDS_PER_CPU (4)  // Default shards for each online CPU
+#define MIN_SHARDS (16)     // Fewest shards a table gets by default
+#define MAX_SHARDS (65536)  // Most shards a table can have
+#define HASH_BITS (sizeof(ht_hashval_t) * 8)
+#define SHARD_SIZE (sizeof(pthread_mutex_t) + sizeof(ht_t *))
+
+/*
+ * A concurrent table is an array of ordinary tables, it's shards, each behind
+ * it's own mutex. The top bits of the hash of a key pick it's shard and the
+ * shard places the key by the low bits, so keys spread evenly over the
+ * buckets of every shard. Threads working on keys of different shards never
+ * wait for each other, and each shard grows and shrinks on it's own under
+ * it's lock.
+ *
+ * Every shard uses the seed of the first, so a key is hashed once to find
+ * both it's shard and it's place in the shard.
+ */
+
+typedef struct {
+    pthread_mutex_t lock;
+    ht_t *ht;
+    char pad[CACHE_LINE - SHARD_SIZE % CACHE_LINE]; // No two locks share a
+                                                    // cache line
+} ht_shard_t;
+
+struct ht_concurrent { // typedefed to ht_concurrent_t in ht.h
+    ht_shard_t *shards;
+    size_t count;       // Number of shards, a power of two
+    unsigned int shift; // Hash bits below the shard index
+};
+
+struct ht_concurrent_enum { // typedefed to ht_concurrent_enum_t in ht.h
+    ht_concurrent_t *ct;
+    ht_enum_t *he; // Enumerator of the locked shard, NULL between shards
+    size_t shard;  // Shard being enumerated
+    size_t end;    // Shard to stop before
+};
+
+/**
+ * __shard_count:
+ *      Round a requested number of shards up to a power of two, or pick one
+ * from the number of online CPUs for 0.
+ */
+static size_t __shard_count(size_t shards) {
+    size_t count = 1;
+
+    if (!shards) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        shards = cpus > 0 ? (size_t)cpus * SHARDS_PER_CPU : MIN_SHARDS;
+        shards = shards > MIN_SHARDS ? shards : MIN_SHARDS;
+        shards = shards < MAX_SHARDS ? shards : MAX_SHARDS;
+    } else if (shards > MAX_SHARDS) {
+        return 0;
+    }
+
+    while (count < shards) {
+        count *= 2;
+    }
+
+    return count;
+}
+
+/**
+ * __shard_of:
+ *      Return the shard a key hash belongs to.
+ */
+static inline ht_shard_t *__shard_of(const ht_concurrent_t *ct,
+                                     ht_hashval_t hash) {
+    return ct->shards + (ct->shift < HASH_BITS ? (size_t)(hash >> ct->shift)
+                                               : 0);
+}
+
+/**
+ * __shard_key:
+ *      Fill in the key view of a key and return it's shard.
+ */
+static ht_shard_t *__shard_key(const ht_concurrent_t *ct, ht_key_t *k,
+                               const void *key) {
+    // The hash function and seed never change, reading them needs no lock
+    __ht_key_view(ct->shards[0].ht, k, key);
+
+    return __shard_of(ct, k->hash);
+}
+
+/**
+ * ht_concurrent_create:
+ *      Create a table many threads can use at once, split into shards, a
+ * power of two of them, each locked on it's own. 0 shards picks a number from
+ * the online CPUs. Callbacks and flags are those of ht_create, each shard is
+ * a table made with them. Returns NULL if out of memory or asked for more
+ * than MAX_SHARDS shards.
+ */
+ht_concurrent_t *ht_concurrent_create(const ht_hash hfunc,
+                                      const ht_keyeq keyeq,
+                                      const ht_callbacks_t *callbacks,
+                                      const unsigned int flags,
+                                      size_t shards) {
+    ht_concurrent_t *ct = NULL;
+    void *mem = NULL;
+    size_t bits = 0;
+
+    ct = calloc(1, sizeof(*ct));
+    if (!ct) {
+        perror("ht_concurrent_create");
+        return NULL;
+    }
+
+    ct->count = __shard_count(shards);
+    if (!ct->count) {
+        free(ct);
+        return NULL;
+    }
+
+    if (posix_memalign(&mem, CACHE_LINE, ct->count * sizeof(*ct->shards))) {
+        perror("ht_concurrent_create");
+        free(ct);
+        return NULL;
+    }
+    ct->shards = mem;
+
+    while (((size_t)1 << bits) < ct->count) {
+        bits++;
+    }
+    ct->shift = (unsigned int)(HASH_BITS - bits);
+
+    for (size_t i = 0; i < ct->count; i++) {
+        ht_shard_t *shard = ct->shards + i;
+
+        shard->ht = ht_create(hfunc, keyeq, callbacks, flags);
+        if (!shard->ht) {
+            ct->count = i;
+            ht_concurrent_destroy(ct);
+            return NULL;
+        }
+
+        shard->ht->seed = ct->shards[0].ht->seed;
+        pthread_mutex_init(&shard->lock, NULL);
+    }
+
+    return ct;
+}
+
+/**
+ * ht_concurrent_destroy:
+ *      Destroy a concurrent table, no other thread may be using it. Unlike
+ * those of plain tables, it's enumerators hold a shard locked and must be
+ * destroyed first.
+ */
+void ht_concurrent_destroy(ht_concurrent_t *ct) {
+    if (!ct) {
+        return;
+    }
+
+    for (size_t i = 0; i < ct->count; i++) {
+        pthread_mutex_destroy(&ct->shards[i].lock);
+        ht_destroy(ct->shards[i].ht);
+    }
+
+    free(ct->shards);
+    free(ct);
+}
+
+/**
+ * ht_concurrent_shards:
+ *      Return the number of shards of a concurrent table.
+ */
+size_t ht_concurrent_shards(const ht_concurrent_t *ct) {
+    return ct ? ct->count : 0;
+}
+
+/**
+ * ht_concurrent_insert:
+ *      Insert a key value pair, locking only the shard of the key. Returns
+ * false if out of memory or the shard is full at it's max capacity.
+ */
+bool ht_concurrent_insert(ht_concurrent_t *ct, const void *key,
+                          const void *val) {
+    ht_shard_t *shard = NULL;
+    bool stored = false;
+    ht_key_t k;
+
+    if (!ct || !key) {
+        return false;
+    }
+
+    shard = __shard_key(ct, &k, key);
+
+    pthread_mutex_lock(&shard->lock);
+    stored = __ht_insert(shard->ht, &k, val, false);
+    pthread_mutex_unlock(&shard->lock);
+
+    return stored;
+}
+
+/**
+ * ht_concurrent_remove:
+ *      Remove a key, locking only the shard of the key.
+ */
+void ht_concurrent_remove(ht_concurrent_t *ct, const void *key) {
+    ht_shard_t *shard = NULL;
+    ht_key_t k;
+
+    if (!ct || !key) {
+        return;
+    }
+
+    shard = __shard_key(ct, &k, key);
+
+    pthread_mutex_lock(&shard->lock);
+    __ht_remove(shard->ht, &k, NULL, NULL);
+    __ht_shrink(shard->ht);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/**
+ * ht_concurrent_get:
+ *      Get the value of a key, locking only the shard of the key.
+ *      The value is returned after the lock is released, so it is only safe
+ * to use while no other thread can remove or replace the key, or when the
+ * table stores values it doesn't free. Use ht_concurrent_get_with otherwise.
+ *      A shard storing values inline would hand out a pointer into it's
+ * entry, which any insert may move once unlocked, so NULL is returned for
+ * those and ht_concurrent_get_with is the only way to read them.
+ */
+void *ht_concurrent_get(ht_concurrent_t *ct, const void *key) {
+    ht_shard_t *shard = NULL;
+    void *val = NULL;
+    ht_key_t k;
+
+    if (!ct || !key) {
+        return NULL;
+    }
+
+    shard = __shard_key(ct, &k, key);
+
+    pthread_mutex_lock(&shard->lock);
+    if (!shard->ht->val_inline) {
+        __ht_get(shard->ht, &k, &val);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return val;
+}
+
+/**
+ * ht_concurrent_get_with:
+ *      Call fn with the value of a key and ctx while holding the lock of the
+ * key's shard, so the value can be read or copied out safely, inline values
+ * included. fn must not use the table. Returns false without calling fn if
+ * the key is not found.
+ */
+bool ht_concurrent_get_with(ht_concurrent_t *ct, const void *key, ht_visit fn,
+                            void *ctx) {
+    ht_shard_t *shard = NULL;
+    void *val = NULL;
+    bool found = false;
+    ht_key_t k;
+
+    if (!ct || !key || !fn) {
+        return false;
+    }
+
+    shard = __shard_key(ct, &k, key);
+
+    pthread_mutex_lock(&shard->lock);
+    found = __ht_get(shard->ht, &k, &val);
+    if (found) {
+        fn(val, ctx);
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+/**
+ * __ht_concurrent_enum_create:
+ *      Create an enumerator of shards first up to end.
+ */
+static ht_concurrent_enum_t *
+__ht_concurrent_enum_create(ht_concurrent_t *ct, size_t first, size_t end) {
+    ht_concurrent_enum_t *ce = calloc(1, sizeof(*ce));
+
+    if (!ce) {
+        perror("ht_concurrent_enum_create");
+        return NULL;
+    }
+
+    ce->ct = ct;
+    ce->shard = first;
+    ce->end = end;
+
+    return ce;
+}
+
+/**
+ * ht_concurrent_enum_create:
+ *      Create an enumerator of every entry of a concurrent table, visiting
+ * the shards in turn.
+ *      The shard being enumerated stays locked from the first entry of it
+ * until the enumerator moves past it or is destroyed, other shards can be
+ * used meanwhile. The enumerator must be used and destroyed by the thread
+ * creating it, which must not use the locked shard through the table.
+ */
+ht_concurrent_enum_t *ht_concurrent_enum_create(ht_concurrent_t *ct) {
+    return ct ? __ht_concurrent_enum_create(ct, 0, ct->count) : NULL;
+}
+
+/**
+ * ht_concurrent_shard_enum_create:
+ *      Create an enumerator of the entries of one shard of a concurrent
+ * table, so threads can each enumerate shards of their own at the same time.
+ * The same rules apply as for ht_concurrent_enum_create. Returns NULL for a
+ * shard past ht_concurrent_shards.
+ */
+ht_concurrent_enum_t *ht_concurrent_shard_enum_create(ht_concurrent_t *ct,
+                                                      size_t shard) {
+    if (!ct || shard >= ct->count) {
+        return NULL;
+    }
+
+    return __ht_concurrent_enum_create(ct, shard, shard + 1);
+}
+
+/**
+ * ht_concurrent_enum_next:
+ *      Get the next key and value of a concurrent table enumeration, locking
+ * each shard as it is reached and unlocking it once done with.
+ */
+bool ht_concurrent_enum_next(ht_concurrent_enum_t *ce, const void **key,
+                             const void **val) {
+    ht_shard_t *shard = NULL;
+
+    if (!ce) {
+        return false;
+    }
+
+    while (ce->shard < ce->end) {
+        shard = ce->ct->shards + ce->shard;
+
+        if (!ce->he) {
+            pthread_mutex_lock(&shard->lock);
+            ce->he = ht_enum_create(shard->ht);
+            if (!ce->he) {
+                pthread_mutex_unlock(&shard->lock);
+                return false;
+            }
+        }
+
+        if (ht_enum_next(ce->he, key, val)) {
+            return true;
+        }
+
+        ht_enum_destroy(ce->he);
+        ce->he = NULL;
+        pthread_mutex_unlock(&shard->lock);
+        ce->shard++;
+    }
+
+    return false;
+}
+
+/**
+ * ht_concurrent_enum_destroy:
+ *      Destroy a concurrent table enumerator, unlocking the shard it is in.
+ * The table must not have been destroyed yet.
+ */
+void ht_concurrent_enum_destroy(ht_concurrent_enum_t *ce) {
+    if (!ce) {
+        return;
+    }
+
+    if (ce->he) {
+        ht_enum_destroy(ce->he);
+        pthread_mutex_unlock(&ce->ct->shards[ce->shard].lock);
+    }
+
+    free(ce);
+}
@@ -6,7 +6,7 @@
  * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
  */
 
-#include "ht.h"
+#include "ht_private.h"
 
 #include <ctype.h>
 #include <stdbool.h>
@@ -51,6 +51,46 @@ uint32_t fnv1a_hash_str_casecmp(const void *key, uint32_t seed) {
     return __fnv1a_hash(key, seed, true);
 }
 
+/**
+ * __fnv1a_hash_n:
+ *      Return a hash of len bytes of key using the 32 bit FNV1A algorithm.
+ *      Hashes equal those of __fnv1a_hash for the same string.
+ */
+static uint32_t __fnv1a_hash_n(const void *key, size_t len, uint32_t seed,
+                               bool ignore_case) {
+    const unsigned char *p = key;
+    uint32_t h, c;
+
+    h = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        c = (uint32_t)p[i];
+        if (ignore_case) {
+            c = tolower(c);
+        }
+        h ^= (uint32_t)c;
+        h *= FNV1A_PRIME;
+    }
+
+    return h;
+}
+
+/**
+ * fnv1a_hash_str_n:
+ *      Wrapper around __fnv1a_hash_n that uses case sensitive keys.
+ */
+uint32_t fnv1a_hash_str_n(const void *key, size_t len, uint32_t seed) {
+    return __fnv1a_hash_n(key, len, seed, false);
+}
+
+/**
+ * fnv1a_hash_str_casecmp_n:
+ *      Wrapper around __fnv1a_hash_n that uses case insensitive keys.
+ */
+uint32_t fnv1a_hash_str_casecmp_n(const void *key, size_t len, uint32_t seed) {
+    return __fnv1a_hash_n(key, len, seed, true);
+}
+
 #else
 
 /**
@@ -90,6 +130,46 @@ uint64_t fnv1a_hash_str_casecmp(const void *key, uint64_t seed) {
     return __fnv1a_hash(key, seed, true);
 }
 
+/**
+ * __fnv1a_hash_n:
+ *      Return a hash of len bytes of key using the 64 bit FNV1A algorithm.
+ *      Hashes equal those of __fnv1a_hash for the same string.
+ */
+static uint64_t __fnv1a_hash_n(const void *key, size_t len, uint64_t seed,
+                               bool ignore_case) {
+    const unsigned char *p = key;
+    uint64_t h, c;
+
+    h = seed;
+
+    for (size_t i = 0; i < len; i++) {
+        c = (uint64_t)p[i];
+        if (ignore_case) {
+            c = tolower(c);
+        }
+        h ^= (uint64_t)c;
+        h *= FNV1A_PRIME;
+    }
+
+    return h;
+}
+
+/**
+ * fnv1a_hash_str_n:
+ *      Wrapper around __fnv1a_hash_n that uses case sensitive keys.
+ */
+uint64_t fnv1a_hash_str_n(const void *key, size_t len, uint64_t seed) {
+    return __fnv1a_hash_n(key, len, seed, false);
+}
+
+/**
+ * fnv1a_hash_str_casecmp_n:
+ *      Wrapper around __fnv1a_hash_n that uses case insensitive keys.
+ */
+uint64_t fnv1a_hash_str_casecmp_n(const void *key, size_t len, uint64_t seed) {
+    return __fnv1a_hash_n(key, len, seed, true);
+}
+
 #endif
 
 /**
@@ -107,3 +187,65 @@ bool str_eq(const void *a, const void *b) {
 bool str_caseeq(const void *a, const void *b) {
     return (strcasecmp(a, b) == 0) ? true : false;
 }
+
+/**
+ * str_eq_n:
+ *      Case sensitive comparison of two keys of known length.
+ */
+bool str_eq_n(const void *a, size_t alen, const void *b, size_t blen) {
+    return alen == blen && memcmp(a, b, alen) == 0;
+}
+
+/**
+ * str_caseeq_n:
+ *      Case insensitive comparison of two keys of known length.
+ */
+bool str_caseeq_n(const void *a, size_t alen, const void *b, size_t blen) {
+    return alen == blen && __ht_caseeq(a, b, alen);
+}
+
+/**
+ * str_cmp:
+ *      String ordering function, orders keys like strcmp.
+ */
+int str_cmp(const void *a, const void *b) { return strcmp(a, b); }
+
+/**
+ * str_casecmp:
+ *      Case insensitive string ordering function.
+ */
+int str_casecmp(const void *a, const void *b) { return strcasecmp(a, b); }
+
+/**
+ * str_cmp_n:
+ *      Ordering of two keys of known length, a key orders before the longer
+ * keys it is the start of.
+ */
+int str_cmp_n(const void *a, size_t alen, const void *b, size_t blen) {
+    const int r = memcmp(a, b, alen < blen ? alen : blen);
+
+    if (r) {
+        return r;
+    }
+
+    return (alen > blen) - (alen < blen);
+}
+
+/**
+ * str_casecmp_n:
+ *      Case insensitive ordering of two keys of known length.
+ */
+int str_casecmp_n(const void *a, size_t alen, const void *b, size_t blen) {
+    const unsigned char *p = a, *q = b;
+    const size_t len = alen < blen ? alen : blen;
+
+    for (size_t i = 0; i < len; i++) {
+        const int r = tolower(p[i]) - tolower(q[i]);
+
+        if (r) {
+            return r;
+        }
+    }
+
+    return (alen > blen) - (alen < blen);
+}
@@ -0,0 +1,486 @@
+/* ht_mmap.c - Table snapshots looked up in place from a mapped file.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MMAP_VERSION (1)
+#define MMAP_BYTE_ORDER (0x01020304) // Reads back otherwise if swapped
+#define MMAP_WRITE_BUF ((size_t)1 << 20)
+
+/*
+ * A snapshot file holds a header, an array of slots, then the strings of
+ * every entry. Nothing in it is a pointer, slots refer to strings by their
+ * offset from the start of the file, so the file is looked up wherever it
+ * is mapped, and processes mapping it share it's pages in the page cache.
+ *
+ * Slots are a Robin Hood table built when saving, each with the full hash of
+ * it's key. A lookup hashes the key, probes from it's home slot comparing
+ * hashes, and stops at an empty slot or one closer to home than the probe.
+ * A key is stored as it's 32 bit length, 4 byte aligned, then it's bytes and
+ * a terminator, followed by it's value, a terminated string or, for inline
+ * values, it's bytes 8 byte aligned. The file ends with a zero byte so no
+ * string runs past it's end.
+ */
+
+static const char mmap_magic[8] = {'l', 'i', 'b', 'h', 't', 's', 'n', 'p'};
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint16_t version;
+    uint8_t hash_bits; // Width of the hashes of the saving build
+    uint8_t hash_kind; // Index of mmap_hashes
+    uint64_t val_inline;
+    uint64_t seed;
+    uint64_t count;
+    uint64_t capacity; // Slots, a power of two
+    uint64_t slots;    // Offset of the first slot
+    uint64_t size;     // Of the whole file
+} ht_mmap_header_t;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t key; // Offset of the key's length, 0 for an empty slot
+    uint64_t val; // Offset of the value, 0 for NULL
+} ht_mmap_slot_t;
+
+struct ht_mmap { // typedefed to ht_mmap_t in ht.h
+    const uint8_t *base;
+    size_t size;
+    const ht_mmap_slot_t *slots;
+    size_t mask;
+    size_t count;
+    size_t val_inline;
+    ht_hashval_t seed;
+    ht_hash_n hfunc_n;
+    ht_keyeq_n keyeq_n;
+};
+
+// Hash functions a snapshot can be looked up with, by the index saved in
+// it's header. Only ever append to keep older snapshots readable.
+static const struct {
+    ht_hash hfunc;
+    ht_hash_n hfunc_n;
+    ht_keyeq_n keyeq_n;
+} mmap_hashes[] = {
+    {fnv1a_hash_str, fnv1a_hash_str_n, str_eq_n},
+    {fnv1a_hash_str_casecmp, fnv1a_hash_str_casecmp_n, str_caseeq_n},
+    {wy_hash_str, wy_hash_str_n, str_eq_n},
+    {wy_hash_str_casecmp, wy_hash_str_casecmp_n, str_caseeq_n},
+    {sip_hash_str, sip_hash_str_n, str_eq_n},
+    {sip_hash_str_casecmp, sip_hash_str_casecmp_n, str_caseeq_n},
+};
+
+#define MMAP_HASHES (sizeof(mmap_hashes) / sizeof(mmap_hashes[0]))
+
+/**
+ * __mmap_hash_kind:
+ *      Return the index in mmap_hashes of the hash function of a table, or
+ * MMAP_HASHES if it has another one.
+ */
+static size_t __mmap_hash_kind(const ht_t *ht) {
+    size_t i = 0;
+
+    for (; i < MMAP_HASHES; i++) {
+        if (ht->hfunc_n ? ht->hfunc_n == mmap_hashes[i].hfunc_n
+                        : ht->hfunc == mmap_hashes[i].hfunc) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/**
+ * __mmap_place:
+ *      Place an entry in a Robin Hood slot array, displacing entries closer
+ * to their home slot.
+ */
+static void __mmap_place(ht_mmap_slot_t *slots, size_t mask,
+                         ht_mmap_slot_t entry) {
+    size_t idx = (size_t)entry.hash & mask, dist = 0;
+    ht_mmap_slot_t tmp;
+
+    while (slots[idx].key) {
+        const size_t d = (idx - (size_t)slots[idx].hash) & mask;
+
+        if (d < dist) {
+            tmp = slots[idx];
+            slots[idx] = entry;
+            entry = tmp;
+            dist = d;
+        }
+
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+
+    slots[idx] = entry;
+}
+
+/**
+ * __mmap_write:
+ *      Write len bytes at the end of a snapshot, zero padded to align, and
+ * return their offset, or 0 on error.
+ */
+static uint64_t __mmap_write(FILE *f, uint64_t *off, const void *buf,
+                             size_t len, size_t align) {
+    static const uint8_t zeros[8];
+    const size_t pad = (size_t)((align - *off % align) % align);
+    uint64_t at = 0;
+
+    if (fwrite(zeros, 1, pad, f) != pad || fwrite(buf, 1, len, f) != len) {
+        return 0;
+    }
+
+    at = *off + pad;
+    *off = at + len;
+
+    return at;
+}
+
+/**
+ * __mmap_write_entry:
+ *      Write the key and value of an entry at the end of a snapshot, filling
+ * in it's slot.
+ */
+static bool __mmap_write_entry(const ht_t *ht, FILE *f, uint64_t *off,
+                               ht_mmap_slot_t *slot, const void *key,
+                               const void *val) {
+    const size_t len = ht->keyeq_n ? str_pack_len(key) : strlen(key);
+    const uint32_t len32 = (uint32_t)len;
+
+    if (len > UINT32_MAX) {
+        return false;
+    }
+
+    slot->key = __mmap_write(f, off, &len32, sizeof(len32), 4);
+    if (!slot->key || !__mmap_write(f, off, key, len + 1, 1)) {
+        return false;
+    }
+
+    slot->val = 0;
+    if (ht->val_inline) {
+        slot->val = __mmap_write(f, off, val, ht->val_inline, 8);
+        return slot->val != 0;
+    }
+
+    if (val) {
+        slot->val = __mmap_write(f, off, val, strlen(val) + 1, 1);
+        return slot->val != 0;
+    }
+
+    return true;
+}
+
+/**
+ * __mmap_write_entries:
+ *      Write the strings of every entry of a table after room for the header
+ * and slots, filling in the slots. Returns the number of entries written, or
+ * more than the table holds on error.
+ */
+static size_t __mmap_write_entries(ht_t *ht, FILE *f, ht_mmap_slot_t *slots,
+                                   size_t capacity, uint64_t *off) {
+    ht_enum_t *he = ht_enum_create(ht);
+    const void *key = NULL, *val = NULL;
+    ht_mmap_slot_t slot;
+    size_t n = 0;
+    ht_key_t k;
+
+    *off = sizeof(ht_mmap_header_t) + capacity * sizeof(*slots);
+    if (!he || fseeko(f, (off_t)*off, SEEK_SET) != 0) {
+        ht_enum_destroy(he);
+        return SIZE_MAX;
+    }
+
+    while (n <= ht->used_buckets && ht_enum_next(he, &key, &val)) {
+        __ht_key_init(ht, &k, key,
+                      ht->keyeq_n ? str_pack_len(key) : strlen(key));
+        slot.hash = k.hash;
+        if (!__mmap_write_entry(ht, f, off, &slot, key, val)) {
+            n = SIZE_MAX;
+            break;
+        }
+        __mmap_place(slots, capacity - 1, slot);
+        n++;
+    }
+
+    ht_enum_destroy(he);
+
+    return n;
+}
+
+/**
+ * __mmap_write_file:
+ *      Write a snapshot of a table to f, see ht_save.
+ */
+static bool __mmap_write_file(ht_t *ht, FILE *f, size_t kind) {
+    ht_mmap_header_t header;
+    ht_mmap_slot_t *slots = NULL;
+    size_t capacity = 0, n = 0;
+    uint64_t off = 0;
+    bool ok = false;
+
+    // Keep the load at most 4/5
+    if (ht->used_buckets >= SIZE_MAX / 2 / sizeof(*slots)) {
+        return false;
+    }
+    capacity = __ht_pow2_ceil(ht->used_buckets + ht->used_buckets / 4 + 1);
+
+    slots = calloc(capacity, sizeof(*slots));
+    if (!slots) {
+        perror("__mmap_write_file");
+        return false;
+    }
+
+    n = __mmap_write_entries(ht, f, slots, capacity, &off);
+    if (n <= ht->used_buckets) {
+        memcpy(header.magic, mmap_magic, sizeof(header.magic));
+        header.byte_order = MMAP_BYTE_ORDER;
+        header.version = MMAP_VERSION;
+        header.hash_bits = sizeof(ht_hashval_t) * 8;
+        header.hash_kind = (uint8_t)kind;
+        header.val_inline = ht->val_inline;
+        header.seed = ht->seed;
+        header.count = n;
+        header.capacity = capacity;
+        header.slots = sizeof(header);
+        header.size = off + 1;
+
+        ok = fputc('\0', f) != EOF && fseeko(f, 0, SEEK_SET) == 0 &&
+             fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(slots, sizeof(*slots), capacity, f) == capacity;
+    }
+
+    free(slots);
+
+    return ok;
+}
+
+/**
+ * ht_save:
+ *      Write a snapshot of a table to path, for ht_open_mmap to look it up
+ * in place. The snapshot is written beside path and renamed over it once
+ * complete, so processes mapping an older one keep it.
+ *      Keys are saved as strings, with their length in length aware tables,
+ * and values as strings, or their bytes for tables with inline values. Only
+ * tables hashing keys with the fnv1a, wyhash or siphash string functions can
+ * be saved, the snapshot holds the seed to hash lookups with. Returns false
+ * if the table can't be saved or on a write error.
+ */
+bool ht_save(ht_t *ht, const char *path) {
+    size_t kind = 0;
+    char *tmp = NULL;
+    FILE *f = NULL;
+    bool ok = false;
+
+    if (!ht || !path) {
+        return false;
+    }
+
+    kind = __mmap_hash_kind(ht);
+    if (kind == MMAP_HASHES) {
+        return false;
+    }
+
+    tmp = malloc(strlen(path) + sizeof(".tmp"));
+    if (!tmp) {
+        perror("ht_save");
+        return false;
+    }
+    strcpy(tmp, path);
+    strcat(tmp, ".tmp");
+
+    f = fopen(tmp, "wb");
+    if (!f) {
+        perror("ht_save");
+        free(tmp);
+        return false;
+    }
+    setvbuf(f, NULL, _IOFBF, MMAP_WRITE_BUF);
+
+    ok = __mmap_write_file(ht, f, kind);
+    ok = fclose(f) == 0 && ok && rename(tmp, path) == 0;
+    if (!ok) {
+        perror("ht_save");
+        remove(tmp);
+    }
+
+    free(tmp);
+
+    return ok;
+}
+
+/**
+ * __mmap_header_ok:
+ *      Check the header of a mapped snapshot of size bytes.
+ */
+static bool __mmap_header_ok(const ht_mmap_header_t *h, size_t size) {
+    const uint64_t slots_end = h->slots + h->capacity * sizeof(ht_mmap_slot_t);
+
+    return size >= sizeof(*h) &&
+           memcmp(h->magic, mmap_magic, sizeof(h->magic)) == 0 &&
+           h->byte_order == MMAP_BYTE_ORDER && h->version == MMAP_VERSION &&
+           h->hash_bits == sizeof(ht_hashval_t) * 8 &&
+           h->hash_kind < MMAP_HASHES && h->val_inline <= sizeof(void *) &&
+           h->size == size && h->capacity && h->count < h->capacity &&
+           !(h->capacity & (h->capacity - 1)) &&
+           h->capacity <= size / sizeof(ht_mmap_slot_t) &&
+           h->slots == sizeof(*h) && slots_end <= size &&
+           ((const uint8_t *)h)[size - 1] == '\0';
+}
+
+/**
+ * ht_open_mmap:
+ *      Map a snapshot written by ht_save for read only lookups with
+ * ht_mmap_get. Opening only checks the header and maps the file, pages are
+ * read as lookups touch them. Returns NULL if the file can't be mapped or is
+ * not a snapshot this build can read.
+ */
+ht_mmap_t *ht_open_mmap(const char *path) {
+    const ht_mmap_header_t *h = NULL;
+    ht_mmap_t *hm = NULL;
+    void *base = MAP_FAILED;
+    struct stat st;
+    int fd = -1;
+
+    if (!path) {
+        return NULL;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("ht_open_mmap");
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(*h)) {
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    h = base;
+    if (!__mmap_header_ok(h, (size_t)st.st_size)) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+
+    hm = malloc(sizeof(*hm));
+    if (!hm) {
+        perror("ht_open_mmap");
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+
+    hm->base = base;
+    hm->size = (size_t)st.st_size;
+    hm->slots = (const ht_mmap_slot_t *)(hm->base + h->slots);
+    hm->mask = (size_t)h->capacity - 1;
+    hm->count = (size_t)h->count;
+    hm->val_inline = (size_t)h->val_inline;
+    hm->seed = (ht_hashval_t)h->seed;
+    hm->hfunc_n = mmap_hashes[h->hash_kind].hfunc_n;
+    hm->keyeq_n = mmap_hashes[h->hash_kind].keyeq_n;
+
+    return hm;
+}
+
+/**
+ * ht_mmap_close:
+ *      Unmap a snapshot, values looked up in it are gone with it.
+ */
+void ht_mmap_close(ht_mmap_t *hm) {
+    if (!hm) {
+        return;
+    }
+
+    munmap((void *)hm->base, hm->size);
+    free(hm);
+}
+
+/**
+ * __mmap_val:
+ *      Return the value of a slot, NULL for NULL values and offsets outside
+ * the file.
+ */
+static const void *__mmap_val(const ht_mmap_t *hm, const ht_mmap_slot_t *s) {
+    if (!s->val || s->val >= hm->size ||
+        hm->size - s->val < hm->val_inline) {
+        return NULL;
+    }
+
+    return hm->base + s->val;
+}
+
+/**
+ * ht_mmap_get:
+ *      Look a key up in a mapped snapshot. Returns the value within the
+ * mapping, a string or a pointer to the bytes of an inline value, or NULL if
+ * the key is not there.
+ */
+const void *ht_mmap_get(const ht_mmap_t *hm, const void *key) {
+    const ht_mmap_slot_t *s = NULL;
+    size_t len = 0, idx = 0;
+    ht_hashval_t hash = 0;
+    uint32_t stored = 0;
+
+    if (!hm || !key) {
+        return NULL;
+    }
+
+    len = strlen(key);
+    hash = hm->hfunc_n(key, len, hm->seed);
+    idx = (size_t)hash & hm->mask;
+
+    for (size_t dist = 0; dist <= hm->mask; dist++) {
+        s = hm->slots + idx;
+
+        if (!s->key || ((idx - (size_t)s->hash) & hm->mask) < dist) {
+            return NULL;
+        }
+
+        if (s->hash == (uint64_t)hash && s->key < hm->size - sizeof(stored)) {
+            memcpy(&stored, hm->base + s->key, sizeof(stored));
+            if (stored < hm->size - s->key - sizeof(stored) &&
+                hm->keyeq_n(key, len, hm->base + s->key + sizeof(stored),
+                            stored)) {
+                return __mmap_val(hm, s);
+            }
+        }
+
+        idx = (idx + 1) & hm->mask;
+    }
+
+    return NULL;
+}
+
+/**
+ * ht_mmap_count:
+ *      Return the number of entries of a mapped snapshot.
+ */
+size_t ht_mmap_count(const ht_mmap_t *hm) { return hm ? hm->count : 0; }
+
+/**
+ * ht_mmap_inline_val:
+ *      Return the size of the inline values of a mapped snapshot, 0 for
+ * string values.
+ */
+size_t ht_mmap_inline_val(const ht_mmap_t *hm) {
+    return hm ? hm->val_inline : 0;
+}
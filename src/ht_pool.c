@@ -0,0 +1,133 @@
+/* ht_pool.c - Slab allocator for collision chain nodes.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define POOL_INITIAL_NODES (64) // Nodes in a table's first slab
+#define POOL_MAX_NODES (4096)   // Slabs stop growing at this many nodes
+
+/**
+ * __ht_pool_grow:
+ *      Allocate a new slab and put all of it's nodes on the free list.
+ *      Each slab holds twice the nodes of the previous one up to
+ * POOL_MAX_NODES, so small tables stay small and big ones allocate rarely.
+ */
+static bool __ht_pool_grow(ht_pool_t *pool) {
+    const size_t nodes = pool->slab_nodes ? pool->slab_nodes
+                                          : POOL_INITIAL_NODES;
+    ht_slab_t *slab = NULL;
+
+    slab = malloc(sizeof(*slab) + nodes * sizeof(slab->nodes[0]));
+    if (!slab) {
+        perror("__ht_pool_grow");
+        return false;
+    }
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    for (size_t i = nodes; i > 0; i--) {
+        slab->nodes[i - 1].next = pool->free_list;
+        pool->free_list = slab->nodes + i - 1;
+    }
+
+    pool->free += nodes;
+    pool->slab_nodes = nodes < POOL_MAX_NODES ? nodes * 2 : POOL_MAX_NODES;
+
+    return true;
+}
+
+/**
+ * __ht_pool_alloc:
+ *      Take a zeroed chain node from the pool, or NULL if out of memory.
+ */
+ht_bucket_t *__ht_pool_alloc(ht_pool_t *pool) {
+    ht_bucket_t *node = NULL;
+
+    if (!pool->free_list && !__ht_pool_grow(pool)) {
+        return NULL;
+    }
+
+    node = pool->free_list;
+    pool->free_list = node->next;
+    pool->free--;
+    pool->live++;
+
+    node->key = NULL;
+    node->val = NULL;
+    node->hash = 0;
+    node->next = NULL;
+
+    return node;
+}
+
+/**
+ * __ht_pool_free:
+ *      Return a chain node to the pool's free list for reuse.
+ */
+void __ht_pool_free(ht_pool_t *pool, ht_bucket_t *node) {
+    node->key = NULL;
+    node->val = NULL;
+    node->next = pool->free_list;
+    pool->free_list = node;
+    pool->free++;
+    pool->live--;
+}
+
+/**
+ * __ht_pool_merge:
+ *      Move the slabs and free nodes of a pool into another, leaving it
+ * empty. Nodes may have been allocated from one and freed to the other, so
+ * the live counts are only meaningful summed.
+ */
+void __ht_pool_merge(ht_pool_t *pool, ht_pool_t *from) {
+    ht_slab_t **slab = &from->slabs;
+    ht_bucket_t **node = &from->free_list;
+
+    while (*slab) {
+        slab = &(*slab)->next;
+    }
+    *slab = pool->slabs;
+    pool->slabs = from->slabs;
+
+    while (*node) {
+        node = &(*node)->next;
+    }
+    *node = pool->free_list;
+    pool->free_list = from->free_list;
+
+    pool->live += from->live;
+    pool->free += from->free;
+    if (from->slab_nodes > pool->slab_nodes) {
+        pool->slab_nodes = from->slab_nodes;
+    }
+
+    memset(from, 0, sizeof(*from));
+}
+
+/**
+ * __ht_pool_destroy:
+ *      Release every slab of a pool at once, live nodes included.
+ */
+void __ht_pool_destroy(ht_pool_t *pool) {
+    ht_slab_t *slab = pool->slabs, *next = NULL;
+
+    while (slab) {
+        next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->live = 0;
+    pool->free = 0;
+}
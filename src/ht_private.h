@@ -0,0 +1,590 @@
+/* ht_private.h - Internal definitions shared by the hash table engines.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#ifndef __HT_PRIVATE_H__
+#define __HT_PRIVATE_H__
+
+#include "ht.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Storage engine backing a table, selected by ht_create flags
+typedef enum {
+    HT_CHAINED = 0, // Buckets with collision chains
+    HT_SWISS,       // Open addressing with SIMD probed control bytes
+    HT_ROBINHOOD,   // Open addressing with Robin Hood linear probing
+} ht_engine_t;
+
+typedef struct ht_bucket {
+    const void *key;
+    const void *val;
+    ht_hashval_t hash; // Full hash of key, reused when the table grows
+    struct ht_bucket *next;
+} ht_bucket_t;
+
+// Chain nodes are carved from slabs owned by their table
+typedef struct ht_slab {
+    struct ht_slab *next;
+    ht_bucket_t nodes[];
+} ht_slab_t;
+
+typedef struct ht_pool {
+    ht_slab_t *slabs;
+    ht_bucket_t *free_list; // Free nodes linked through their next pointer
+    size_t slab_nodes;      // Nodes in the next slab to allocate
+    size_t live;
+    size_t free;
+} ht_pool_t;
+
+// Nodes of a long collision chain sorted by hash and key, see ht_chain.c
+typedef struct ht_chain {
+    size_t count;
+    size_t size;
+    ht_bucket_t *nodes[];
+} ht_chain_t;
+
+typedef struct ht_slot {
+    const void *key;
+    const void *val;
+    ht_hashval_t hash;
+} ht_slot_t;
+
+#define HT_KEY_INLINE (28) // Bytes a slot has for an inline key and terminator
+
+/*
+ * A packed key is a single allocation holding the length of the key, the key
+ * and, for pairs, the value right after it:
+ *
+ *      [len][key\0][value\0]
+ *
+ * The key pointer handed to the table points at the key bytes, so packed keys
+ * are ordinary C strings to the hash, equality and enumeration code. Packing
+ * a key with it's value halves the allocations of a pair.
+ *
+ * Open addressed tables with inline keys give every slot room for a short
+ * packed key, see ht_set_inline_keys. Keys that fit, with their value for
+ * pairs, are packed into the slot itself and cost no allocation, lookups
+ * compare them without leaving the slot. Their length is marked
+ * STR_PACK_INLINE so freeing them does nothing.
+ */
+typedef struct str_pack {
+    uint32_t len;
+    char str[];
+} str_pack_t;
+
+#define STR_PACK_INLINE ((uint32_t)1 << 31) // Packed key kept in a slot
+
+// Packed key holding a key pointer
+#define STR_PACK(key)                                                          \
+    ((str_pack_t *)((char *)(key) - offsetof(str_pack_t, str)))
+
+// Slot of a table with inline keys, len and str lay out like a str_pack_t
+typedef struct ht_islot {
+    ht_slot_t slot;
+    uint32_t len;
+    char str[HT_KEY_INLINE];
+} ht_islot_t;
+
+// Slot idx of an array of slots size bytes each
+#define HT_SLOT(slots, size, idx)                                              \
+    ((ht_slot_t *)((char *)(slots) + (idx) * (size)))
+
+// Strings of an arena are bump allocated from chunks freed together
+typedef struct ht_chunk {
+    struct ht_chunk *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ht_chunk_t;
+
+typedef struct ht_arena {
+    ht_chunk_t *chunks; // Newest chunk first, allocations come from it
+    size_t used;        // Bytes handed out
+    size_t dead;        // Bytes of strings removed or replaced since
+    bool vals;          // Values are stored in the arena as well as keys
+} ht_arena_t;
+
+// Start loading memory a lookup is about to read into cache
+#if defined(__GNUC__) || defined(__clang__)
+#define HT_PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#define HT_PREFETCH(addr) ((void)(addr))
+#endif
+
+// A key being inserted, looked up or removed, with it's hash and, in length
+// aware tables, it's length
+typedef struct ht_key {
+    const void *ptr;
+    size_t len;
+    ht_hashval_t hash;
+    bool take; // A new entry adopts ptr and it's value instead of copies
+} ht_key_t;
+
+struct ht { // typedefed to ht_t in ht.h for external scope
+    ht_hash hfunc;
+    ht_keyeq keyeq;
+    // Length aware callbacks of tables made by ht_create_n, NULL otherwise
+    ht_hash_n hfunc_n;
+    ht_keyeq_n keyeq_n;
+    // Optional key ordering of long collision chains, see ht_set_keycmp
+    ht_keycmp keycmp;
+    ht_keycmp_n keycmp_n;
+    ht_callbacks_t callbacks;
+    size_t val_inline; // Size of values stored in the val field, 0 for none
+    ht_arena_t *arena; // String storage replacing the copy callbacks, or NULL
+    ht_engine_t engine;
+    ht_bucket_t *buckets;
+    ht_bucket_t *old_buckets; // Buckets being migrated by incremental rehash
+    ht_chain_t **chains;      // Indexes of long chains by bucket, or NULL
+    ht_chain_t **old_chains;  // Indexes of the old buckets
+    size_t old_capacity;
+    size_t rehash_idx;  // Next old bucket to migrate
+    size_t rehash_step; // Old buckets migrated per operation, 0 for all
+    size_t rehash_pace; // Step of the running migration, see __ht_rehash_pace
+    size_t resize_threads; // Threads migrating all old buckets at once
+    size_t enumerators; // Live enumeration objects, pauses migration
+    ht_enum_t *enums;   // The live enumeration objects, see ht_destroy
+    size_t reserved;    // Entries ht_reserve sized the table for
+    // Sizing policy, the effective values of ht_set_options
+    double max_load;
+    double growth;
+    size_t initial_capacity;
+    size_t max_capacity;
+    ht_pool_t pool;
+    uint8_t *ctrl;
+    ht_slot_t *slots;
+    size_t slot_size; // Bytes of each slot, sizeof(ht_islot_t) for inline keys
+    size_t capacity;
+    size_t used_buckets;
+    size_t growth_left;
+    ht_hashval_t seed;
+};
+
+// String arena (ht_arena.c)
+ht_arena_t *__ht_arena_create(bool);
+void __ht_arena_destroy(ht_arena_t *);
+bool __ht_arena_reserve(ht_arena_t *, size_t);
+const void *__ht_arena_strdup(ht_arena_t *, const char *, size_t, bool);
+void __ht_arena_release(ht_arena_t *, const char *, bool);
+
+// Packed keys of any bytes (ht_strpack.c)
+void *__ht_str_pack_ndup(const void *, size_t, const void *, const void **);
+void *__ht_str_pack_slot(ht_islot_t *, const void *, size_t, const void *,
+                         const void **);
+
+// Case folding (ht_casefold.c)
+#define HT_FOLD_HIGH (0x8080808080808080) // Top bit of each byte of a word
+uint64_t __ht_fold_word_bytes(uint64_t);
+bool __ht_caseeq(const unsigned char *, const unsigned char *, size_t);
+
+/**
+ * __ht_fold_word:
+ *      Fold the case of the 8 bytes of a word, ASCII letters all at once and
+ * other bytes with tolower.
+ */
+static inline uint64_t __ht_fold_word(uint64_t v) {
+    const uint64_t low7 = v & ~HT_FOLD_HIGH;
+    const uint64_t ge_a = low7 + 0x3f3f3f3f3f3f3f3f; // Top bit set from 'A'
+    const uint64_t gt_z = low7 + 0x2525252525252525; // Top bit set past 'Z'
+
+    if (v & HT_FOLD_HIGH) {
+        return __ht_fold_word_bytes(v);
+    }
+
+    return v | ((ge_a & ~gt_z & HT_FOLD_HIGH) >> 2);
+}
+
+struct ht_enum { // typedefed to ht_enum_t in ht.h for external scope
+    ht_t *ht; // NULL once the table is destroyed
+    ht_enum_t *prev, *next; // Other live enumeration objects of the table
+    ht_bucket_t *cur;
+    size_t idx;
+};
+
+/**
+ * __ht_val_copy:
+ *      Return a copy of a value to store in an entry. Inline values are copied
+ * into the bytes of the returned pointer itself.
+ */
+static inline const void *__ht_val_copy(const ht_t *ht, const void *val) {
+    const void *stored = NULL;
+
+    if (!ht->val_inline) {
+        if (!val) {
+            return NULL;
+        }
+
+        return ht->arena && ht->arena->vals
+                   ? __ht_arena_strdup(ht->arena, val, strlen(val), false)
+                   : ht->callbacks.val_copy(val);
+    }
+
+    if (val) {
+        memcpy(&stored, val, ht->val_inline);
+    }
+
+    return stored;
+}
+
+/**
+ * __ht_val_free:
+ *      Free the value stored in an entry. Inline values need no freeing and
+ * values copied by pair_copy are freed along with their key. Arena values
+ * are only accounted for until the arena is compacted or destroyed.
+ */
+static inline void __ht_val_free(const ht_t *ht, const void *val) {
+    if (!val || ht->val_inline) {
+        return;
+    }
+
+    if (ht->arena && ht->arena->vals) {
+        __ht_arena_release(ht->arena, val, false);
+    } else if (!ht->callbacks.pair_copy) {
+        ht->callbacks.val_free(val);
+    }
+}
+
+/**
+ * __ht_key_free:
+ *      Free the key stored in an entry. Length aware tables store packed keys
+ * they copied themselves.
+ */
+static inline void __ht_key_free(const ht_t *ht, const void *key) {
+    if (ht->arena) {
+        __ht_arena_release(ht->arena, key, true);
+    } else if (ht->keyeq_n) {
+        str_pack_free(key);
+    } else {
+        ht->callbacks.key_free(key);
+    }
+}
+
+/**
+ * __ht_key_init:
+ *      Fill in the key view of key, len bytes long in length aware tables,
+ * and hash it.
+ */
+static inline void __ht_key_init(const ht_t *ht, ht_key_t *k, const void *key,
+                                 size_t len) {
+    k->ptr = key;
+    k->len = len;
+    k->take = false;
+    k->hash = ht->hfunc_n ? ht->hfunc_n(key, len, ht->seed)
+                          : ht->hfunc(key, ht->seed);
+}
+
+/**
+ * __ht_key_match:
+ *      Tell if the key stored in an entry with hash is the key k. Entries with
+ * another hash, or in length aware tables another length, are told apart
+ * without calling the key equality function.
+ */
+static inline bool __ht_key_match(const ht_t *ht, const ht_key_t *k,
+                                  ht_hashval_t hash, const void *key) {
+    if (hash != k->hash) {
+        return false;
+    }
+
+    if (!ht->keyeq_n) {
+        return ht->keyeq(k->ptr, key);
+    }
+
+    return str_pack_len(key) == k->len &&
+           ht->keyeq_n(k->ptr, k->len, key, k->len);
+}
+
+/**
+ * __ht_entries_need_free:
+ *      Tell if destroying a table has to visit it's entries, tables keeping
+ * all their strings in an arena free them at once.
+ */
+static inline bool __ht_entries_need_free(const ht_t *ht) {
+    return !ht->arena || (!ht->arena->vals && !ht->val_inline);
+}
+
+/**
+ * __ht_can_take:
+ *      Tell if a table stores keys and values exactly as made by it's copy
+ * callbacks, so they can be handed over to it and back as they are. Arena,
+ * length aware and pair_copy tables allocate their entries themselves.
+ */
+static inline bool __ht_can_take(const ht_t *ht) {
+    return !ht->arena && !ht->keyeq_n && !ht->callbacks.pair_copy;
+}
+
+/**
+ * __ht_entry_release:
+ *      Free the key and value of a removed entry, or hand them to the caller
+ * through key and val where those are not NULL.
+ */
+static inline void __ht_entry_release(const ht_t *ht, const void *ekey,
+                                      const void *eval, const void **key,
+                                      const void **val) {
+    if (key) {
+        *key = ekey;
+    } else {
+        __ht_key_free(ht, ekey);
+    }
+
+    if (val) {
+        *val = eval;
+    } else {
+        __ht_val_free(ht, eval);
+    }
+}
+
+/**
+ * __ht_val_ref:
+ *      Return the value of an entry as handed out by gets and enumeration,
+ * a pointer to the entry's val field for inline values.
+ */
+static inline void *__ht_val_ref(const ht_t *ht, const void *const *val) {
+    return ht->val_inline ? (void *)val : (void *)*val;
+}
+
+/**
+ * __ht_entry_fill:
+ *      Store copies of a key and value in the key and val fields of a new
+ * entry.
+ *      Length aware tables copy keys as packed keys of their length instead
+ * of calling key_copy, and with pair_copy set pack string values with them.
+ * A key view marked take is stored as it is, along with it's value.
+ */
+static inline void __ht_entry_fill(const ht_t *ht, const void **ekey,
+                                   const void **eval, const ht_key_t *k,
+                                   const void *val) {
+    if (k->take) {
+        *ekey = k->ptr;
+        *eval = ht->val_inline ? __ht_val_copy(ht, val) : val;
+        return;
+    }
+
+    if (ht->arena) {
+        *ekey = __ht_arena_strdup(ht->arena, k->ptr,
+                                  ht->keyeq_n ? k->len : strlen(k->ptr), true);
+        *eval = __ht_val_copy(ht, val);
+        return;
+    }
+
+    if (ht->keyeq_n) {
+        if (ht->callbacks.pair_copy) {
+            *ekey = __ht_str_pack_ndup(k->ptr, k->len, val, eval);
+        } else {
+            *ekey = __ht_str_pack_ndup(k->ptr, k->len, NULL, NULL);
+            *eval = __ht_val_copy(ht, val);
+        }
+        return;
+    }
+
+    if (ht->callbacks.pair_copy) {
+        *ekey = ht->callbacks.pair_copy(k->ptr, val, eval);
+        return;
+    }
+
+    *ekey = ht->callbacks.key_copy(k->ptr);
+    *eval = __ht_val_copy(ht, val);
+}
+
+/**
+ * __ht_entry_set_val:
+ *      Replace the value of an entry with a copy of val. A key sharing it's
+ * allocation with the value is copied again along with the new value.
+ */
+static inline void __ht_entry_set_val(const ht_t *ht, const void **ekey,
+                                      const void **eval, const void *val) {
+    const void *key = NULL;
+
+    if (ht->callbacks.pair_copy && !ht->arena) {
+        key = ht->keyeq_n
+                  ? __ht_str_pack_ndup(*ekey, str_pack_len(*ekey), val, eval)
+                  : ht->callbacks.pair_copy(*ekey, val, eval);
+        __ht_key_free(ht, *ekey);
+        *ekey = key;
+        return;
+    }
+
+    __ht_val_free(ht, *eval);
+    *eval = __ht_val_copy(ht, val);
+}
+
+/**
+ * __ht_slot:
+ *      Return slot idx of an open addressed table.
+ */
+static inline ht_slot_t *__ht_slot(const ht_t *ht, size_t idx) {
+    return HT_SLOT(ht->slots, ht->slot_size, idx);
+}
+
+/**
+ * __ht_slot_move:
+ *      Copy the entry of slot src to slot dst. A key packed in src, and a
+ * value packed with it, are pointed at their copies in dst.
+ */
+static inline void __ht_slot_move(const ht_t *ht, ht_slot_t *dst,
+                                  const ht_slot_t *src) {
+    const char *str = ((const ht_islot_t *)src)->str;
+
+    if (ht->slot_size == sizeof(*src)) {
+        *dst = *src;
+        return;
+    }
+
+    *(ht_islot_t *)dst = *(const ht_islot_t *)src;
+
+    if (src->key == str) {
+        dst->key = ((ht_islot_t *)dst)->str;
+        if (ht->callbacks.pair_copy && src->val) {
+            dst->val = (const char *)dst->key + ((const char *)src->val - str);
+        }
+    }
+}
+
+/**
+ * __ht_slot_fill:
+ *      Store copies of a key and value in a new slot, packing the key into
+ * the slot when the table has inline keys and it fits, along with it's value
+ * for pairs.
+ */
+static inline void __ht_slot_fill(const ht_t *ht, ht_slot_t *slot,
+                                  const ht_key_t *k, const void *val) {
+    const bool pair = ht->callbacks.pair_copy != NULL;
+
+    if (ht->slot_size > sizeof(*slot)) {
+        slot->key = __ht_str_pack_slot((ht_islot_t *)slot, k->ptr, k->len,
+                                       val, pair ? &slot->val : NULL);
+        if (slot->key) {
+            if (!pair) {
+                slot->val = __ht_val_copy(ht, val);
+            }
+            return;
+        }
+    }
+
+    __ht_entry_fill(ht, &slot->key, &slot->val, k, val);
+}
+
+/**
+ * __ht_slot_set_val:
+ *      Replace the value of a slot with a copy of val. In tables with inline
+ * keys a pair moves into or out of the slot as the new value fits or not.
+ */
+static inline void __ht_slot_set_val(const ht_t *ht, ht_slot_t *slot,
+                                     const void *val) {
+    const void *key = NULL, *pval = NULL;
+    size_t len = 0;
+
+    if (ht->slot_size == sizeof(*slot) || !ht->callbacks.pair_copy) {
+        __ht_entry_set_val(ht, &slot->key, &slot->val, val);
+        return;
+    }
+
+    len = str_pack_len(slot->key);
+    key = __ht_str_pack_slot((ht_islot_t *)slot, slot->key, len, val, &pval);
+    if (!key) {
+        key = __ht_str_pack_ndup(slot->key, len, val, &pval);
+    }
+
+    if (key != slot->key) {
+        __ht_key_free(ht, slot->key);
+    }
+
+    slot->key = key;
+    slot->val = pval;
+}
+
+/**
+ * __ht_pow2_ceil:
+ *      Round a capacity of at most 2^31 up to a power of two.
+ */
+static inline size_t __ht_pow2_ceil(size_t n) {
+    size_t p = 1;
+
+    while (p < n) {
+        p <<= 1;
+    }
+
+    return p;
+}
+
+/**
+ * __ht_pow2_floor:
+ *      Round a capacity of at least 1 down to a power of two.
+ */
+static inline size_t __ht_pow2_floor(size_t n) {
+    size_t p = 1;
+
+    while (p <= n / 2) {
+        p <<= 1;
+    }
+
+    return p;
+}
+
+// Called with the key and value fields of each entry of a table
+typedef void (*ht_entry_fn)(const void **, const void **, void *);
+
+// Operations on a key view (ht.c), for wrappers that hash a key only once
+void __ht_key_view(const ht_t *, ht_key_t *, const void *);
+bool __ht_insert(ht_t *, const ht_key_t *, const void *, bool);
+bool __ht_remove(ht_t *, const ht_key_t *, const void **, const void **);
+bool __ht_get(const ht_t *, const ht_key_t *, void **);
+void __ht_shrink(ht_t *);
+
+// Long chain indexes (ht_chain.c)
+ht_bucket_t *__ht_chain_find(const ht_t *, const ht_chain_t *,
+                             const ht_key_t *, size_t *);
+bool __ht_chain_reserve(ht_chain_t **);
+void __ht_chain_insert(ht_chain_t *, size_t, ht_bucket_t *);
+void __ht_chain_erase(ht_chain_t *, size_t);
+void __ht_chain_repoint(const ht_t *, ht_chain_t *, const ht_bucket_t *,
+                        ht_bucket_t *);
+ht_chain_t *__ht_chain_build(const ht_t *, ht_bucket_t *);
+void __ht_chains_free(ht_chain_t **, size_t);
+
+// Chain node pool (ht_pool.c)
+ht_bucket_t *__ht_pool_alloc(ht_pool_t *);
+void __ht_pool_free(ht_pool_t *, ht_bucket_t *);
+void __ht_pool_merge(ht_pool_t *, ht_pool_t *);
+void __ht_pool_destroy(ht_pool_t *);
+
+// Swiss table engine (ht_swiss.c)
+bool __ht_swiss_init(ht_t *);
+void __ht_swiss_destroy(ht_t *);
+bool __ht_swiss_reserve(ht_t *, size_t);
+void __ht_swiss_shrink(ht_t *);
+bool __ht_swiss_shrink_to_fit(ht_t *);
+bool __ht_swiss_set_options(ht_t *, const ht_options_t *);
+bool __ht_swiss_insert(ht_t *, const ht_key_t *, const void *, bool);
+const void **__ht_swiss_get_or_insert(ht_t *, const ht_key_t *, bool *);
+bool __ht_swiss_remove(ht_t *, const ht_key_t *, const void **,
+                       const void **);
+bool __ht_swiss_get(const ht_t *, const ht_key_t *, void **);
+void __ht_swiss_prefetch(const ht_t *, const ht_key_t *, bool);
+bool __ht_swiss_enum_next(ht_enum_t *, const void **, const void **);
+void __ht_swiss_foreach(ht_t *, ht_entry_fn, void *);
+
+// Robin Hood engine (ht_robinhood.c)
+bool __ht_robinhood_init(ht_t *);
+void __ht_robinhood_destroy(ht_t *);
+bool __ht_robinhood_reserve(ht_t *, size_t);
+void __ht_robinhood_shrink(ht_t *);
+bool __ht_robinhood_shrink_to_fit(ht_t *);
+bool __ht_robinhood_set_options(ht_t *, const ht_options_t *);
+bool __ht_robinhood_insert(ht_t *, const ht_key_t *, const void *,
+                           bool);
+const void **__ht_robinhood_get_or_insert(ht_t *, const ht_key_t *, bool *);
+bool __ht_robinhood_remove(ht_t *, const ht_key_t *, const void **,
+                           const void **);
+bool __ht_robinhood_get(const ht_t *, const ht_key_t *, void **);
+void __ht_robinhood_prefetch(const ht_t *, const ht_key_t *, bool);
+bool __ht_robinhood_enum_next(ht_enum_t *, const void **, const void **);
+void __ht_robinhood_foreach(ht_t *, ht_entry_fn, void *);
+
+#endif // __HT_PRIVATE_H__
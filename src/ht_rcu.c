@@ -0,0 +1,577 @@
+/* ht_rcu.c - Read mostly hash table with lock free readers.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RCU_INITIAL_BUCKETS (16) // Initial and smallest table size
+#define RCU_MAX_LOAD_FACTOR (0.75)
+#define RCU_MAX_CAPACITY ((size_t)1 << 31)
+#define RCU_SHRINK_DIVISOR (8) // Tables halve below 1/8 load
+#define RCU_IDLE (0)           // Epoch of a reader outside a read section
+#define CACHE_LINE (64)        // Readers are padded to it
+
+/*
+ * Readers never lock or write anything shared. Entries are chain nodes that
+ * never change once published, writers, one at a time under a mutex, link a
+ * new node in front of a bucket or in place of the node it replaces with a
+ * single atomic store. Growing or shrinking copies the nodes into a new
+ * bucket array and publishes it with one atomic store, readers still walking
+ * the old array see the table as it was.
+ *
+ * Unlinked nodes and old bucket arrays are retired instead of freed, stamped
+ * with the global epoch. Entering a read section, a reader announces the
+ * epoch it saw in a cache line of it's own. Writers advance the epoch once
+ * every reader inside a read section has announced the current one, and free
+ * what was retired two epochs back, which no reader can still reach. key_free
+ * and val_free run then, not when the entry is removed.
+ */
+
+typedef struct ht_rcu_node {
+    const void *key;
+    const void *val;
+    ht_hashval_t hash;
+    struct ht_rcu_node *next; // Read by readers with atomic loads
+} ht_rcu_node_t;
+
+typedef struct {
+    size_t capacity;
+    ht_rcu_node_t *heads[]; // Read by readers with atomic loads
+} ht_rcu_buckets_t;
+
+typedef struct ht_rcu_retired {
+    struct ht_rcu_retired *next;
+    uint64_t epoch; // Global epoch when retired
+    void *ptr;
+    bool buckets; // A bucket array and it's nodes, or a node and it's entry
+} ht_rcu_retired_t;
+
+struct ht_rcu { // typedefed to ht_rcu_t in ht.h
+    ht_t *conf; // Empty table holding the hash, compare and copy setup
+    ht_rcu_buckets_t *buckets; // Swapped atomically by writers
+    size_t used_buckets;
+    uint64_t epoch; // Global epoch, advanced by writers
+    pthread_mutex_t write_lock;
+    ht_rcu_reader_t *readers;   // Registered readers, under write_lock
+    ht_rcu_retired_t *retired;  // Waiting to be freed, under write_lock
+};
+
+struct ht_rcu_reader { // typedefed to ht_rcu_reader_t in ht.h
+    uint64_t epoch; // Epoch seen entering a read section, RCU_IDLE outside
+    size_t nest;    // Read sections entered and not left
+    ht_rcu_t *rcu;
+    ht_rcu_reader_t *next;
+};
+
+/**
+ * __rcu_buckets_alloc:
+ *      Allocate an empty array of capacity buckets.
+ */
+static ht_rcu_buckets_t *__rcu_buckets_alloc(size_t capacity) {
+    ht_rcu_buckets_t *b = NULL;
+
+    b = calloc(1, sizeof(*b) + capacity * sizeof(b->heads[0]));
+    if (!b) {
+        perror("__rcu_buckets_alloc");
+        return NULL;
+    }
+
+    b->capacity = capacity;
+
+    return b;
+}
+
+/**
+ * __rcu_buckets_free:
+ *      Free a bucket array and it's nodes, and the entries of the nodes if
+ * entries is true.
+ */
+static void __rcu_buckets_free(const ht_rcu_t *rcu, ht_rcu_buckets_t *b,
+                               bool entries) {
+    ht_rcu_node_t *node = NULL, *next = NULL;
+
+    for (size_t i = 0; i < b->capacity; i++) {
+        for (node = b->heads[i]; node; node = next) {
+            next = node->next;
+            if (entries) {
+                __ht_key_free(rcu->conf, node->key);
+                __ht_val_free(rcu->conf, node->val);
+            }
+            free(node);
+        }
+    }
+
+    free(b);
+}
+
+/**
+ * __rcu_free_unreachable:
+ *      Free a bucket array or node no reader can reach anymore.
+ */
+static void __rcu_free_unreachable(const ht_rcu_t *rcu, void *ptr,
+                                   bool buckets) {
+    ht_rcu_node_t *node = ptr;
+
+    if (buckets) {
+        __rcu_buckets_free(rcu, ptr, false);
+    } else {
+        __ht_key_free(rcu->conf, node->key);
+        __ht_val_free(rcu->conf, node->val);
+        free(node);
+    }
+}
+
+/**
+ * __rcu_free_retired:
+ *      Free a retired bucket array or node.
+ */
+static void __rcu_free_retired(const ht_rcu_t *rcu, ht_rcu_retired_t *r) {
+    __rcu_free_unreachable(rcu, r->ptr, r->buckets);
+    free(r);
+}
+
+/**
+ * __rcu_try_advance:
+ *      Advance the global epoch if every reader in a read section has seen
+ * the current one.
+ */
+static void __rcu_try_advance(ht_rcu_t *rcu) {
+    const uint64_t epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_RELAXED);
+
+    // Unlinking stores must be visible before reader epochs are read
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (ht_rcu_reader_t *r = rcu->readers; r; r = r->next) {
+        const uint64_t seen = __atomic_load_n(&r->epoch, __ATOMIC_ACQUIRE);
+
+        if (seen != RCU_IDLE && seen != epoch) {
+            return;
+        }
+    }
+
+    __atomic_store_n(&rcu->epoch, epoch + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * __rcu_collect:
+ *      Advance the epoch if possible and free everything retired two or more
+ * epochs ago.
+ */
+static void __rcu_collect(ht_rcu_t *rcu) {
+    ht_rcu_retired_t **link = &rcu->retired, *r = NULL;
+    uint64_t epoch = 0;
+
+    if (!rcu->retired) {
+        return;
+    }
+
+    __rcu_try_advance(rcu);
+    epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_RELAXED);
+
+    while ((r = *link)) {
+        if (r->epoch + 2 <= epoch) {
+            *link = r->next;
+            __rcu_free_retired(rcu, r);
+        } else {
+            link = &r->next;
+        }
+    }
+}
+
+/**
+ * __rcu_synchronize:
+ *      Wait until everything retired can be freed and free it, the write
+ * lock held.
+ */
+static void __rcu_synchronize(ht_rcu_t *rcu) {
+    __rcu_collect(rcu);
+
+    while (rcu->retired) {
+        sched_yield();
+        __rcu_collect(rcu);
+    }
+}
+
+/**
+ * __rcu_grace_period:
+ *      Wait until the epoch has advanced twice, so every reader in a read
+ * section when it was called has left it, the write lock held.
+ */
+static void __rcu_grace_period(ht_rcu_t *rcu) {
+    const uint64_t epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_RELAXED);
+
+    __rcu_try_advance(rcu);
+
+    while (__atomic_load_n(&rcu->epoch, __ATOMIC_RELAXED) < epoch + 2) {
+        sched_yield();
+        __rcu_try_advance(rcu);
+    }
+}
+
+/**
+ * __rcu_retire:
+ *      Free a bucket array or node once no reader can reach it. Without
+ * memory to remember it, wait for the readers and free it right away.
+ */
+static void __rcu_retire(ht_rcu_t *rcu, void *ptr, bool buckets) {
+    ht_rcu_retired_t *r = malloc(sizeof(*r));
+
+    if (!r) {
+        perror("__rcu_retire");
+        __rcu_grace_period(rcu);
+        __rcu_free_unreachable(rcu, ptr, buckets);
+        __rcu_collect(rcu);
+        return;
+    }
+
+    r->epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_RELAXED);
+    r->ptr = ptr;
+    r->buckets = buckets;
+    r->next = rcu->retired;
+    rcu->retired = r;
+}
+
+/**
+ * __rcu_resize:
+ *      Copy every node into a new array of capacity buckets and publish it,
+ * retiring the old array with it's nodes. Returns false if out of memory, the
+ * table is left as it was.
+ */
+static bool __rcu_resize(ht_rcu_t *rcu, size_t capacity) {
+    ht_rcu_buckets_t *old = rcu->buckets, *b = NULL;
+    ht_rcu_node_t *copy = NULL;
+
+    b = __rcu_buckets_alloc(capacity);
+    if (!b) {
+        return false;
+    }
+
+    for (size_t i = 0; i < old->capacity; i++) {
+        for (const ht_rcu_node_t *node = old->heads[i]; node;
+             node = node->next) {
+            const size_t idx = (size_t)node->hash & (capacity - 1);
+
+            copy = malloc(sizeof(*copy));
+            if (!copy) {
+                perror("__rcu_resize");
+                __rcu_buckets_free(rcu, b, false);
+                return false;
+            }
+
+            *copy = *node;
+            copy->next = b->heads[idx];
+            b->heads[idx] = copy;
+        }
+    }
+
+    __atomic_store_n(&rcu->buckets, b, __ATOMIC_RELEASE);
+    __rcu_retire(rcu, old, true);
+
+    return true;
+}
+
+/**
+ * ht_rcu_create:
+ *      Create a table for data read far more often than it changes, such as
+ * configuration or routing tables. Lookups from any number of threads take no
+ * lock, writers take turns. Callbacks and flags are those of ht_create,
+ * engine flags are ignored.
+ */
+ht_rcu_t *ht_rcu_create(const ht_hash hfunc, const ht_keyeq keyeq,
+                        const ht_callbacks_t *callbacks,
+                        const unsigned int flags) {
+    ht_rcu_t *rcu = calloc(1, sizeof(*rcu));
+
+    if (!rcu) {
+        perror("ht_rcu_create");
+        return NULL;
+    }
+
+    rcu->conf = ht_create(hfunc, keyeq, callbacks,
+                          flags & ~(HT_ENGINE_SWISS | HT_ENGINE_ROBINHOOD));
+    rcu->buckets = __rcu_buckets_alloc(RCU_INITIAL_BUCKETS);
+    if (!rcu->conf || !rcu->buckets) {
+        ht_destroy(rcu->conf);
+        free(rcu->buckets);
+        free(rcu);
+        return NULL;
+    }
+
+    rcu->epoch = RCU_IDLE + 1;
+    pthread_mutex_init(&rcu->write_lock, NULL);
+
+    return rcu;
+}
+
+/**
+ * ht_rcu_destroy:
+ *      Destroy a read mostly table and it's readers, no other thread may be
+ * using it.
+ */
+void ht_rcu_destroy(ht_rcu_t *rcu) {
+    ht_rcu_retired_t *r = NULL;
+    ht_rcu_reader_t *reader = NULL;
+
+    if (!rcu) {
+        return;
+    }
+
+    while ((r = rcu->retired)) {
+        rcu->retired = r->next;
+        __rcu_free_retired(rcu, r);
+    }
+
+    while ((reader = rcu->readers)) {
+        rcu->readers = reader->next;
+        free(reader);
+    }
+
+    __rcu_buckets_free(rcu, rcu->buckets, true);
+    ht_destroy(rcu->conf);
+    pthread_mutex_destroy(&rcu->write_lock);
+    free(rcu);
+}
+
+/**
+ * ht_rcu_insert:
+ *      Insert a key value pair, replacing the value if the key is already
+ * present. The replaced entry is freed once no reader can see it.
+ *      Returns false if out of memory. Past RCU_MAX_CAPACITY buckets the
+ * chains only grow longer, so a key is never refused for room.
+ */
+bool ht_rcu_insert(ht_rcu_t *rcu, const void *key, const void *val) {
+    ht_rcu_node_t **link = NULL, *node = NULL, *old = NULL;
+    ht_rcu_buckets_t *b = NULL;
+    ht_key_t k;
+
+    if (!rcu || !key) {
+        return false;
+    }
+
+    __ht_key_view(rcu->conf, &k, key);
+
+    pthread_mutex_lock(&rcu->write_lock);
+
+    b = rcu->buckets;
+    if (rcu->used_buckets + 1 >= (size_t)(b->capacity * RCU_MAX_LOAD_FACTOR) &&
+        b->capacity < RCU_MAX_CAPACITY && __rcu_resize(rcu, b->capacity * 2)) {
+        b = rcu->buckets;
+    }
+
+    link = b->heads + ((size_t)k.hash & (b->capacity - 1));
+    for (old = *link; old; link = &old->next, old = *link) {
+        if (__ht_key_match(rcu->conf, &k, old->hash, old->key)) {
+            break;
+        }
+    }
+
+    node = malloc(sizeof(*node));
+    if (!node) {
+        perror("ht_rcu_insert");
+        pthread_mutex_unlock(&rcu->write_lock);
+        return false;
+    }
+
+    __ht_entry_fill(rcu->conf, &node->key, &node->val, &k, val);
+    node->hash = k.hash;
+    node->next = old ? old->next : *link;
+
+    // The node is complete before readers can reach it
+    __atomic_store_n(link, node, __ATOMIC_RELEASE);
+
+    if (old) {
+        __rcu_retire(rcu, old, false);
+    } else {
+        rcu->used_buckets++;
+    }
+
+    __rcu_collect(rcu);
+
+    pthread_mutex_unlock(&rcu->write_lock);
+
+    return true;
+}
+
+/**
+ * ht_rcu_remove:
+ *      Remove a key, it's entry is freed once no reader can see it.
+ */
+void ht_rcu_remove(ht_rcu_t *rcu, const void *key) {
+    ht_rcu_node_t **link = NULL, *old = NULL;
+    ht_rcu_buckets_t *b = NULL;
+    ht_key_t k;
+
+    if (!rcu || !key) {
+        return;
+    }
+
+    __ht_key_view(rcu->conf, &k, key);
+
+    pthread_mutex_lock(&rcu->write_lock);
+
+    b = rcu->buckets;
+    link = b->heads + ((size_t)k.hash & (b->capacity - 1));
+    for (old = *link; old; link = &old->next, old = *link) {
+        if (__ht_key_match(rcu->conf, &k, old->hash, old->key)) {
+            break;
+        }
+    }
+
+    if (old) {
+        __atomic_store_n(link, old->next, __ATOMIC_RELEASE);
+        __rcu_retire(rcu, old, false);
+        rcu->used_buckets--;
+
+        if (b->capacity > RCU_INITIAL_BUCKETS &&
+            rcu->used_buckets < b->capacity / RCU_SHRINK_DIVISOR) {
+            __rcu_resize(rcu, b->capacity / 2);
+        }
+    }
+
+    __rcu_collect(rcu);
+
+    pthread_mutex_unlock(&rcu->write_lock);
+}
+
+/**
+ * ht_rcu_synchronize:
+ *      Wait for readers in read sections to leave them, and free every entry
+ * and bucket array retired so far. Writers free retired memory as they go,
+ * this is for when they stop writing. Must not be called inside a read
+ * section.
+ */
+void ht_rcu_synchronize(ht_rcu_t *rcu) {
+    if (!rcu) {
+        return;
+    }
+
+    pthread_mutex_lock(&rcu->write_lock);
+    __rcu_synchronize(rcu);
+    pthread_mutex_unlock(&rcu->write_lock);
+}
+
+/**
+ * ht_rcu_reader_create:
+ *      Register a reader of a read mostly table, one for each thread reading
+ * it. Returns NULL if out of memory.
+ */
+ht_rcu_reader_t *ht_rcu_reader_create(ht_rcu_t *rcu) {
+    ht_rcu_reader_t *r = NULL;
+    void *mem = NULL;
+
+    if (!rcu) {
+        return NULL;
+    }
+
+    // Readers write their epoch often, each gets cache lines of it's own
+    if (posix_memalign(&mem, CACHE_LINE,
+                       (sizeof(*r) + CACHE_LINE - 1) / CACHE_LINE *
+                           CACHE_LINE)) {
+        perror("ht_rcu_reader_create");
+        return NULL;
+    }
+
+    r = mem;
+    r->epoch = RCU_IDLE;
+    r->nest = 0;
+    r->rcu = rcu;
+
+    pthread_mutex_lock(&rcu->write_lock);
+    r->next = rcu->readers;
+    rcu->readers = r;
+    pthread_mutex_unlock(&rcu->write_lock);
+
+    return r;
+}
+
+/**
+ * ht_rcu_reader_destroy:
+ *      Unregister a reader, outside any read section.
+ */
+void ht_rcu_reader_destroy(ht_rcu_reader_t *r) {
+    ht_rcu_reader_t **link = NULL;
+
+    if (!r) {
+        return;
+    }
+
+    pthread_mutex_lock(&r->rcu->write_lock);
+    for (link = &r->rcu->readers; *link; link = &(*link)->next) {
+        if (*link == r) {
+            *link = r->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&r->rcu->write_lock);
+
+    free(r);
+}
+
+/**
+ * ht_rcu_read_lock:
+ *      Enter a read section. Values got inside it stay valid until it is
+ * left, whatever writers do meanwhile. Read sections nest and take no lock.
+ */
+void ht_rcu_read_lock(ht_rcu_reader_t *r) {
+    if (!r || r->nest++) {
+        return;
+    }
+
+    __atomic_store_n(&r->epoch,
+                     __atomic_load_n(&r->rcu->epoch, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELAXED);
+
+    // The epoch must be visible to writers before any node is read
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * ht_rcu_read_unlock:
+ *      Leave a read section.
+ */
+void ht_rcu_read_unlock(ht_rcu_reader_t *r) {
+    if (!r || !r->nest || --r->nest) {
+        return;
+    }
+
+    __atomic_store_n(&r->epoch, RCU_IDLE, __ATOMIC_RELEASE);
+}
+
+/**
+ * ht_rcu_get:
+ *      Get the value of a key inside a read section, without locking.
+ */
+void *ht_rcu_get(ht_rcu_reader_t *r, const void *key) {
+    const ht_rcu_buckets_t *b = NULL;
+    const ht_rcu_node_t *node = NULL;
+    ht_key_t k;
+
+    if (!r || !key || !r->nest) {
+        return NULL;
+    }
+
+    __ht_key_view(r->rcu->conf, &k, key);
+
+    b = __atomic_load_n(&r->rcu->buckets, __ATOMIC_ACQUIRE);
+    node = __atomic_load_n(b->heads + ((size_t)k.hash & (b->capacity - 1)),
+                           __ATOMIC_ACQUIRE);
+
+    while (node) {
+        if (__ht_key_match(r->rcu->conf, &k, node->hash, node->key)) {
+            return (void *)node->val;
+        }
+
+        node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,459 @@
+/* ht_robinhood.c - Robin Hood open addressing storage engine.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROBINHOOD_INITIAL_SLOTS (16) // Initial and smallest table size
+#define ROBINHOOD_MAX_CAPACITY                                                 \
+    ((size_t)1 << 31) // Maximum capacity of table when it should not grow
+#define ROBINHOOD_MAX_LOAD                                                     \
+    (0.875) // Default and highest load, probes always reach an empty slot
+#define ROBINHOOD_SHRINK_RATIO                                                 \
+    (7) // Tables shrink below this fraction of their max load, 1/8 load at
+        // the default
+
+/*
+ * Entries are kept in linear probe order, and an entry being inserted takes
+ * the slot of any entry that is closer to it's home slot than the new entry
+ * is to it's own. This keeps the distance of every entry from it's home slot
+ * close to the average, so lookups can stop as soon as they reach an entry
+ * that is closer to home than the probe. Slots store the full hash of their
+ * key, so the distance is computed instead of stored.
+ */
+
+/**
+ * __robinhood_dist:
+ *      Return how far the entry in slot idx is from it's home slot.
+ */
+static inline size_t __robinhood_dist(const ht_t *ht, size_t idx) {
+    return (idx - (size_t)__ht_slot(ht, idx)->hash) & (ht->capacity - 1);
+}
+
+/**
+ * __robinhood_max_load:
+ *      Number of entries a table of capacity can hold at it's max load
+ * factor, at least one.
+ */
+static size_t __robinhood_max_load(const ht_t *ht, size_t capacity) {
+    const size_t max = (size_t)(capacity * ht->max_load);
+
+    return max ? max : 1;
+}
+
+/**
+ * __robinhood_grow:
+ *      Return the capacity a table of capacity grows to.
+ */
+static size_t __robinhood_grow(const ht_t *ht, size_t capacity) {
+    capacity *= (size_t)ht->growth;
+
+    return capacity < ht->max_capacity ? capacity : ht->max_capacity;
+}
+
+/**
+ * __robinhood_find:
+ *      Return the slot index of a key, or capacity if the key is not in the
+ * table.
+ */
+static size_t __robinhood_find(const ht_t *ht, const ht_key_t *k) {
+    const size_t mask = ht->capacity - 1;
+    size_t idx = (size_t)k->hash & mask;
+
+    for (size_t dist = 0; __ht_slot(ht, idx)->key; dist++) {
+        const ht_slot_t *slot = __ht_slot(ht, idx);
+
+        if (__robinhood_dist(ht, idx) < dist) {
+            break;
+        }
+
+        if (__ht_key_match(ht, k, slot->hash, slot->key)) {
+            return idx;
+        }
+
+        idx = (idx + 1) & mask;
+    }
+
+    return ht->capacity;
+}
+
+/**
+ * __robinhood_place:
+ *      Place an entry whose key is not in the table in the first slot on it's
+ * probe sequence holding an entry closer to it's home slot, or an empty one.
+ * The entries from there up to the next empty slot move one slot along,
+ * keeping their order, so each is moved once. Returns the slot the entry
+ * took.
+ */
+static size_t __robinhood_place(ht_t *ht, const ht_slot_t *entry) {
+    const size_t mask = ht->capacity - 1;
+    size_t idx = (size_t)entry->hash & mask;
+    size_t end = 0;
+
+    for (size_t dist = 0;
+         __ht_slot(ht, idx)->key && __robinhood_dist(ht, idx) >= dist;
+         dist++) {
+        idx = (idx + 1) & mask;
+    }
+
+    end = idx;
+    while (__ht_slot(ht, end)->key) {
+        end = (end + 1) & mask;
+    }
+
+    for (; end != idx; end = (end - 1) & mask) {
+        __ht_slot_move(ht, __ht_slot(ht, end), __ht_slot(ht, (end - 1) & mask));
+    }
+
+    __ht_slot_move(ht, __ht_slot(ht, idx), entry);
+
+    return idx;
+}
+
+/**
+ * __robinhood_resize:
+ *      Move every entry of a table into freshly allocated slots of capacity.
+ */
+static bool __robinhood_resize(ht_t *ht, size_t capacity) {
+    ht_slot_t *slots = ht->slots;
+    const size_t old_capacity = ht->capacity;
+
+    ht->slots = calloc(capacity, ht->slot_size);
+    if (!ht->slots) {
+        perror("__robinhood_resize");
+        ht->slots = slots;
+        return false;
+    }
+    ht->capacity = capacity;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        ht_slot_t *slot = HT_SLOT(slots, ht->slot_size, i);
+
+        if (slot->key) {
+            __robinhood_place(ht, slot);
+        }
+    }
+
+    free(slots);
+
+    return true;
+}
+
+/**
+ * __robinhood_capacity_for:
+ *      Return the smallest capacity a Robin Hood table holding n entries can
+ * have.
+ */
+static size_t __robinhood_capacity_for(const ht_t *ht, size_t n) {
+    size_t capacity = ht->initial_capacity;
+
+    while (__robinhood_max_load(ht, capacity) < n &&
+           capacity < ht->max_capacity) {
+        capacity = __robinhood_grow(ht, capacity);
+    }
+
+    return capacity;
+}
+
+/**
+ * __ht_robinhood_reserve:
+ *      Size a Robin Hood table once to hold n entries without growing again.
+ */
+bool __ht_robinhood_reserve(ht_t *ht, size_t n) {
+    const size_t capacity = __robinhood_capacity_for(ht, n);
+
+    if (__robinhood_max_load(ht, capacity) < n) {
+        return false;
+    }
+
+    return capacity <= ht->capacity || __robinhood_resize(ht, capacity);
+}
+
+/**
+ * __ht_robinhood_shrink:
+ *      Shrink a Robin Hood table by it's growth factor once it's load falls
+ * below 1/ROBINHOOD_SHRINK_RATIO of it's max load, unless that would drop
+ * below the capacity reserved for it.
+ */
+void __ht_robinhood_shrink(ht_t *ht) {
+    const size_t capacity = ht->capacity / (size_t)ht->growth;
+
+    if (capacity < ht->initial_capacity || ht->enumerators ||
+        ht->used_buckets >=
+            __robinhood_max_load(ht, ht->capacity) / ROBINHOOD_SHRINK_RATIO ||
+        ht->reserved > __robinhood_max_load(ht, capacity)) {
+        return;
+    }
+
+    __robinhood_resize(ht, capacity);
+}
+
+/**
+ * __ht_robinhood_shrink_to_fit:
+ *      Rebuild a Robin Hood table at the smallest capacity holding it's
+ * entries.
+ */
+bool __ht_robinhood_shrink_to_fit(ht_t *ht) {
+    const size_t capacity = __robinhood_capacity_for(ht, ht->used_buckets);
+
+    return capacity == ht->capacity || __robinhood_resize(ht, capacity);
+}
+
+/**
+ * __ht_robinhood_set_options:
+ *      Apply sizing options to an empty Robin Hood table, 0 fields keep their
+ * defaults. Capacities are rounded to powers of two within the limits of the
+ * engine, growth to a factor of 2 or 4, and the load factor is capped at
+ * ROBINHOOD_MAX_LOAD.
+ */
+bool __ht_robinhood_set_options(ht_t *ht, const ht_options_t *opts) {
+    size_t max =
+        opts->max_capacity ? opts->max_capacity : ROBINHOOD_MAX_CAPACITY;
+    size_t initial = opts->initial_capacity;
+
+    max = max < ROBINHOOD_MAX_CAPACITY ? max : ROBINHOOD_MAX_CAPACITY;
+    max = __ht_pow2_floor(max > ROBINHOOD_INITIAL_SLOTS
+                              ? max
+                              : ROBINHOOD_INITIAL_SLOTS);
+    initial = initial > ROBINHOOD_INITIAL_SLOTS ? initial
+                                                : ROBINHOOD_INITIAL_SLOTS;
+    initial = initial < max ? __ht_pow2_ceil(initial) : max;
+
+    if (!__robinhood_resize(ht, initial)) {
+        return false;
+    }
+
+    ht->max_load = opts->max_load_factor > 0 &&
+                           opts->max_load_factor < ROBINHOOD_MAX_LOAD
+                       ? opts->max_load_factor
+                       : ROBINHOOD_MAX_LOAD;
+    ht->growth = opts->growth_factor > 2 ? 4 : 2;
+    ht->initial_capacity = initial;
+    ht->max_capacity = max;
+
+    return true;
+}
+
+/**
+ * __ht_robinhood_init:
+ *      Allocate the initial slots of a Robin Hood table.
+ */
+bool __ht_robinhood_init(ht_t *ht) {
+    ht->slots = calloc(ROBINHOOD_INITIAL_SLOTS, sizeof(*ht->slots));
+    if (!ht->slots) {
+        perror("__ht_robinhood_init");
+        return false;
+    }
+
+    ht->slot_size = sizeof(*ht->slots);
+
+    ht->max_load = ROBINHOOD_MAX_LOAD;
+    ht->growth = 2;
+    ht->initial_capacity = ROBINHOOD_INITIAL_SLOTS;
+    ht->max_capacity = ROBINHOOD_MAX_CAPACITY;
+    ht->capacity = ROBINHOOD_INITIAL_SLOTS;
+
+    return true;
+}
+
+/**
+ * __ht_robinhood_destroy:
+ *      Free every entry of a Robin Hood table and it's slots.
+ */
+void __ht_robinhood_destroy(ht_t *ht) {
+    for (size_t i = 0; i < ht->capacity && __ht_entries_need_free(ht); i++) {
+        const ht_slot_t *slot = __ht_slot(ht, i);
+
+        if (!slot->key) {
+            continue;
+        }
+
+        __ht_key_free(ht, slot->key);
+        __ht_val_free(ht, slot->val);
+    }
+
+    free(ht->slots);
+    ht->slots = NULL;
+}
+
+/**
+ * __robinhood_add:
+ *      Add a key that is not in a Robin Hood table, growing the table if
+ * needed. Returns the slot of the new entry, or the capacity if the table is
+ * full, at it's max load and unable to grow.
+ */
+static size_t __robinhood_add(ht_t *ht, const ht_key_t *k, const void *val) {
+    ht_islot_t entry; // Room for a slot of any table
+    size_t idx = 0;
+
+    // The max load leaves empty slots, so probes always terminate
+    if (ht->used_buckets + 1 > __robinhood_max_load(ht, ht->capacity) &&
+        (ht->capacity >= ht->max_capacity ||
+         !__robinhood_resize(ht, __robinhood_grow(ht, ht->capacity)))) {
+        return ht->capacity;
+    }
+
+    __ht_slot_fill(ht, &entry.slot, k, val);
+    entry.slot.hash = k->hash;
+    idx = __robinhood_place(ht, &entry.slot);
+    ht->used_buckets++;
+
+    return idx;
+}
+
+/**
+ * __ht_robinhood_insert:
+ *      Insert a key value pair into a Robin Hood table, replacing the value if
+ * the key is already present. A unique key is not looked for. Returns false
+ * if a new key does not fit.
+ */
+bool __ht_robinhood_insert(ht_t *ht, const ht_key_t *k, const void *val,
+                           bool unique) {
+    size_t idx = unique ? ht->capacity : __robinhood_find(ht, k);
+
+    if (idx < ht->capacity) {
+        __ht_slot_set_val(ht, __ht_slot(ht, idx), val);
+        return true;
+    }
+
+    idx = __robinhood_add(ht, k, val);
+
+    return idx < ht->capacity;
+}
+
+/**
+ * __ht_robinhood_get_or_insert:
+ *      Return the val field of the slot of a key in a Robin Hood table,
+ * adding the key with a NULL value if it is not there, or NULL if the table
+ * is full.
+ */
+const void **__ht_robinhood_get_or_insert(ht_t *ht, const ht_key_t *k,
+                                          bool *inserted) {
+    size_t idx = __robinhood_find(ht, k);
+
+    if (idx >= ht->capacity) {
+        idx = __robinhood_add(ht, k, NULL);
+        if (idx >= ht->capacity) {
+            return NULL;
+        }
+        *inserted = true;
+    }
+
+    return &__ht_slot(ht, idx)->val;
+}
+
+/**
+ * __ht_robinhood_remove:
+ *      Remove an entry from a Robin Hood table, handing it's key and value to
+ * the caller through key and val where those are not NULL. Returns false if
+ * the key is not there.
+ *      Instead of leaving a tombstone, the entries following the removed one
+ * are shifted back one slot until reaching an empty slot or an entry already
+ * in it's home slot. Probe lengths stay as short as if the removed entry had
+ * never been inserted.
+ */
+bool __ht_robinhood_remove(ht_t *ht, const ht_key_t *k, const void **key,
+                           const void **val) {
+    const size_t mask = ht->capacity - 1;
+    size_t idx = __robinhood_find(ht, k);
+    ht_slot_t *slot = NULL;
+    size_t next;
+
+    if (idx >= ht->capacity) {
+        return false;
+    }
+
+    slot = __ht_slot(ht, idx);
+    __ht_entry_release(ht, slot->key, slot->val, key, val);
+
+    next = (idx + 1) & mask;
+    while (__ht_slot(ht, next)->key && __robinhood_dist(ht, next) > 0) {
+        __ht_slot_move(ht, slot, __ht_slot(ht, next));
+        slot = __ht_slot(ht, next);
+        next = (next + 1) & mask;
+    }
+
+    slot->key = NULL;
+    slot->val = NULL;
+    ht->used_buckets--;
+
+    return true;
+}
+
+/**
+ * __ht_robinhood_get:
+ *      Get a Robin Hood table value given it's key and a pointer to store
+ * it's value.
+ */
+bool __ht_robinhood_get(const ht_t *ht, const ht_key_t *k, void **val) {
+    const size_t idx = __robinhood_find(ht, k);
+
+    if (idx >= ht->capacity) {
+        return false;
+    }
+
+    *val = __ht_val_ref(ht, &__ht_slot(ht, idx)->val);
+
+    return true;
+}
+
+/**
+ * __ht_robinhood_prefetch:
+ *      Start loading the home slot of a key, or once it is loaded, the key
+ * stored there if it's hash matches.
+ */
+void __ht_robinhood_prefetch(const ht_t *ht, const ht_key_t *k, bool key) {
+    const ht_slot_t *slot = __ht_slot(ht, (size_t)k->hash & (ht->capacity - 1));
+
+    if (!key) {
+        HT_PREFETCH(slot);
+    } else if (slot->key && slot->hash == k->hash) {
+        HT_PREFETCH(slot->key);
+    }
+}
+
+/**
+ * __ht_robinhood_enum_next:
+ *      Get the key value information of the next full slot in a Robin Hood
+ * table.
+ */
+bool __ht_robinhood_enum_next(ht_enum_t *he, const void **key,
+                              const void **val) {
+    const ht_t *ht = he->ht;
+
+    while (he->idx < ht->capacity && !__ht_slot(ht, he->idx)->key) {
+        he->idx++;
+    }
+
+    if (he->idx >= ht->capacity) {
+        return false;
+    }
+
+    *key = __ht_slot(ht, he->idx)->key;
+    *val = __ht_val_ref(ht, &__ht_slot(ht, he->idx)->val);
+    he->idx++;
+
+    return true;
+}
+
+/**
+ * __ht_robinhood_foreach:
+ *      Call fn with the key and value fields of every entry of a Robin Hood
+ * table.
+ */
+void __ht_robinhood_foreach(ht_t *ht, ht_entry_fn fn, void *ctx) {
+    for (size_t i = 0; i < ht->capacity; i++) {
+        ht_slot_t *slot = __ht_slot(ht, i);
+
+        if (slot->key) {
+            fn(&slot->key, &slot->val, ctx);
+        }
+    }
+}
@@ -0,0 +1,195 @@
+/* ht_siphash.c - Keyed string hash after Aumasson and Bernstein's SipHash.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <ctype.h>
+
+/*
+ * SipHash-1-3, one compression round per 8 byte word and three finalization
+ * rounds. With the seed kept secret, as HT_SEED_RANDOM tables do, the hash of
+ * a key can't be predicted, so keys can't be chosen ahead of time to collide
+ * the way FNV1A keys can whatever the seed.
+ *
+ * The 128 bit SipHash key is made from the table seed, 64 bits of it in
+ * 64 bit builds and 32 in 32 bit builds. Words are read little endian on
+ * every CPU, case insensitive hashes fold the case of each word as it is read,
+ * giving the same hash tolower would.
+ */
+
+#define SIP_K1 (0x9E3779B97F4A7C15) // Distinguishes the two key halves
+
+/**
+ * __sip_rotl:
+ *      Rotate a word left by r bits.
+ */
+static inline uint64_t __sip_rotl(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+/**
+ * __sip_round:
+ *      One SipRound over the four state words.
+ */
+static inline void __sip_round(uint64_t *v) {
+    v[0] += v[1];
+    v[1] = __sip_rotl(v[1], 13);
+    v[1] ^= v[0];
+    v[0] = __sip_rotl(v[0], 32);
+    v[2] += v[3];
+    v[3] = __sip_rotl(v[3], 16);
+    v[3] ^= v[2];
+    v[0] += v[3];
+    v[3] = __sip_rotl(v[3], 21);
+    v[3] ^= v[0];
+    v[2] += v[1];
+    v[1] = __sip_rotl(v[1], 17);
+    v[1] ^= v[2];
+    v[2] = __sip_rotl(v[2], 32);
+}
+
+/**
+ * __sip_r8:
+ *      Read 8 bytes of a key as a little endian word, folding their case if
+ * fold is true.
+ */
+static inline uint64_t __sip_r8(const uint8_t *p, bool fold) {
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    if (fold) {
+        v = __ht_fold_word(v);
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+
+    return v;
+}
+
+/**
+ * __sip_hash:
+ *      Return the SipHash-1-3 hash of len bytes of key with a key made from
+ * seed.
+ */
+static uint64_t __sip_hash(const void *key, size_t len, uint64_t seed,
+                           bool fold) {
+    const uint8_t *p = key;
+    const size_t tail = len & 7;
+    const uint8_t *end = p + (len - tail);
+    uint64_t v[4], m, b = (uint64_t)len << 56;
+
+    v[0] = seed ^ 0x736f6d6570736575;
+    v[1] = (seed ^ SIP_K1) ^ 0x646f72616e646f6d;
+    v[2] = seed ^ 0x6c7967656e657261;
+    v[3] = (seed ^ SIP_K1) ^ 0x7465646279746573;
+
+    for (; p != end; p += 8) {
+        m = __sip_r8(p, fold);
+        v[3] ^= m;
+        __sip_round(v);
+        v[0] ^= m;
+    }
+
+    for (size_t i = 0; i < tail; i++) {
+        b |= (uint64_t)(fold ? (uint8_t)tolower(p[i]) : p[i]) << (8 * i);
+    }
+
+    v[3] ^= b;
+    __sip_round(v);
+    v[0] ^= b;
+
+    v[2] ^= 0xff;
+    __sip_round(v);
+    __sip_round(v);
+    __sip_round(v);
+
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+#if defined(CPU_32_BIT)
+
+/**
+ * __sip_hash32:
+ *      Fold a 64 bit hash of len bytes of key to 32 bits.
+ */
+static uint32_t __sip_hash32(const void *key, size_t len, uint32_t seed,
+                             bool fold) {
+    const uint64_t h = __sip_hash(key, len, seed, fold);
+
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * sip_hash_str:
+ *      Wrapper around __sip_hash that uses case sensitive keys.
+ */
+uint32_t sip_hash_str(const void *key, uint32_t seed) {
+    return __sip_hash32(key, strlen(key), seed, false);
+}
+
+/**
+ * sip_hash_str_casecmp:
+ *      Wrapper around __sip_hash that uses case insensitive keys.
+ */
+uint32_t sip_hash_str_casecmp(const void *key, uint32_t seed) {
+    return __sip_hash32(key, strlen(key), seed, true);
+}
+
+/**
+ * sip_hash_str_n:
+ *      Wrapper around __sip_hash that uses case sensitive keys of len bytes.
+ */
+uint32_t sip_hash_str_n(const void *key, size_t len, uint32_t seed) {
+    return __sip_hash32(key, len, seed, false);
+}
+
+/**
+ * sip_hash_str_casecmp_n:
+ *      Wrapper around __sip_hash that uses case insensitive keys of len bytes.
+ */
+uint32_t sip_hash_str_casecmp_n(const void *key, size_t len, uint32_t seed) {
+    return __sip_hash32(key, len, seed, true);
+}
+
+#else
+
+/**
+ * sip_hash_str:
+ *      Wrapper around __sip_hash that uses case sensitive keys.
+ */
+uint64_t sip_hash_str(const void *key, uint64_t seed) {
+    return __sip_hash(key, strlen(key), seed, false);
+}
+
+/**
+ * sip_hash_str_casecmp:
+ *      Wrapper around __sip_hash that uses case insensitive keys.
+ */
+uint64_t sip_hash_str_casecmp(const void *key, uint64_t seed) {
+    return __sip_hash(key, strlen(key), seed, true);
+}
+
+/**
+ * sip_hash_str_n:
+ *      Wrapper around __sip_hash that uses case sensitive keys of len bytes.
+ */
+uint64_t sip_hash_str_n(const void *key, size_t len, uint64_t seed) {
+    return __sip_hash(key, len, seed, false);
+}
+
+/**
+ * sip_hash_str_casecmp_n:
+ *      Wrapper around __sip_hash that uses case insensitive keys of len bytes.
+ */
+uint64_t sip_hash_str_casecmp_n(const void *key, size_t len, uint64_t seed) {
+    return __sip_hash(key, len, seed, true);
+}
+
+#endif
@@ -6,7 +6,7 @@
  * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
  */
 
-#include "ht.h"
+#include "ht_private.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,18 +31,71 @@ static double *__doubledup(const double *val) {
  *      Wrapper aroung ht_create that creates a string->double hash table.
  */
 ht_strdouble_t *ht_strdouble_create(unsigned int flags) {
+    ht_t *ht = NULL;
     ht_hash hash = fnv1a_hash_str;
     ht_keyeq keyeq = str_eq;
-    const ht_callbacks_t callbacks = {
+    ht_hash_n hash_n = fnv1a_hash_str_n;
+    ht_keyeq_n keyeq_n = str_eq_n;
+    ht_keycmp keycmp = str_cmp;
+    ht_keycmp_n keycmp_n = str_cmp_n;
+    ht_callbacks_t callbacks = {
         (void *(*)(const void *))strdup, (void (*)(const void *))free,
-        (void *(*)(const void *))__doubledup, (void (*)(const void *))free};
+        (void *(*)(const void *))__doubledup, (void (*)(const void *))free,
+        NULL};
 
     if (flags & HT_STR_CASECMP) {
         hash = fnv1a_hash_str_casecmp;
         keyeq = str_caseeq;
+        hash_n = fnv1a_hash_str_casecmp_n;
+        keyeq_n = str_caseeq_n;
+        keycmp = str_casecmp;
+        keycmp_n = str_casecmp_n;
     }
 
-    return (ht_strdouble_t *)ht_create(hash, keyeq, &callbacks, flags);
+    // Random seeds key a hash whose collisions can't be found without the
+    // seed, unless wyhash is asked for
+    if (flags & HT_SEED_RANDOM) {
+        hash = flags & HT_STR_CASECMP ? sip_hash_str_casecmp : sip_hash_str;
+        hash_n =
+            flags & HT_STR_CASECMP ? sip_hash_str_casecmp_n : sip_hash_str_n;
+    }
+
+    // Hash keys 8 and 16 bytes at a time instead of one
+    if (flags & HT_HASH_WYHASH) {
+        hash = flags & HT_STR_CASECMP ? wy_hash_str_casecmp : wy_hash_str;
+        hash_n = flags & HT_STR_CASECMP ? wy_hash_str_casecmp_n : wy_hash_str_n;
+    }
+
+    // Short keys are kept in the slots of an open addressed engine, Swiss
+    // unless Robin Hood is asked for
+    if ((flags & HT_STR_INLINE) && !(flags & HT_ENGINE_ROBINHOOD)) {
+        flags |= HT_ENGINE_SWISS;
+    }
+
+    // Packed and arena keys carry their length, lookups compare it first.
+    // Keys of long collision chains are kept in order.
+    if (flags & (HT_STR_PACKED | HT_STR_INLINE | HT_STR_ARENA)) {
+        ht = ht_create_n(hash_n, keyeq_n, &callbacks, flags);
+        ht_set_keycmp_n(ht, keycmp_n);
+    } else {
+        ht = ht_create(hash, keyeq, &callbacks, flags);
+        ht_set_keycmp(ht, keycmp);
+    }
+
+    // Keep values in the entries when they fit, __doubledup stays the fallback
+    ht_set_inline_val(ht, sizeof(double));
+
+    // Keys that fit are stored in their slots, arena tables store none
+    if ((flags & HT_STR_INLINE) && !(flags & HT_STR_ARENA)) {
+        ht_set_inline_keys(ht);
+    }
+
+    // Keys live in chunks freed together with the table
+    if (flags & HT_STR_ARENA) {
+        ht_set_str_arena(ht, false);
+    }
+
+    return (ht_strdouble_t *)ht;
 }
 
 /**
@@ -51,14 +104,77 @@ ht_strdouble_t *ht_strdouble_create(unsigned int flags) {
  */
 void ht_strdouble_destroy(ht_strdouble_t *ht) { ht_destroy((ht_t *)ht); }
 
+/**
+ * ht_strdouble_set_options:
+ *      Wrapper around ht_set_options for an empty string->double hash table.
+ */
+bool ht_strdouble_set_options(ht_strdouble_t *ht, const ht_options_t *opts) {
+    return ht_set_options((ht_t *)ht, opts);
+}
+
+/**
+ * ht_strdouble_reserve:
+ *      Wrapper around ht_reserve that sizes a string->double hash table once
+ * for n entries.
+ */
+bool ht_strdouble_reserve(ht_strdouble_t *ht, size_t n) {
+    return ht_reserve((ht_t *)ht, n);
+}
+
+/**
+ * ht_strdouble_shrink_to_fit:
+ *      Wrapper around ht_shrink_to_fit for a string->double hash table.
+ */
+bool ht_strdouble_shrink_to_fit(ht_strdouble_t *ht) {
+    return ht_shrink_to_fit((ht_t *)ht);
+}
+
+/**
+ * ht_strdouble_compact:
+ *      Wrapper around ht_arena_compact that gives back the arena space of
+ * removed keys of a string->double hash table.
+ */
+bool ht_strdouble_compact(ht_strdouble_t *ht) {
+    return ht_arena_compact((ht_t *)ht);
+}
+
 /**
  * ht_strdouble_insert:
  *      Wrapper around ht_insert that inserts a string->double key value pair
  * into a hash table.
  */
-void ht_strdouble_insert(ht_strdouble_t *ht, const char *key,
+bool ht_strdouble_insert(ht_strdouble_t *ht, const char *key,
                          const double *val) {
-    ht_insert((ht_t *)ht, (void *)key, (void *)val);
+    return ht_insert((ht_t *)ht, (void *)key, (void *)val);
+}
+
+/**
+ * ht_strdouble_add:
+ *      Add delta to the value of a key in a string->double hash table, a key
+ * not in the table starting from 0, with a single lookup. Returns the new
+ * value, or 0 if out of memory.
+ *      Doubles wider than a pointer are kept behind one, a new key's value is
+ * allocated then.
+ */
+double ht_strdouble_add(ht_strdouble_t *ht, const char *key, double delta) {
+    const double zero = 0;
+    void **slot = ht_get_or_insert((ht_t *)ht, key, NULL);
+    double *val = NULL;
+
+    if (!slot) {
+        return 0;
+    }
+
+    if (((ht_t *)ht)->val_inline) {
+        val = (double *)slot;
+    } else if (!(val = *slot) && !(val = *slot = __doubledup(&zero))) {
+        ht_remove((ht_t *)ht, key);
+        return 0;
+    }
+
+    *val += delta;
+
+    return *val;
 }
 
 /**
@@ -73,11 +189,42 @@ void ht_strdouble_remove(ht_strdouble_t *ht, const char *key) {
 /**
  * ht_strdouble_get:
  *      Wrapper around ht_get for string->double hash table.
+ *      Values are stored inline, the returned pointer points into the table
+ * and is only valid until the table is next changed.
  */
 void *ht_strdouble_get(ht_strdouble_t *ht, const char *key) {
     return ht_get((ht_t *)ht, (void *)key);
 }
 
+/**
+ * ht_strdouble_get_val:
+ *      Copy the value of a key in a string->double hash table into val.
+ *      Returns false if the key is not in the table.
+ */
+bool ht_strdouble_get_val(ht_strdouble_t *ht, const char *key, double *val) {
+    const double *v = ht_get((ht_t *)ht, (void *)key);
+
+    if (!v) {
+        return false;
+    }
+
+    if (val) {
+        *val = *v;
+    }
+
+    return true;
+}
+
+/**
+ * ht_strdouble_get_many:
+ *      Wrapper around ht_get_many for string->double hash table. The value
+ * pointers point into the table and are only valid until it is next changed.
+ */
+size_t ht_strdouble_get_many(ht_strdouble_t *ht, const char *const *keys,
+                             size_t n, void **vals) {
+    return ht_get_many((ht_t *)ht, (const void *const *)keys, n, vals);
+}
+
 /**
  * ht_strdouble_enum_create:
  *      Wrapper around ht_enum_create the makes an enumeration object for
@@ -31,18 +31,71 @@ static float *__floatdup(const float *val) {
  *      Wrapper aroung ht_create that creates a string->float hash table.
  */
 ht_strfloat_t *ht_strfloat_create(unsigned int flags) {
+    ht_t *ht = NULL;
     ht_hash hash = fnv1a_hash_str;
     ht_keyeq keyeq = str_eq;
-    const ht_callbacks_t callbacks = {
+    ht_hash_n hash_n = fnv1a_hash_str_n;
+    ht_keyeq_n keyeq_n = str_eq_n;
+    ht_keycmp keycmp = str_cmp;
+    ht_keycmp_n keycmp_n = str_cmp_n;
+    ht_callbacks_t callbacks = {
         (void *(*)(const void *))strdup, (void (*)(const void *))free,
-        (void *(*)(const void *))__floatdup, (void (*)(const void *))free};
+        (void *(*)(const void *))__floatdup, (void (*)(const void *))free,
+        NULL};
 
     if (flags & HT_STR_CASECMP) {
         hash = fnv1a_hash_str_casecmp;
         keyeq = str_caseeq;
+        hash_n = fnv1a_hash_str_casecmp_n;
+        keyeq_n = str_caseeq_n;
+        keycmp = str_casecmp;
+        keycmp_n = str_casecmp_n;
     }
 
-    return (ht_strfloat_t *)ht_create(hash, keyeq, &callbacks, flags);
+    // Random seeds key a hash whose collisions can't be found without the
+    // seed, unless wyhash is asked for
+    if (flags & HT_SEED_RANDOM) {
+        hash = flags & HT_STR_CASECMP ? sip_hash_str_casecmp : sip_hash_str;
+        hash_n =
+            flags & HT_STR_CASECMP ? sip_hash_str_casecmp_n : sip_hash_str_n;
+    }
+
+    // Hash keys 8 and 16 bytes at a time instead of one
+    if (flags & HT_HASH_WYHASH) {
+        hash = flags & HT_STR_CASECMP ? wy_hash_str_casecmp : wy_hash_str;
+        hash_n = flags & HT_STR_CASECMP ? wy_hash_str_casecmp_n : wy_hash_str_n;
+    }
+
+    // Short keys are kept in the slots of an open addressed engine, Swiss
+    // unless Robin Hood is asked for
+    if ((flags & HT_STR_INLINE) && !(flags & HT_ENGINE_ROBINHOOD)) {
+        flags |= HT_ENGINE_SWISS;
+    }
+
+    // Packed and arena keys carry their length, lookups compare it first.
+    // Keys of long collision chains are kept in order.
+    if (flags & (HT_STR_PACKED | HT_STR_INLINE | HT_STR_ARENA)) {
+        ht = ht_create_n(hash_n, keyeq_n, &callbacks, flags);
+        ht_set_keycmp_n(ht, keycmp_n);
+    } else {
+        ht = ht_create(hash, keyeq, &callbacks, flags);
+        ht_set_keycmp(ht, keycmp);
+    }
+
+    // Keep values in the entries when they fit, __floatdup stays the fallback
+    ht_set_inline_val(ht, sizeof(float));
+
+    // Keys that fit are stored in their slots, arena tables store none
+    if ((flags & HT_STR_INLINE) && !(flags & HT_STR_ARENA)) {
+        ht_set_inline_keys(ht);
+    }
+
+    // Keys live in chunks freed together with the table
+    if (flags & HT_STR_ARENA) {
+        ht_set_str_arena(ht, false);
+    }
+
+    return (ht_strfloat_t *)ht;
 }
 
 /**
@@ -51,13 +104,47 @@ ht_strfloat_t *ht_strfloat_create(unsigned int flags) {
  */
 void ht_strfloat_destroy(ht_strfloat_t *ht) { ht_destroy((ht_t *)ht); }
 
+/**
+ * ht_strfloat_set_options:
+ *      Wrapper around ht_set_options for an empty string->float hash table.
+ */
+bool ht_strfloat_set_options(ht_strfloat_t *ht, const ht_options_t *opts) {
+    return ht_set_options((ht_t *)ht, opts);
+}
+
+/**
+ * ht_strfloat_reserve:
+ *      Wrapper around ht_reserve that sizes a string->float hash table once
+ * for n entries.
+ */
+bool ht_strfloat_reserve(ht_strfloat_t *ht, size_t n) {
+    return ht_reserve((ht_t *)ht, n);
+}
+
+/**
+ * ht_strfloat_shrink_to_fit:
+ *      Wrapper around ht_shrink_to_fit for a string->float hash table.
+ */
+bool ht_strfloat_shrink_to_fit(ht_strfloat_t *ht) {
+    return ht_shrink_to_fit((ht_t *)ht);
+}
+
+/**
+ * ht_strfloat_compact:
+ *      Wrapper around ht_arena_compact that gives back the arena space of
+ * removed keys of a string->float hash table.
+ */
+bool ht_strfloat_compact(ht_strfloat_t *ht) {
+    return ht_arena_compact((ht_t *)ht);
+}
+
 /**
  * ht_strfloat_insert:
  *      Wrapper around ht_insert that inserts a string->float key value pair
  * into a hash table.
  */
-void ht_strfloat_insert(ht_strfloat_t *ht, const char *key, const float *val) {
-    ht_insert((ht_t *)ht, (void *)key, (void *)val);
+bool ht_strfloat_insert(ht_strfloat_t *ht, const char *key, const float *val) {
+    return ht_insert((ht_t *)ht, (void *)key, (void *)val);
 }
 
 /**
@@ -72,11 +159,42 @@ void ht_strfloat_remove(ht_strfloat_t *ht, const char *key) {
 /**
  * ht_strfloat_get:
  *      Wrapper around ht_get for string->float hash table.
+ *      Values are stored inline, the returned pointer points into the table
+ * and is only valid until the table is next changed.
  */
 void *ht_strfloat_get(ht_strfloat_t *ht, const char *key) {
     return ht_get((ht_t *)ht, (void *)key);
 }
 
+/**
+ * ht_strfloat_get_val:
+ *      Copy the value of a key in a string->float hash table into val.
+ *      Returns false if the key is not in the table.
+ */
+bool ht_strfloat_get_val(ht_strfloat_t *ht, const char *key, float *val) {
+    const float *v = ht_get((ht_t *)ht, (void *)key);
+
+    if (!v) {
+        return false;
+    }
+
+    if (val) {
+        *val = *v;
+    }
+
+    return true;
+}
+
+/**
+ * ht_strfloat_get_many:
+ *      Wrapper around ht_get_many for string->float hash table. The value
+ * pointers point into the table and are only valid until it is next changed.
+ */
+size_t ht_strfloat_get_many(ht_strfloat_t *ht, const char *const *keys,
+                            size_t n, void **vals) {
+    return ht_get_many((ht_t *)ht, (const void *const *)keys, n, vals);
+}
+
 /**
  * ht_strfloat_enum_create:
  *      Wrapper around ht_enum_create the makes an enumeration object for
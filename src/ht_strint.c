@@ -31,18 +31,70 @@ static int *__intdup(const int *val) {
  *      Wrapper aroung ht_create that creates a string->int hash table.
  */
 ht_strint_t *ht_strint_create(unsigned int flags) {
+    ht_t *ht = NULL;
     ht_hash hash = fnv1a_hash_str;
     ht_keyeq keyeq = str_eq;
-    const ht_callbacks_t callbacks = {
+    ht_hash_n hash_n = fnv1a_hash_str_n;
+    ht_keyeq_n keyeq_n = str_eq_n;
+    ht_keycmp keycmp = str_cmp;
+    ht_keycmp_n keycmp_n = str_cmp_n;
+    ht_callbacks_t callbacks = {
         (void *(*)(const void *))strdup, (void (*)(const void *))free,
-        (void *(*)(const void *))__intdup, (void (*)(const void *))free};
+        (void *(*)(const void *))__intdup, (void (*)(const void *))free, NULL};
 
     if (flags & HT_STR_CASECMP) {
         hash = fnv1a_hash_str_casecmp;
         keyeq = str_caseeq;
+        hash_n = fnv1a_hash_str_casecmp_n;
+        keyeq_n = str_caseeq_n;
+        keycmp = str_casecmp;
+        keycmp_n = str_casecmp_n;
     }
 
-    return (ht_strint_t *)ht_create(hash, keyeq, &callbacks, flags);
+    // Random seeds key a hash whose collisions can't be found without the
+    // seed, unless wyhash is asked for
+    if (flags & HT_SEED_RANDOM) {
+        hash = flags & HT_STR_CASECMP ? sip_hash_str_casecmp : sip_hash_str;
+        hash_n =
+            flags & HT_STR_CASECMP ? sip_hash_str_casecmp_n : sip_hash_str_n;
+    }
+
+    // Hash keys 8 and 16 bytes at a time instead of one
+    if (flags & HT_HASH_WYHASH) {
+        hash = flags & HT_STR_CASECMP ? wy_hash_str_casecmp : wy_hash_str;
+        hash_n = flags & HT_STR_CASECMP ? wy_hash_str_casecmp_n : wy_hash_str_n;
+    }
+
+    // Short keys are kept in the slots of an open addressed engine, Swiss
+    // unless Robin Hood is asked for
+    if ((flags & HT_STR_INLINE) && !(flags & HT_ENGINE_ROBINHOOD)) {
+        flags |= HT_ENGINE_SWISS;
+    }
+
+    // Packed and arena keys carry their length, lookups compare it first.
+    // Keys of long collision chains are kept in order.
+    if (flags & (HT_STR_PACKED | HT_STR_INLINE | HT_STR_ARENA)) {
+        ht = ht_create_n(hash_n, keyeq_n, &callbacks, flags);
+        ht_set_keycmp_n(ht, keycmp_n);
+    } else {
+        ht = ht_create(hash, keyeq, &callbacks, flags);
+        ht_set_keycmp(ht, keycmp);
+    }
+
+    // Keep values in the entries when they fit, __intdup stays the fallback
+    ht_set_inline_val(ht, sizeof(int));
+
+    // Keys that fit are stored in their slots, arena tables store none
+    if ((flags & HT_STR_INLINE) && !(flags & HT_STR_ARENA)) {
+        ht_set_inline_keys(ht);
+    }
+
+    // Keys live in chunks freed together with the table
+    if (flags & HT_STR_ARENA) {
+        ht_set_str_arena(ht, false);
+    }
+
+    return (ht_strint_t *)ht;
 }
 
 /**
@@ -51,13 +103,97 @@ ht_strint_t *ht_strint_create(unsigned int flags) {
  */
 void ht_strint_destroy(ht_strint_t *ht) { ht_destroy((ht_t *)ht); }
 
+/**
+ * ht_strint_set_options:
+ *      Wrapper around ht_set_options for an empty string->int hash table.
+ */
+bool ht_strint_set_options(ht_strint_t *ht, const ht_options_t *opts) {
+    return ht_set_options((ht_t *)ht, opts);
+}
+
+/**
+ * ht_strint_reserve:
+ *      Wrapper around ht_reserve that sizes a string->int hash table once
+ * for n entries.
+ */
+bool ht_strint_reserve(ht_strint_t *ht, size_t n) {
+    return ht_reserve((ht_t *)ht, n);
+}
+
+/**
+ * ht_strint_shrink_to_fit:
+ *      Wrapper around ht_shrink_to_fit for a string->int hash table.
+ */
+bool ht_strint_shrink_to_fit(ht_strint_t *ht) {
+    return ht_shrink_to_fit((ht_t *)ht);
+}
+
+/**
+ * ht_strint_compact:
+ *      Wrapper around ht_arena_compact that gives back the arena space of
+ * removed keys of a string->int hash table.
+ */
+bool ht_strint_compact(ht_strint_t *ht) {
+    return ht_arena_compact((ht_t *)ht);
+}
+
 /**
  * ht_strint_insert:
  *      Wrapper around ht_insert that inserts a string->int key value pair into
  * a hash table.
  */
-void ht_strint_insert(ht_strint_t *ht, const char *key, const int *val) {
-    ht_insert((ht_t *)ht, (void *)key, (void *)val);
+bool ht_strint_insert(ht_strint_t *ht, const char *key, const int *val) {
+    return ht_insert((ht_t *)ht, (void *)key, (void *)val);
+}
+
+/**
+ * ht_strint_insert_many:
+ *      Wrapper around ht_insert_many that inserts n string->int key value
+ * pairs into a hash table, the values taken from an array of n ints.
+ * Returns the number of pairs stored, 0 if out of memory.
+ */
+size_t ht_strint_insert_many(ht_strint_t *ht, const char *const *keys,
+                             const int *vals, size_t n, unsigned int flags) {
+    const void **ptrs = NULL;
+    size_t stored = 0;
+
+    if (!ht || !keys || !vals || n > SIZE_MAX / sizeof(*ptrs)) {
+        return 0;
+    }
+
+    ptrs = malloc(n * sizeof(*ptrs));
+    if (!ptrs) {
+        perror("ht_strint_insert_many");
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        ptrs[i] = vals + i;
+    }
+
+    stored =
+        ht_insert_many((ht_t *)ht, (const void *const *)keys, ptrs, n, flags);
+    free(ptrs);
+
+    return stored;
+}
+
+/**
+ * ht_strint_add:
+ *      Add delta to the value of a key in a string->int hash table, a key not
+ * in the table starting from 0, with a single lookup. Returns the new value,
+ * or 0 if out of memory.
+ */
+int ht_strint_add(ht_strint_t *ht, const char *key, int delta) {
+    int *val = (int *)ht_get_or_insert((ht_t *)ht, key, NULL);
+
+    if (!val) {
+        return 0;
+    }
+
+    *val += delta;
+
+    return *val;
 }
 
 /**
@@ -72,11 +208,42 @@ void ht_strint_remove(ht_strint_t *ht, const char *key) {
 /**
  * ht_strint_get:
  *      Wrapper around ht_get for string->int hash table.
+ *      Values are stored inline, the returned pointer points into the table
+ * and is only valid until the table is next changed.
  */
 void *ht_strint_get(ht_strint_t *ht, const char *key) {
     return ht_get((ht_t *)ht, (void *)key);
 }
 
+/**
+ * ht_strint_get_val:
+ *      Copy the value of a key in a string->int hash table into val.
+ *      Returns false if the key is not in the table.
+ */
+bool ht_strint_get_val(ht_strint_t *ht, const char *key, int *val) {
+    const int *v = ht_get((ht_t *)ht, (void *)key);
+
+    if (!v) {
+        return false;
+    }
+
+    if (val) {
+        *val = *v;
+    }
+
+    return true;
+}
+
+/**
+ * ht_strint_get_many:
+ *      Wrapper around ht_get_many for string->int hash table. The value
+ * pointers point into the table and are only valid until it is next changed.
+ */
+size_t ht_strint_get_many(ht_strint_t *ht, const char *const *keys, size_t n,
+                          void **vals) {
+    return ht_get_many((ht_t *)ht, (const void *const *)keys, n, vals);
+}
+
 /**
  * ht_strint_enum_create:
  *      Wrapper around ht_enum_create the makes an enumeration object for
@@ -101,3 +268,47 @@ bool ht_strint_enum_next(ht_enum_t *he, const char **key, const int **val) {
  * enumeration object.
  */
 void ht_strint_enum_destroy(ht_enum_t *he) { ht_enum_destroy(he); }
+
+/**
+ * ht_strint_save:
+ *      Wrapper around ht_save that writes a snapshot of a string->int hash
+ * table to path.
+ */
+bool ht_strint_save(ht_strint_t *ht, const char *path) {
+    return ht_save((ht_t *)ht, path);
+}
+
+/**
+ * ht_strint_open_mmap:
+ *      Wrapper around ht_open_mmap that maps a snapshot of a string->int hash
+ * table, or returns NULL if the file holds another kind of table.
+ */
+ht_mmap_t *ht_strint_open_mmap(const char *path) {
+    ht_mmap_t *hm = ht_open_mmap(path);
+
+    if (hm && ht_mmap_inline_val(hm) != sizeof(int)) {
+        ht_mmap_close(hm);
+        return NULL;
+    }
+
+    return hm;
+}
+
+/**
+ * ht_strint_mmap_get_val:
+ *      Copy the value of a key in a mapped string->int hash table into val.
+ *      Returns false if the key is not in the table.
+ */
+bool ht_strint_mmap_get_val(ht_mmap_t *hm, const char *key, int *val) {
+    const void *v = ht_mmap_get(hm, key);
+
+    if (!v) {
+        return false;
+    }
+
+    if (val) {
+        memcpy(val, v, sizeof(*val));
+    }
+
+    return true;
+}
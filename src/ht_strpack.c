@@ -0,0 +1,114 @@
+/* ht_strpack.c - Length prefixed string keys packed with their values.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * __ht_str_pack_ndup:
+ *      Copy len bytes of key into a packed key. If val_out is not NULL the
+ * string val is copied right after the key's terminator, and the address of
+ * the copy is stored in val_out. Keys may hold any bytes, including zeros.
+ */
+void *__ht_str_pack_ndup(const void *key, size_t len, const void *val,
+                         const void **val_out) {
+    const size_t val_len = val_out && val ? strlen(val) + 1 : 0;
+    str_pack_t *pack = NULL;
+
+    if (val_out) {
+        *val_out = NULL;
+    }
+
+    if (len >= STR_PACK_INLINE) {
+        return NULL;
+    }
+
+    pack = malloc(sizeof(*pack) + len + 1 + val_len);
+    if (!pack) {
+        perror("__ht_str_pack_ndup");
+        return NULL;
+    }
+
+    pack->len = (uint32_t)len;
+    memcpy(pack->str, key, len);
+    pack->str[len] = '\0';
+
+    if (val_len) {
+        *val_out = memcpy(pack->str + len + 1, val, val_len);
+    }
+
+    return pack->str;
+}
+
+/**
+ * __ht_str_pack_slot:
+ *      Pack len bytes of key, and the string val if val_out is not NULL, into
+ * the inline key of a slot as __ht_str_pack_ndup would into an allocation.
+ * A key already packed in the slot stays where it is. Returns NULL, leaving
+ * the slot as it was, if they don't fit.
+ */
+void *__ht_str_pack_slot(ht_islot_t *s, const void *key, size_t len,
+                         const void *val, const void **val_out) {
+    const size_t val_len = val_out && val ? strlen(val) + 1 : 0;
+
+    if (len >= sizeof(s->str) || val_len > sizeof(s->str) - len - 1) {
+        return NULL;
+    }
+
+    if (key != s->str) {
+        s->len = (uint32_t)len | STR_PACK_INLINE;
+        memcpy(s->str, key, len);
+        s->str[len] = '\0';
+    }
+
+    if (val_out) {
+        *val_out = val_len ? memcpy(s->str + len + 1, val, val_len) : NULL;
+    }
+
+    return s->str;
+}
+
+/**
+ * str_pack_dup:
+ *      Key copy callback that duplicates a string as a packed key.
+ */
+void *str_pack_dup(const void *key) {
+    return __ht_str_pack_ndup(key, strlen(key), NULL, NULL);
+}
+
+/**
+ * str_pack_pairdup:
+ *      Pair copy callback that packs a string key and string value into one
+ * allocation, storing the address of the copied value in val_out.
+ */
+void *str_pack_pairdup(const void *key, const void *val,
+                       const void **val_out) {
+    return __ht_str_pack_ndup(key, strlen(key), val, val_out);
+}
+
+/**
+ * str_pack_free:
+ *      Key free callback for packed keys, also frees a value packed with the
+ * key. Keys packed inline in a slot are freed with it.
+ */
+void str_pack_free(const void *key) {
+    if (key && !(STR_PACK(key)->len & STR_PACK_INLINE)) {
+        free(STR_PACK(key));
+    }
+}
+
+/**
+ * str_pack_len:
+ *      Return the stored length of a packed key without scanning it.
+ */
+size_t str_pack_len(const void *key) {
+    return STR_PACK(key)->len & ~STR_PACK_INLINE;
+}
@@ -14,20 +14,79 @@
 /**
  * ht_strstr_create:
  *      Wrapper aroung ht_create that creates a string->string hash table.
+ *      HT_STR_PACKED packs each key and value into one allocation, the entry
+ * keeping a pointer to it, and HT_STR_ARENA copies them into chunks of an
+ * arena instead. HT_STR_INLINE packs a key and value into the entry itself
+ * when they fit, on the Swiss engine unless HT_ENGINE_ROBINHOOD is given,
+ * see ht_set_inline_keys.
  */
 ht_strstr_t *ht_strstr_create(unsigned int flags) {
+    ht_t *ht = NULL;
     ht_hash hash = fnv1a_hash_str;
     ht_keyeq keyeq = str_eq;
-    const ht_callbacks_t callbacks = {
+    ht_hash_n hash_n = fnv1a_hash_str_n;
+    ht_keyeq_n keyeq_n = str_eq_n;
+    ht_keycmp keycmp = str_cmp;
+    ht_keycmp_n keycmp_n = str_cmp_n;
+    ht_callbacks_t callbacks = {
         (void *(*)(const void *))strdup, (void (*)(const void *))free,
-        (void *(*)(const void *))strdup, (void (*)(const void *))free};
+        (void *(*)(const void *))strdup, (void (*)(const void *))free, NULL};
 
     if (flags & HT_STR_CASECMP) {
         hash = fnv1a_hash_str_casecmp;
         keyeq = str_caseeq;
+        hash_n = fnv1a_hash_str_casecmp_n;
+        keyeq_n = str_caseeq_n;
+        keycmp = str_casecmp;
+        keycmp_n = str_casecmp_n;
     }
 
-    return (ht_strstr_t *)ht_create(hash, keyeq, &callbacks, flags);
+    // Random seeds key a hash whose collisions can't be found without the
+    // seed, unless wyhash is asked for
+    if (flags & HT_SEED_RANDOM) {
+        hash = flags & HT_STR_CASECMP ? sip_hash_str_casecmp : sip_hash_str;
+        hash_n =
+            flags & HT_STR_CASECMP ? sip_hash_str_casecmp_n : sip_hash_str_n;
+    }
+
+    // Hash keys 8 and 16 bytes at a time instead of one
+    if (flags & HT_HASH_WYHASH) {
+        hash = flags & HT_STR_CASECMP ? wy_hash_str_casecmp : wy_hash_str;
+        hash_n = flags & HT_STR_CASECMP ? wy_hash_str_casecmp_n : wy_hash_str_n;
+    }
+
+    // One allocation per entry holding the key length, key and value
+    if (flags & (HT_STR_PACKED | HT_STR_INLINE)) {
+        callbacks.pair_copy = str_pack_pairdup;
+    }
+
+    // Short keys are kept in the slots of an open addressed engine, Swiss
+    // unless Robin Hood is asked for
+    if ((flags & HT_STR_INLINE) && !(flags & HT_ENGINE_ROBINHOOD)) {
+        flags |= HT_ENGINE_SWISS;
+    }
+
+    // Packed and arena keys carry their length, lookups compare it first.
+    // Keys of long collision chains are kept in order.
+    if (flags & (HT_STR_PACKED | HT_STR_INLINE | HT_STR_ARENA)) {
+        ht = ht_create_n(hash_n, keyeq_n, &callbacks, flags);
+        ht_set_keycmp_n(ht, keycmp_n);
+    } else {
+        ht = ht_create(hash, keyeq, &callbacks, flags);
+        ht_set_keycmp(ht, keycmp);
+    }
+
+    // Keys that fit are stored in their slots, arena tables store none
+    if ((flags & HT_STR_INLINE) && !(flags & HT_STR_ARENA)) {
+        ht_set_inline_keys(ht);
+    }
+
+    // Keys and values live in chunks freed together with the table
+    if (flags & HT_STR_ARENA) {
+        ht_set_str_arena(ht, true);
+    }
+
+    return (ht_strstr_t *)ht;
 }
 
 /**
@@ -36,13 +95,69 @@ ht_strstr_t *ht_strstr_create(unsigned int flags) {
  */
 void ht_strstr_destroy(ht_strstr_t *ht) { ht_destroy((ht_t *)ht); }
 
+/**
+ * ht_strstr_set_options:
+ *      Wrapper around ht_set_options for an empty string->string hash table.
+ */
+bool ht_strstr_set_options(ht_strstr_t *ht, const ht_options_t *opts) {
+    return ht_set_options((ht_t *)ht, opts);
+}
+
+/**
+ * ht_strstr_reserve:
+ *      Wrapper around ht_reserve that sizes a string->string hash table once
+ * for n entries.
+ */
+bool ht_strstr_reserve(ht_strstr_t *ht, size_t n) {
+    return ht_reserve((ht_t *)ht, n);
+}
+
+/**
+ * ht_strstr_shrink_to_fit:
+ *      Wrapper around ht_shrink_to_fit for a string->string hash table.
+ */
+bool ht_strstr_shrink_to_fit(ht_strstr_t *ht) {
+    return ht_shrink_to_fit((ht_t *)ht);
+}
+
+/**
+ * ht_strstr_compact:
+ *      Wrapper around ht_arena_compact that gives back the arena space of
+ * removed and replaced strings of a string->string hash table.
+ */
+bool ht_strstr_compact(ht_strstr_t *ht) {
+    return ht_arena_compact((ht_t *)ht);
+}
+
 /**
  * ht_strstr_insert:
  *      Wrapper around ht_insert that inserts a string->string key value pair
  * into a hash table.
  */
-void ht_strstr_insert(ht_strstr_t *ht, const char *key, const char *val) {
-    ht_insert((ht_t *)ht, key, val);
+bool ht_strstr_insert(ht_strstr_t *ht, const char *key, const char *val) {
+    return ht_insert((ht_t *)ht, key, val);
+}
+
+/**
+ * ht_strstr_insert_many:
+ *      Wrapper around ht_insert_many that inserts n string->string key value
+ * pairs into a hash table. Returns the number of pairs stored.
+ */
+size_t ht_strstr_insert_many(ht_strstr_t *ht, const char *const *keys,
+                             const char *const *vals, size_t n,
+                             unsigned int flags) {
+    return ht_insert_many((ht_t *)ht, (const void *const *)keys,
+                          (const void *const *)vals, n, flags);
+}
+
+/**
+ * ht_strstr_insert_take:
+ *      Wrapper around ht_insert_take that hands a malloced key and value to a
+ * string->string hash table, which frees them. Packed and arena tables
+ * return false.
+ */
+bool ht_strstr_insert_take(ht_strstr_t *ht, char *key, char *val) {
+    return ht_insert_take((ht_t *)ht, key, val);
 }
 
 /**
@@ -54,6 +169,34 @@ void ht_strstr_remove(ht_strstr_t *ht, const char *key) {
     ht_remove((ht_t *)ht, (void *)key);
 }
 
+/**
+ * ht_strstr_take:
+ *      Wrapper around ht_take that removes a key from a string->string hash
+ * table and returns it's value for the caller to free.
+ */
+char *ht_strstr_take(ht_strstr_t *ht, const char *key) {
+    return ht_take((ht_t *)ht, key);
+}
+
+/**
+ * ht_strstr_insert_n:
+ *      Wrapper around ht_insert_n that inserts a key of len bytes and it's
+ * string value into a string->string hash table.
+ */
+bool ht_strstr_insert_n(ht_strstr_t *ht, const char *key, size_t len,
+                        const char *val) {
+    return ht_insert_n((ht_t *)ht, key, len, val);
+}
+
+/**
+ * ht_strstr_remove_n:
+ *      Wrapper around ht_remove_n that removes a key of len bytes from a
+ * string->string hash table.
+ */
+void ht_strstr_remove_n(ht_strstr_t *ht, const char *key, size_t len) {
+    ht_remove_n((ht_t *)ht, key, len);
+}
+
 /**
  * ht_strstr_get:
  *      Wrapper around ht_get for string->string hash table.
@@ -62,6 +205,70 @@ const char *ht_strstr_get(ht_strstr_t *ht, const char *key) {
     return ht_get((ht_t *)ht, (void *)key);
 }
 
+/**
+ * ht_strstr_get_n:
+ *      Wrapper around ht_get_n for string->string hash table. Tables created
+ * with HT_STR_PACKED or HT_STR_ARENA look the key up without copying it.
+ */
+const char *ht_strstr_get_n(ht_strstr_t *ht, const char *key, size_t len) {
+    return ht_get_n((ht_t *)ht, key, len);
+}
+
+/**
+ * ht_strstr_get_many:
+ *      Wrapper around ht_get_many for string->string hash table.
+ */
+size_t ht_strstr_get_many(ht_strstr_t *ht, const char *const *keys, size_t n,
+                          const char **vals) {
+    return ht_get_many((ht_t *)ht, (const void *const *)keys, n,
+                       (void **)vals);
+}
+
+/**
+ * ht_strstr_hash_key:
+ *      Wrapper around ht_hash_key that hashes a key of a string->string hash
+ * table, serving every table made with the same flags and seed.
+ */
+ht_hashval_t ht_strstr_hash_key(ht_strstr_t *ht, const char *key) {
+    return ht_hash_key((ht_t *)ht, key);
+}
+
+/**
+ * ht_strstr_share_seed:
+ *      Wrapper around ht_share_seed for string->string hash tables made with
+ * the same flags.
+ */
+bool ht_strstr_share_seed(ht_strstr_t *ht, ht_strstr_t *from) {
+    return ht_share_seed((ht_t *)ht, (ht_t *)from);
+}
+
+/**
+ * ht_strstr_insert_hashed:
+ *      Wrapper around ht_insert_hashed for string->string hash table.
+ */
+bool ht_strstr_insert_hashed(ht_strstr_t *ht, const char *key,
+                             ht_hashval_t hash, const char *val) {
+    return ht_insert_hashed((ht_t *)ht, key, hash, val);
+}
+
+/**
+ * ht_strstr_remove_hashed:
+ *      Wrapper around ht_remove_hashed for string->string hash table.
+ */
+void ht_strstr_remove_hashed(ht_strstr_t *ht, const char *key,
+                             ht_hashval_t hash) {
+    ht_remove_hashed((ht_t *)ht, key, hash);
+}
+
+/**
+ * ht_strstr_get_hashed:
+ *      Wrapper around ht_get_hashed for string->string hash table.
+ */
+const char *ht_strstr_get_hashed(ht_strstr_t *ht, const char *key,
+                                 ht_hashval_t hash) {
+    return ht_get_hashed((ht_t *)ht, key, hash);
+}
+
 /**
  * ht_strstr_enum_create:
  *      Wrapper around ht_enum_create the makes an enumeration object for
@@ -87,3 +294,36 @@ bool ht_strstr_enum_next(ht_enum_t *he, const char **key, const char **val) {
  * enumeration object.
  */
 void ht_strstr_enum_destroy(ht_enum_t *he) { ht_enum_destroy((ht_enum_t *)he); }
+
+/**
+ * ht_strstr_save:
+ *      Wrapper around ht_save that writes a snapshot of a string->string hash
+ * table to path.
+ */
+bool ht_strstr_save(ht_strstr_t *ht, const char *path) {
+    return ht_save((ht_t *)ht, path);
+}
+
+/**
+ * ht_strstr_open_mmap:
+ *      Wrapper around ht_open_mmap that maps a snapshot of a string->string
+ * hash table, or returns NULL if the file holds another kind of table.
+ */
+ht_mmap_t *ht_strstr_open_mmap(const char *path) {
+    ht_mmap_t *hm = ht_open_mmap(path);
+
+    if (hm && ht_mmap_inline_val(hm)) {
+        ht_mmap_close(hm);
+        return NULL;
+    }
+
+    return hm;
+}
+
+/**
+ * ht_strstr_mmap_get:
+ *      Wrapper around ht_mmap_get for a mapped string->string hash table.
+ */
+const char *ht_strstr_mmap_get(ht_mmap_t *hm, const char *key) {
+    return ht_mmap_get(hm, key);
+}
@@ -0,0 +1,635 @@
+/* ht_swiss.c - Open addressing storage engine with SIMD probed control bytes.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define SWISS_INITIAL_SLOTS (16) // Initial and smallest table size, one group
+#define SWISS_GROUP_WIDTH (16)   // Control bytes compared per probe step
+#define SWISS_MAX_CAPACITY                                                     \
+    ((size_t)1 << 31) // Maximum capacity of table when it should not grow
+#define SWISS_MAX_LOAD                                                         \
+    (0.875) // Default and highest load, probes always reach an empty slot
+#define SWISS_SHRINK_RATIO                                                     \
+    (7) // Tables shrink below this fraction of their max load, 1/8 load at
+        // the default
+#define SWISS_CTRL_EMPTY ((uint8_t)0x80)   // Slot has never been used
+#define SWISS_CTRL_DELETED ((uint8_t)0xFE) // Slot held a removed entry
+
+/*
+ * Every slot has a control byte. Full slots store the low 7 bits of the hash
+ * (h2) so a probe can reject almost all non matching slots of a group with a
+ * single vector compare, without touching the slots themselves. The rest of
+ * the hash (h1) picks the first group to probe.
+ */
+#define SWISS_H1(h) ((h) >> 7)
+#define SWISS_H2(h) ((uint8_t)((h) & 0x7F))
+
+#if defined(__SSE2__)
+
+typedef uint32_t ht_groupmask_t;
+#define SWISS_MASK_SHIFT (0) // One mask bit per control byte
+
+/**
+ * __group_match:
+ *      Return a mask of the control bytes in a group equal to b.
+ */
+static inline ht_groupmask_t __group_match(const uint8_t *group, uint8_t b) {
+    const __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (ht_groupmask_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)b)));
+}
+
+/**
+ * __group_match_free:
+ *      Return a mask of the empty or deleted control bytes in a group.
+ */
+static inline ht_groupmask_t __group_match_free(const uint8_t *group) {
+    const __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (ht_groupmask_t)_mm_movemask_epi8(ctrl);
+}
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+typedef uint64_t ht_groupmask_t;
+#define SWISS_MASK_SHIFT (2) // One mask nibble per control byte
+
+/**
+ * __group_narrow:
+ *      Narrow a byte lane compare result to a mask with one nibble per lane.
+ */
+static inline ht_groupmask_t __group_narrow(uint8x16_t eq) {
+    const uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) &
+           0x8888888888888888ULL;
+}
+
+/**
+ * __group_match:
+ *      Return a mask of the control bytes in a group equal to b.
+ */
+static inline ht_groupmask_t __group_match(const uint8_t *group, uint8_t b) {
+    return __group_narrow(vceqq_u8(vld1q_u8(group), vdupq_n_u8(b)));
+}
+
+/**
+ * __group_match_free:
+ *      Return a mask of the empty or deleted control bytes in a group.
+ */
+static inline ht_groupmask_t __group_match_free(const uint8_t *group) {
+    const int8x16_t ctrl = vreinterpretq_s8_u8(vld1q_u8(group));
+    return __group_narrow(vcltq_s8(ctrl, vdupq_n_s8(0)));
+}
+
+#else
+
+typedef uint32_t ht_groupmask_t;
+#define SWISS_MASK_SHIFT (0) // One mask bit per control byte
+
+/**
+ * __group_match:
+ *      Return a mask of the control bytes in a group equal to b.
+ */
+static inline ht_groupmask_t __group_match(const uint8_t *group, uint8_t b) {
+    ht_groupmask_t mask = 0;
+
+    for (unsigned int i = 0; i < SWISS_GROUP_WIDTH; i++) {
+        if (group[i] == b) {
+            mask |= (ht_groupmask_t)1 << i;
+        }
+    }
+
+    return mask;
+}
+
+/**
+ * __group_match_free:
+ *      Return a mask of the empty or deleted control bytes in a group.
+ */
+static inline ht_groupmask_t __group_match_free(const uint8_t *group) {
+    ht_groupmask_t mask = 0;
+
+    for (unsigned int i = 0; i < SWISS_GROUP_WIDTH; i++) {
+        if (group[i] & 0x80) {
+            mask |= (ht_groupmask_t)1 << i;
+        }
+    }
+
+    return mask;
+}
+
+#endif
+
+/**
+ * __mask_first:
+ *      Return the group offset of the lowest set entry in a match mask.
+ */
+static inline unsigned int __mask_first(ht_groupmask_t mask) {
+    return (unsigned int)__builtin_ctzll((unsigned long long)mask) >>
+           SWISS_MASK_SHIFT;
+}
+
+/**
+ * __swiss_is_full:
+ *      Check if a control byte marks a slot holding an entry.
+ */
+static inline bool __swiss_is_full(uint8_t ctrl) { return !(ctrl & 0x80); }
+
+/**
+ * __swiss_max_load:
+ *      Number of entries a table of capacity can hold at it's max load
+ * factor, at least one.
+ */
+static size_t __swiss_max_load(const ht_t *ht, size_t capacity) {
+    const size_t max = (size_t)(capacity * ht->max_load);
+
+    return max ? max : 1;
+}
+
+/**
+ * __swiss_grow:
+ *      Return the capacity a table of capacity grows to.
+ */
+static size_t __swiss_grow(const ht_t *ht, size_t capacity) {
+    capacity *= (size_t)ht->growth;
+
+    return capacity < ht->max_capacity ? capacity : ht->max_capacity;
+}
+
+/**
+ * __swiss_find:
+ *      Probe the groups of a table for a key, returning it's slot index or
+ * capacity if the key is not in the table.
+ *      Groups are visited in triangular order, which reaches every group of
+ * a power of two sized table before repeating one. The probe ends at the
+ * first group with an empty slot, an insert would have used it.
+ */
+static size_t __swiss_find(const ht_t *ht, const ht_key_t *k) {
+    const size_t group_mask = ht->capacity / SWISS_GROUP_WIDTH - 1;
+    const uint8_t h2 = SWISS_H2(k->hash);
+    size_t group = SWISS_H1(k->hash) & group_mask;
+
+    for (size_t step = 0; step <= group_mask; step++) {
+        const uint8_t *ctrl = ht->ctrl + group * SWISS_GROUP_WIDTH;
+
+        for (ht_groupmask_t m = __group_match(ctrl, h2); m; m &= m - 1) {
+            const size_t idx = group * SWISS_GROUP_WIDTH + __mask_first(m);
+            const ht_slot_t *slot = __ht_slot(ht, idx);
+
+            if (__ht_key_match(ht, k, slot->hash, slot->key)) {
+                return idx;
+            }
+        }
+
+        if (__group_match(ctrl, SWISS_CTRL_EMPTY)) {
+            break;
+        }
+
+        group = (group + step + 1) & group_mask;
+    }
+
+    return ht->capacity;
+}
+
+/**
+ * __swiss_find_free:
+ *      Return the index of the first empty or deleted slot on the probe
+ * sequence of a hash, or capacity if there is none.
+ */
+static size_t __swiss_find_free(const uint8_t *ctrl, size_t capacity,
+                                ht_hashval_t hash) {
+    const size_t group_mask = capacity / SWISS_GROUP_WIDTH - 1;
+    size_t group = SWISS_H1(hash) & group_mask;
+
+    for (size_t step = 0; step <= group_mask; step++) {
+        const ht_groupmask_t m =
+            __group_match_free(ctrl + group * SWISS_GROUP_WIDTH);
+
+        if (m) {
+            return group * SWISS_GROUP_WIDTH + __mask_first(m);
+        }
+
+        group = (group + step + 1) & group_mask;
+    }
+
+    return capacity;
+}
+
+/**
+ * __swiss_alloc:
+ *      Allocate the control bytes and slots of slot_size bytes for a table of
+ * capacity.
+ */
+static bool __swiss_alloc(size_t capacity, size_t slot_size, uint8_t **ctrl,
+                          ht_slot_t **slots) {
+    *ctrl = malloc(capacity);
+    *slots = calloc(capacity, slot_size);
+    if (!*ctrl || !*slots) {
+        free(*ctrl);
+        free(*slots);
+        return false;
+    }
+
+    memset(*ctrl, SWISS_CTRL_EMPTY, capacity);
+
+    return true;
+}
+
+/**
+ * __swiss_resize:
+ *      Move every entry of a table into freshly allocated slots of capacity.
+ *      Deleted slots are dropped along the way, so resizing to the same
+ * capacity purges them. Slots store the full hash of their key so entries are
+ * placed without calling the hash function again.
+ */
+static bool __swiss_resize(ht_t *ht, size_t capacity) {
+    uint8_t *ctrl = NULL;
+    ht_slot_t *slots = NULL;
+
+    if (!__swiss_alloc(capacity, ht->slot_size, &ctrl, &slots)) {
+        perror("__swiss_resize");
+        return false;
+    }
+
+    for (size_t i = 0; i < ht->capacity; i++) {
+        if (!__swiss_is_full(ht->ctrl[i])) {
+            continue;
+        }
+
+        const ht_slot_t *slot = __ht_slot(ht, i);
+        const size_t idx = __swiss_find_free(ctrl, capacity, slot->hash);
+        ctrl[idx] = SWISS_H2(slot->hash);
+        __ht_slot_move(ht, HT_SLOT(slots, ht->slot_size, idx), slot);
+    }
+
+    free(ht->ctrl);
+    free(ht->slots);
+    ht->ctrl = ctrl;
+    ht->slots = slots;
+    ht->capacity = capacity;
+    ht->growth_left = __swiss_max_load(ht, capacity) - ht->used_buckets;
+
+    return true;
+}
+
+/**
+ * __swiss_rehash:
+ *      Make room for one more entry when a table has run out of growth.
+ *      If deleted slots make up a large share of the used slots the table is
+ * rebuilt at it's current capacity to reclaim them, otherwise it grows.
+ */
+static void __swiss_rehash(ht_t *ht) {
+    size_t capacity = ht->capacity;
+
+    if (ht->used_buckets >= __swiss_max_load(ht, capacity) / 2) {
+        capacity = __swiss_grow(ht, capacity);
+    }
+
+    __swiss_resize(ht, capacity);
+}
+
+/**
+ * __swiss_capacity_for:
+ *      Return the smallest capacity a Swiss table holding n entries can have.
+ */
+static size_t __swiss_capacity_for(const ht_t *ht, size_t n) {
+    size_t capacity = ht->initial_capacity;
+
+    while (__swiss_max_load(ht, capacity) < n &&
+           capacity < ht->max_capacity) {
+        capacity = __swiss_grow(ht, capacity);
+    }
+
+    return capacity;
+}
+
+/**
+ * __ht_swiss_reserve:
+ *      Size a Swiss table once to hold n entries without growing again.
+ */
+bool __ht_swiss_reserve(ht_t *ht, size_t n) {
+    size_t capacity = 0;
+
+    // The entries already there fit
+    if (n <= ht->used_buckets) {
+        return true;
+    }
+
+    capacity = __swiss_capacity_for(ht, n);
+    if (__swiss_max_load(ht, capacity) < n) {
+        return false;
+    }
+
+    if (capacity < ht->capacity) {
+        capacity = ht->capacity;
+    }
+
+    // Deleted slots count against growth, rebuilding drops them
+    if (capacity == ht->capacity && ht->growth_left >= n - ht->used_buckets) {
+        return true;
+    }
+
+    return __swiss_resize(ht, capacity);
+}
+
+/**
+ * __ht_swiss_shrink:
+ *      Shrink a Swiss table by it's growth factor once it's load falls below
+ * 1/SWISS_SHRINK_RATIO of it's max load, unless that would drop below the
+ * capacity reserved for it.
+ */
+void __ht_swiss_shrink(ht_t *ht) {
+    const size_t capacity = ht->capacity / (size_t)ht->growth;
+
+    if (capacity < ht->initial_capacity || ht->enumerators ||
+        ht->used_buckets >=
+            __swiss_max_load(ht, ht->capacity) / SWISS_SHRINK_RATIO ||
+        ht->reserved > __swiss_max_load(ht, capacity)) {
+        return;
+    }
+
+    __swiss_resize(ht, capacity);
+}
+
+/**
+ * __ht_swiss_shrink_to_fit:
+ *      Rebuild a Swiss table at the smallest capacity holding it's entries,
+ * dropping every deleted slot.
+ */
+bool __ht_swiss_shrink_to_fit(ht_t *ht) {
+    return __swiss_resize(ht, __swiss_capacity_for(ht, ht->used_buckets));
+}
+
+/**
+ * __ht_swiss_set_options:
+ *      Apply sizing options to an empty Swiss table, 0 fields keep their
+ * defaults. Capacities are rounded to powers of two within the limits of the
+ * engine, growth to a factor of 2 or 4, and the load factor is capped at
+ * SWISS_MAX_LOAD.
+ */
+bool __ht_swiss_set_options(ht_t *ht, const ht_options_t *opts) {
+    size_t max = opts->max_capacity ? opts->max_capacity : SWISS_MAX_CAPACITY;
+    size_t initial = opts->initial_capacity;
+
+    max = max < SWISS_MAX_CAPACITY ? max : SWISS_MAX_CAPACITY;
+    max = __ht_pow2_floor(max > SWISS_INITIAL_SLOTS ? max
+                                                    : SWISS_INITIAL_SLOTS);
+    initial = initial > SWISS_INITIAL_SLOTS ? initial : SWISS_INITIAL_SLOTS;
+    initial = initial < max ? __ht_pow2_ceil(initial) : max;
+
+    if (!__swiss_resize(ht, initial)) {
+        return false;
+    }
+
+    ht->max_load = opts->max_load_factor > 0 &&
+                           opts->max_load_factor < SWISS_MAX_LOAD
+                       ? opts->max_load_factor
+                       : SWISS_MAX_LOAD;
+    ht->growth = opts->growth_factor > 2 ? 4 : 2;
+    ht->initial_capacity = initial;
+    ht->max_capacity = max;
+    ht->growth_left = __swiss_max_load(ht, initial); // The table is empty
+
+    return true;
+}
+
+/**
+ * __ht_swiss_init:
+ *      Allocate the initial slots of a swiss table.
+ */
+bool __ht_swiss_init(ht_t *ht) {
+    if (!__swiss_alloc(SWISS_INITIAL_SLOTS, sizeof(*ht->slots), &ht->ctrl,
+                       &ht->slots)) {
+        perror("__ht_swiss_init");
+        return false;
+    }
+
+    ht->slot_size = sizeof(*ht->slots);
+    ht->max_load = SWISS_MAX_LOAD;
+    ht->growth = 2;
+    ht->initial_capacity = SWISS_INITIAL_SLOTS;
+    ht->max_capacity = SWISS_MAX_CAPACITY;
+    ht->capacity = SWISS_INITIAL_SLOTS;
+    ht->growth_left = __swiss_max_load(ht, SWISS_INITIAL_SLOTS);
+
+    return true;
+}
+
+/**
+ * __ht_swiss_destroy:
+ *      Free every entry of a swiss table and it's slots.
+ */
+void __ht_swiss_destroy(ht_t *ht) {
+    for (size_t i = 0; i < ht->capacity && __ht_entries_need_free(ht); i++) {
+        if (!__swiss_is_full(ht->ctrl[i])) {
+            continue;
+        }
+
+        __ht_key_free(ht, __ht_slot(ht, i)->key);
+        __ht_val_free(ht, __ht_slot(ht, i)->val);
+    }
+
+    free(ht->ctrl);
+    ht->ctrl = NULL;
+    free(ht->slots);
+    ht->slots = NULL;
+}
+
+/**
+ * __swiss_add:
+ *      Add a key that is not in a swiss table, growing the table if needed.
+ * Returns the slot of the new entry, or the capacity if the table is full.
+ */
+static size_t __swiss_add(ht_t *ht, const ht_key_t *k, const void *val) {
+    const ht_hashval_t hash = k->hash;
+    size_t idx = __swiss_find_free(ht->ctrl, ht->capacity, hash);
+
+    if (idx < ht->capacity && ht->ctrl[idx] == SWISS_CTRL_EMPTY &&
+        !ht->growth_left) {
+        __swiss_rehash(ht);
+        idx = __swiss_find_free(ht->ctrl, ht->capacity, hash);
+    }
+
+    if (idx >= ht->capacity) {
+        return ht->capacity;
+    }
+
+    if (ht->ctrl[idx] == SWISS_CTRL_EMPTY) {
+        if (!ht->growth_left) {
+            return ht->capacity;
+        }
+        ht->growth_left--;
+    }
+
+    ht->ctrl[idx] = SWISS_H2(hash);
+    __ht_slot_fill(ht, __ht_slot(ht, idx), k, val);
+    __ht_slot(ht, idx)->hash = hash;
+    ht->used_buckets++;
+
+    return idx;
+}
+
+/**
+ * __ht_swiss_insert:
+ *      Insert a key value pair into a swiss table, replacing the value if the
+ * key is already present. A unique key is not looked for. Returns false if a
+ * new key does not fit.
+ */
+bool __ht_swiss_insert(ht_t *ht, const ht_key_t *k, const void *val,
+                       bool unique) {
+    size_t idx = unique ? ht->capacity : __swiss_find(ht, k);
+
+    if (idx < ht->capacity) {
+        __ht_slot_set_val(ht, __ht_slot(ht, idx), val);
+        return true;
+    }
+
+    idx = __swiss_add(ht, k, val);
+
+    return idx < ht->capacity;
+}
+
+/**
+ * __ht_swiss_get_or_insert:
+ *      Return the val field of the slot of a key in a swiss table, adding the
+ * key with a NULL value if it is not there, or NULL if the table is full.
+ */
+const void **__ht_swiss_get_or_insert(ht_t *ht, const ht_key_t *k,
+                                      bool *inserted) {
+    size_t idx = __swiss_find(ht, k);
+
+    if (idx >= ht->capacity) {
+        idx = __swiss_add(ht, k, NULL);
+        if (idx >= ht->capacity) {
+            return NULL;
+        }
+        *inserted = true;
+    }
+
+    return &__ht_slot(ht, idx)->val;
+}
+
+/**
+ * __ht_swiss_remove:
+ *      Remove an entry from a swiss table, handing it's key and value to the
+ * caller through key and val where those are not NULL. Returns false if the
+ * key is not there.
+ *      A slot can only go back to empty if it's group still has an empty
+ * slot. Such a group has never been full, so no probe sequence continues past
+ * it. Otherwise the slot becomes a tombstone that keeps later probes going.
+ */
+bool __ht_swiss_remove(ht_t *ht, const ht_key_t *k, const void **key,
+                       const void **val) {
+    const size_t idx = __swiss_find(ht, k);
+    const uint8_t *group = NULL;
+    ht_slot_t *slot = NULL;
+
+    if (idx >= ht->capacity) {
+        return false;
+    }
+
+    slot = __ht_slot(ht, idx);
+    __ht_entry_release(ht, slot->key, slot->val, key, val);
+    slot->key = NULL;
+    slot->val = NULL;
+
+    group = ht->ctrl + idx - idx % SWISS_GROUP_WIDTH;
+    if (__group_match(group, SWISS_CTRL_EMPTY)) {
+        ht->ctrl[idx] = SWISS_CTRL_EMPTY;
+        ht->growth_left++;
+    } else {
+        ht->ctrl[idx] = SWISS_CTRL_DELETED;
+    }
+
+    ht->used_buckets--;
+
+    return true;
+}
+
+/**
+ * __ht_swiss_get:
+ *      Get a swiss table value given it's key and a pointer to store it's
+ * value.
+ */
+bool __ht_swiss_get(const ht_t *ht, const ht_key_t *k, void **val) {
+    const size_t idx = __swiss_find(ht, k);
+
+    if (idx >= ht->capacity) {
+        return false;
+    }
+
+    *val = __ht_val_ref(ht, &__ht_slot(ht, idx)->val);
+
+    return true;
+}
+
+/**
+ * __ht_swiss_prefetch:
+ *      Start loading the control bytes of the first group a key probes, or
+ * once they are loaded, the slots of the group it's hash matches.
+ */
+void __ht_swiss_prefetch(const ht_t *ht, const ht_key_t *k, bool slots) {
+    const size_t group_mask = ht->capacity / SWISS_GROUP_WIDTH - 1;
+    const size_t group = SWISS_H1(k->hash) & group_mask;
+    const uint8_t *ctrl = ht->ctrl + group * SWISS_GROUP_WIDTH;
+
+    if (!slots) {
+        HT_PREFETCH(ctrl);
+        return;
+    }
+
+    for (ht_groupmask_t m = __group_match(ctrl, SWISS_H2(k->hash)); m;
+         m &= m - 1) {
+        HT_PREFETCH(__ht_slot(ht, group * SWISS_GROUP_WIDTH + __mask_first(m)));
+    }
+}
+
+/**
+ * __ht_swiss_enum_next:
+ *      Get the key value information of the next full slot in a swiss table.
+ */
+bool __ht_swiss_enum_next(ht_enum_t *he, const void **key, const void **val) {
+    const ht_t *ht = he->ht;
+
+    while (he->idx < ht->capacity && !__swiss_is_full(ht->ctrl[he->idx])) {
+        he->idx++;
+    }
+
+    if (he->idx >= ht->capacity) {
+        return false;
+    }
+
+    *key = __ht_slot(ht, he->idx)->key;
+    *val = __ht_val_ref(ht, &__ht_slot(ht, he->idx)->val);
+    he->idx++;
+
+    return true;
+}
+
+/**
+ * __ht_swiss_foreach:
+ *      Call fn with the key and value fields of every entry of a swiss table.
+ */
+void __ht_swiss_foreach(ht_t *ht, ht_entry_fn fn, void *ctx) {
+    for (size_t i = 0; i < ht->capacity; i++) {
+        if (__swiss_is_full(ht->ctrl[i])) {
+            ht_slot_t *slot = __ht_slot(ht, i);
+
+            fn(&slot->key, &slot->val, ctx);
+        }
+    }
+}
@@ -0,0 +1,413 @@
+/* ht_wyhash.c - Word at a time string hash after Wang Yi's wyhash.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht_private.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WY_AVX2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WY_NEON
+#endif
+
+/*
+ * Keys are consumed 8 and 16 bytes at a time, each step a 64x64->128 bit
+ * multiply whose halves are folded together, instead of one multiply per byte
+ * as in FNV1A. Keys of WY_LONG_KEY bytes or more are first run through eight
+ * accumulators a 64 byte stripe at a time, a kernel picked once at load time
+ * for the CPU does that part with AVX2 or NEON where available. Every kernel
+ * gives the same hash, the vector ones only do it faster.
+ *
+ * Case insensitive hashes fold the case of the key a word at a time as it is
+ * read, giving the same hash tolower would.
+ */
+
+#define WY_LONG_KEY (256)    // Keys at least this long are hashed in stripes
+#define WY_STRIPE (64)       // Bytes consumed by one step of the accumulators
+#define WY_BLOCK_STRIPES (8) // Stripes between scrambles of the accumulators
+#define WY_BLOCK (WY_STRIPE * WY_BLOCK_STRIPES)
+#define WY_PRIME (0x9E3779B185EBCA87) // Odd multiplier of the scramble
+
+static const uint64_t __wy_secret[4] = {
+    0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3,
+    0x4d5a2da51de1aa47};
+
+// Stripe s of a block is keyed with entries s to s + 7
+static const uint64_t __wy_stripe_secret[16] = {
+    0x90b05b7dce8c81bb, 0xed975c6394d0c6f7, 0x21f876f3512549c7,
+    0x722daa341cdd9ed3, 0x1a127618f8c0c7c9, 0x4604c1f3c4bf31f3,
+    0x3be4b26906afd373, 0x4ed0cad92b342bcb, 0xf2f6319289454975,
+    0x8af8902d5cebbb29, 0x308d3be576f43231, 0x01b9443f169da445,
+    0x755efb72232b0cdb, 0x90cfd594d75992fb, 0x35fb208e1a4d24f7,
+    0xe05c3f7eb06e580f};
+
+/**
+ * __wy_mum:
+ *      Multiply a and b, storing the low half of the 128 bit product in a and
+ * the high half in b.
+ */
+static inline void __wy_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t r = (__uint128_t)*a * *b;
+
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    const uint64_t ha = *a >> 32, hb = *b >> 32;
+    const uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    const uint64_t lo = t + (rm1 << 32);
+    const uint64_t c = (t < rl) + (lo < t);
+
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/**
+ * __wy_mix:
+ *      Return the halves of the 128 bit product of a and b folded together.
+ */
+static inline uint64_t __wy_mix(uint64_t a, uint64_t b) {
+    __wy_mum(&a, &b);
+    return a ^ b;
+}
+
+/**
+ * __wy_r8:
+ *      Read 8 bytes of a key, folding their case if fold is true.
+ */
+static inline uint64_t __wy_r8(const uint8_t *p, bool fold) {
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return fold ? __ht_fold_word(v) : v;
+}
+
+/**
+ * __wy_r4:
+ *      Read 4 bytes of a key, folding their case if fold is true.
+ */
+static inline uint64_t __wy_r4(const uint8_t *p, bool fold) {
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return fold ? __ht_fold_word(v) : v;
+}
+
+/**
+ * __wy_r3:
+ *      Read the first, middle and last byte of a key of 1 to 3 bytes.
+ */
+static inline uint64_t __wy_r3(const uint8_t *p, size_t len, bool fold) {
+    const uint64_t v = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) |
+                       p[len - 1];
+
+    return fold ? __ht_fold_word(v) : v;
+}
+
+/**
+ * __wy_block_scalar:
+ *      Run one block of stripes through the accumulators. Each lane adds the
+ * product of the halves of it's keyed input word, and the unkeyed word of it's
+ * neighbour lane so no input bit is lost when a product is zero.
+ */
+static void __wy_block_scalar(uint64_t *acc, const uint8_t *p) {
+    for (size_t s = 0; s < WY_BLOCK_STRIPES; s++, p += WY_STRIPE) {
+        const uint64_t *key = __wy_stripe_secret + s;
+
+        for (size_t i = 0; i < 8; i++) {
+            const uint64_t data = __wy_r8(p + 8 * i, false);
+            const uint64_t dk = data ^ key[i];
+
+            acc[i ^ 1] += data;
+            acc[i] += (dk & 0xffffffff) * (dk >> 32);
+        }
+    }
+}
+
+#if defined(WY_AVX2)
+
+/**
+ * __wy_block_avx2:
+ *      __wy_block_scalar four lanes at a time with AVX2.
+ */
+__attribute__((target("avx2"))) static void
+__wy_block_avx2(uint64_t *acc, const uint8_t *p) {
+    __m256i a[2];
+
+    a[0] = _mm256_loadu_si256((const __m256i *)acc);
+    a[1] = _mm256_loadu_si256((const __m256i *)(acc + 4));
+
+    for (size_t s = 0; s < WY_BLOCK_STRIPES; s++, p += WY_STRIPE) {
+        for (size_t h = 0; h < 2; h++) {
+            const __m256i data =
+                _mm256_loadu_si256((const __m256i *)(p + 32 * h));
+            const __m256i key = _mm256_loadu_si256(
+                (const __m256i *)(__wy_stripe_secret + s + 4 * h));
+            const __m256i dk = _mm256_xor_si256(data, key);
+            const __m256i prod =
+                _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+            const __m256i swap =
+                _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+            a[h] = _mm256_add_epi64(a[h], _mm256_add_epi64(prod, swap));
+        }
+    }
+
+    _mm256_storeu_si256((__m256i *)acc, a[0]);
+    _mm256_storeu_si256((__m256i *)(acc + 4), a[1]);
+}
+
+#elif defined(WY_NEON)
+
+/**
+ * __wy_block_neon:
+ *      __wy_block_scalar two lanes at a time with NEON.
+ */
+static void __wy_block_neon(uint64_t *acc, const uint8_t *p) {
+    uint64x2_t a[4];
+
+    for (size_t i = 0; i < 4; i++) {
+        a[i] = vld1q_u64(acc + 2 * i);
+    }
+
+    for (size_t s = 0; s < WY_BLOCK_STRIPES; s++, p += WY_STRIPE) {
+        for (size_t i = 0; i < 4; i++) {
+            const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(p + 16 * i));
+            const uint64x2_t key = vld1q_u64(__wy_stripe_secret + s + 2 * i);
+            const uint64x2_t dk = veorq_u64(data, key);
+            const uint64x2_t prod =
+                vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+
+            a[i] = vaddq_u64(a[i],
+                             vaddq_u64(prod, vextq_u64(data, data, 1)));
+        }
+    }
+
+    for (size_t i = 0; i < 4; i++) {
+        vst1q_u64(acc + 2 * i, a[i]);
+    }
+}
+
+#endif
+
+// Block kernel used for long keys, the fastest one the CPU supports
+#if defined(WY_NEON)
+static void (*__wy_block)(uint64_t *, const uint8_t *) = __wy_block_neon;
+#else
+static void (*__wy_block)(uint64_t *, const uint8_t *) = __wy_block_scalar;
+#endif
+
+#if defined(WY_AVX2)
+
+/**
+ * __wy_dispatch:
+ *      Pick the AVX2 block kernel when the library is loaded on a CPU that
+ * has it.
+ */
+__attribute__((constructor)) static void __wy_dispatch(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        __wy_block = __wy_block_avx2;
+    }
+}
+
+#endif
+
+/**
+ * __wy_hash_blocks:
+ *      Consume the whole blocks at the start of a long key and return the
+ * seed for hashing the rest, advancing p and len past the blocks.
+ */
+static uint64_t __wy_hash_blocks(const uint8_t **p, size_t *len, uint64_t seed,
+                                 bool fold) {
+    uint64_t acc[8];
+    uint64_t buf[WY_BLOCK / sizeof(uint64_t)];
+
+    for (size_t i = 0; i < 8; i++) {
+        acc[i] = seed ^ __wy_stripe_secret[i];
+    }
+
+    while (*len >= WY_BLOCK) {
+        if (fold) {
+            for (size_t i = 0; i < WY_BLOCK / sizeof(uint64_t); i++) {
+                buf[i] = __wy_r8(*p + 8 * i, true);
+            }
+            __wy_block(acc, (const uint8_t *)buf);
+        } else {
+            __wy_block(acc, *p);
+        }
+
+        // Keep whole blocks from cancelling out when swapped
+        for (size_t i = 0; i < 8; i++) {
+            acc[i] = (acc[i] ^ (acc[i] >> 47) ^ __wy_stripe_secret[i + 8]) *
+                     WY_PRIME;
+        }
+
+        *p += WY_BLOCK;
+        *len -= WY_BLOCK;
+    }
+
+    for (size_t i = 0; i < 8; i += 2) {
+        seed = __wy_mix(acc[i] ^ __wy_secret[1], acc[i + 1] ^ seed);
+    }
+
+    return seed;
+}
+
+/**
+ * __wy_hash:
+ *      Return a 64 bit hash of len bytes of key.
+ */
+static uint64_t __wy_hash(const void *key, size_t len, uint64_t seed,
+                          bool fold) {
+    const uint8_t *p = key;
+    const size_t total = len;
+    uint64_t a, b;
+
+    seed ^= __wy_mix(seed ^ __wy_secret[0], __wy_secret[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            const size_t m = (len >> 3) << 2;
+
+            a = (__wy_r4(p, fold) << 32) | __wy_r4(p + m, fold);
+            b = (__wy_r4(p + len - 4, fold) << 32) |
+                __wy_r4(p + len - 4 - m, fold);
+        } else if (len > 0) {
+            a = __wy_r3(p, len, fold);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        if (len >= WY_LONG_KEY) {
+            seed = __wy_hash_blocks(&p, &len, seed, fold);
+        }
+
+        if (len > 48) {
+            uint64_t see1 = seed, see2 = seed;
+
+            do {
+                seed = __wy_mix(__wy_r8(p, fold) ^ __wy_secret[1],
+                                __wy_r8(p + 8, fold) ^ seed);
+                see1 = __wy_mix(__wy_r8(p + 16, fold) ^ __wy_secret[2],
+                                __wy_r8(p + 24, fold) ^ see1);
+                see2 = __wy_mix(__wy_r8(p + 32, fold) ^ __wy_secret[3],
+                                __wy_r8(p + 40, fold) ^ see2);
+                p += 48;
+                len -= 48;
+            } while (len > 48);
+
+            seed ^= see1 ^ see2;
+        }
+
+        while (len > 16) {
+            seed = __wy_mix(__wy_r8(p, fold) ^ __wy_secret[1],
+                            __wy_r8(p + 8, fold) ^ seed);
+            p += 16;
+            len -= 16;
+        }
+
+        // The last 16 bytes of the key, overlapping ones already hashed
+        a = __wy_r8(p + len - 16, fold);
+        b = __wy_r8(p + len - 8, fold);
+    }
+
+    a ^= __wy_secret[1];
+    b ^= seed;
+    __wy_mum(&a, &b);
+
+    return __wy_mix(a ^ __wy_secret[0] ^ total, b ^ __wy_secret[1]);
+}
+
+#if defined(CPU_32_BIT)
+
+/**
+ * __wy_hash32:
+ *      Fold a 64 bit hash of len bytes of key to 32 bits.
+ */
+static uint32_t __wy_hash32(const void *key, size_t len, uint32_t seed,
+                            bool fold) {
+    const uint64_t h = __wy_hash(key, len, seed, fold);
+
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * wy_hash_str:
+ *      Wrapper around __wy_hash that uses case sensitive keys.
+ */
+uint32_t wy_hash_str(const void *key, uint32_t seed) {
+    return __wy_hash32(key, strlen(key), seed, false);
+}
+
+/**
+ * wy_hash_str_casecmp:
+ *      Wrapper around __wy_hash that uses case insensitive keys.
+ */
+uint32_t wy_hash_str_casecmp(const void *key, uint32_t seed) {
+    return __wy_hash32(key, strlen(key), seed, true);
+}
+
+/**
+ * wy_hash_str_n:
+ *      Wrapper around __wy_hash that uses case sensitive keys of len bytes.
+ */
+uint32_t wy_hash_str_n(const void *key, size_t len, uint32_t seed) {
+    return __wy_hash32(key, len, seed, false);
+}
+
+/**
+ * wy_hash_str_casecmp_n:
+ *      Wrapper around __wy_hash that uses case insensitive keys of len bytes.
+ */
+uint32_t wy_hash_str_casecmp_n(const void *key, size_t len, uint32_t seed) {
+    return __wy_hash32(key, len, seed, true);
+}
+
+#else
+
+/**
+ * wy_hash_str:
+ *      Wrapper around __wy_hash that uses case sensitive keys.
+ */
+uint64_t wy_hash_str(const void *key, uint64_t seed) {
+    return __wy_hash(key, strlen(key), seed, false);
+}
+
+/**
+ * wy_hash_str_casecmp:
+ *      Wrapper around __wy_hash that uses case insensitive keys.
+ */
+uint64_t wy_hash_str_casecmp(const void *key, uint64_t seed) {
+    return __wy_hash(key, strlen(key), seed, true);
+}
+
+/**
+ * wy_hash_str_n:
+ *      Wrapper around __wy_hash that uses case sensitive keys of len bytes.
+ */
+uint64_t wy_hash_str_n(const void *key, size_t len, uint64_t seed) {
+    return __wy_hash(key, len, seed, false);
+}
+
+/**
+ * wy_hash_str_casecmp_n:
+ *      Wrapper around __wy_hash that uses case insensitive keys of len bytes.
+ */
+uint64_t wy_hash_str_casecmp_n(const void *key, size_t len, uint64_t seed) {
+    return __wy_hash(key, len, seed, true);
+}
+
+#endif
@@ -0,0 +1,141 @@
+/* ht_arena_test.c - Test program for tables keeping strings in an arena.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENTRIES (20000)
+
+/**
+ * check_strstr:
+ *      Fill, change and compact an arena string->string table, checking every
+ * entry survives.
+ */
+static bool check_strstr(unsigned int flags) {
+    ht_strstr_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const char *a = NULL;
+    const char *b = NULL;
+    size_t live = 0, dead = 0, count = 0;
+    char t1[64] = {'\0'};
+    char t2[64] = {'\0'};
+    bool ok = true;
+
+    ht = ht_strstr_create(flags | HT_STR_ARENA);
+    if (!ht) {
+        return false;
+    }
+
+    for (size_t i = 0; i < ENTRIES; i++) {
+        snprintf(t1, sizeof(t1), "key%zu", i);
+        snprintf(t2, sizeof(t2), "first%zu", i);
+        ht_strstr_insert(ht, t1, t2);
+    }
+
+    // Replace the values of odd keys, remove even keys
+    for (size_t i = 0; i < ENTRIES; i++) {
+        snprintf(t1, sizeof(t1), "key%zu", i);
+        if (i % 2) {
+            snprintf(t2, sizeof(t2), "second%zu", i);
+            ht_strstr_insert(ht, t1, t2);
+        } else {
+            ht_strstr_remove(ht, t1);
+        }
+    }
+
+    ht_arena_stats((ht_t *)ht, &live, &dead);
+    printf("flags=%u before compaction: live=%zu dead=%zu\n", flags, live,
+           dead);
+    if (!live || !dead) {
+        ok = false;
+    }
+
+    if (!ht_strstr_compact(ht)) {
+        ok = false;
+    }
+
+    ht_arena_stats((ht_t *)ht, &live, &dead);
+    printf("flags=%u after compaction: live=%zu dead=%zu\n", flags, live,
+           dead);
+    if (!live || dead) {
+        ok = false;
+    }
+
+    for (size_t i = 0; i < ENTRIES; i++) {
+        snprintf(t1, sizeof(t1), "key%zu", i);
+        snprintf(t2, sizeof(t2), "second%zu", i);
+        b = ht_strstr_get(ht, t1);
+        if ((i % 2 && (!b || strcmp(b, t2) != 0)) || (!(i % 2) && b)) {
+            printf("wrong value for %s\n", t1);
+            ok = false;
+        }
+    }
+
+    he = ht_strstr_enum_create(ht);
+    while (he && ht_strstr_enum_next(he, &a, &b)) {
+        if (str_pack_len(a) != strlen(a) || strncmp(b, "second", 6) != 0) {
+            ok = false;
+        }
+        count++;
+    }
+    ht_strstr_enum_destroy(he);
+
+    if (count != ENTRIES / 2) {
+        ok = false;
+    }
+
+    ht_strstr_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_strint_t *hi = NULL;
+    int val = 0;
+    size_t live = 0, dead = 0;
+    char t1[64] = {'\0'};
+
+    if (!check_strstr(HT_STR_NONE) || !check_strstr(HT_REHASH_INCREMENTAL) ||
+        !check_strstr(HT_STR_CASECMP | HT_STR_PACKED) ||
+        !check_strstr(HT_ENGINE_SWISS) || !check_strstr(HT_ENGINE_ROBINHOOD)) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Only keys go to the arena of a string->int table
+    hi = ht_strint_create(HT_STR_ARENA);
+    if (!hi) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(t1, sizeof(t1), "key%d", i);
+        ht_strint_insert(hi, t1, &i);
+    }
+
+    for (int i = 0; i < 1000; i += 2) {
+        snprintf(t1, sizeof(t1), "key%d", i);
+        ht_strint_remove(hi, t1);
+    }
+
+    ht_strint_compact(hi);
+    ht_arena_stats((ht_t *)hi, &live, &dead);
+    printf("strint arena: live=%zu dead=%zu\n", live, dead);
+
+    if (dead || !ht_strint_get_val(hi, "key999", &val) || val != 999 ||
+        ht_strint_get(hi, "key998")) {
+        ht_strint_destroy(hi);
+        exit(EXIT_FAILURE);
+    }
+
+    ht_strint_destroy(hi);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+/* ht_casefold_test.c - Test program for case insensitive key comparison.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define MAX_LEN (100)
+#define KEYS (1000)
+
+// Letters next to bytes that differ from them only in the case bit
+static const char *chars = "aZ@`[{^~09-_ \x7f\xc0\xe0";
+
+/**
+ * check_eq:
+ *      Compare keys of every length up to MAX_LEN with a copy in the other
+ * case, then with a copy differing in one byte at every position, and check
+ * str_caseeq_n agrees with strcasecmp.
+ */
+static bool check_eq(void) {
+    char a[MAX_LEN + 1], b[MAX_LEN + 1];
+    const size_t nchars = strlen(chars);
+
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        for (size_t i = 0; i < len; i++) {
+            a[i] = chars[(i * 7 + len) % nchars];
+            b[i] = i % 2 ? (char)toupper((unsigned char)a[i]) : a[i];
+        }
+        a[len] = b[len] = '\0';
+
+        if (!str_caseeq_n(a, len, b, len) || !str_caseeq(a, b)) {
+            printf("keys of length %zu differ\n", len);
+            return false;
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            const char c = b[i];
+
+            b[i] ^= 0x20;
+            if (str_caseeq_n(a, len, b, len) != (strcasecmp(a, b) == 0)) {
+                printf("keys of length %zu compare wrong at %zu\n", len, i);
+                return false;
+            }
+            b[i] = c;
+        }
+    }
+
+    return !str_caseeq_n("abc", 3, "abcd", 4);
+}
+
+int main(int argc, char **argv) {
+    ht_strint_t *ht = NULL;
+    char key[64] = {'\0'};
+    int val = 0;
+
+    if (!check_eq()) {
+        exit(EXIT_FAILURE);
+    }
+
+    ht = ht_strint_create(HT_STR_CASECMP | HT_STR_PACKED | HT_SEED_RANDOM);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "X-Forwarded-Header-Number-%d", i);
+        ht_strint_insert(ht, key, &i);
+    }
+
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "x-forwarded-HEADER-number-%d", i);
+        if (!ht_strint_get_val(ht, key, &val) || val != i) {
+            printf("key %s not found\n", key);
+            ht_strint_destroy(ht);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("%d case insensitive keys found\n", KEYS);
+
+    ht_strint_destroy(ht);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/* ht_chain_test.c - Test program for indexed long collision chains.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (2000)
+#define MAX_COMPARES (32) // Compares allowed per lookup, log2(KEYS) is 11
+
+static size_t compares = 0;
+
+/**
+ * same_bucket_hash:
+ *      Hash keys to distinct values that all land in the same bucket.
+ */
+#if defined(CPU_32_BIT)
+static uint32_t same_bucket_hash(const void *key, uint32_t seed) {
+    return (fnv1a_hash_str(key, seed) | 1) << 16;
+}
+#else
+static uint64_t same_bucket_hash(const void *key, uint64_t seed) {
+    return (fnv1a_hash_str(key, seed) | 1) << 32;
+}
+#endif
+
+/**
+ * same_hash:
+ *      Hash every key to the same value.
+ */
+#if defined(CPU_32_BIT)
+static uint32_t same_hash(const void *key, uint32_t seed) { return seed; }
+#else
+static uint64_t same_hash(const void *key, uint64_t seed) { return seed; }
+#endif
+
+/**
+ * same_hash_n:
+ *      Hash every key of known length to the same value.
+ */
+#if defined(CPU_32_BIT)
+static uint32_t same_hash_n(const void *key, size_t len, uint32_t seed) {
+    return seed;
+}
+#else
+static uint64_t same_hash_n(const void *key, size_t len, uint64_t seed) {
+    return seed;
+}
+#endif
+
+/**
+ * counted_eq:
+ *      String equality counting it's calls.
+ */
+static bool counted_eq(const void *a, const void *b) {
+    compares++;
+    return str_eq(a, b);
+}
+
+/**
+ * counted_cmp:
+ *      String ordering counting it's calls.
+ */
+static int counted_cmp(const void *a, const void *b) {
+    compares++;
+    return str_cmp(a, b);
+}
+
+/**
+ * check_table:
+ *      Insert KEYS colliding keys, replace, look up and remove them, checking
+ * the table holds what it should and lookups take at most MAX_COMPARES key
+ * compares.
+ */
+static bool check_table(ht_hash hash, bool ordered, unsigned int flags) {
+    ht_callbacks_t callbacks = {
+        (void *(*)(const void *))strdup, (void (*)(const void *))free,
+        (void *(*)(const void *))strdup, (void (*)(const void *))free, NULL};
+    ht_t *ht = ht_create(hash, counted_eq, &callbacks, flags);
+    char key[32], val[32];
+    const char *v = NULL;
+    size_t most = 0;
+    bool ok = true;
+
+    if (!ht || (ordered && !ht_set_keycmp(ht, counted_cmp))) {
+        ht_destroy(ht);
+        return false;
+    }
+
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "%d", i);
+        ht_insert(ht, key, val);
+    }
+
+    // Replace every other value
+    for (int i = 0; i < KEYS; i += 2) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "%d", -i);
+        ht_insert(ht, key, val);
+    }
+
+    for (int i = 0; i < KEYS && ok; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "%d", i % 2 ? i : -i);
+        compares = 0;
+        v = ht_get(ht, key);
+        most = compares > most ? compares : most;
+        ok = v && strcmp(v, val) == 0;
+    }
+
+    // Remove all keys but every third one, shrinking the chain below the
+    // point it is indexed at
+    for (int i = 0; i < KEYS && ok; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        if (i % 3) {
+            ht_remove(ht, key);
+        }
+    }
+
+    for (int i = 0; i < KEYS && ok; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        compares = 0;
+        v = ht_get(ht, key);
+        most = compares > most ? compares : most;
+        ok = (v != NULL) == !(i % 3);
+    }
+
+    for (int i = 0; i < KEYS && ok; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        ht_remove(ht, key);
+    }
+
+    snprintf(key, sizeof(key), "key%d", 0);
+    ok = ok && !ht_get(ht, key);
+
+    printf("%s hashes%s: at most %zu compares per lookup\n",
+           hash == same_hash ? "equal" : "distinct",
+           ordered ? ", ordered keys" : "", most);
+
+    ht_destroy(ht);
+
+    return ok && most <= MAX_COMPARES;
+}
+
+int main(int argc, char **argv) {
+    ht_t *ht = NULL;
+    char key[32];
+    bool ok = true;
+
+    if (!check_table(same_bucket_hash, false, HT_STR_NONE) ||
+        !check_table(same_bucket_hash, false, HT_REHASH_INCREMENTAL) ||
+        !check_table(same_hash, true, HT_STR_NONE) ||
+        !check_table(same_hash, true, HT_REHASH_INCREMENTAL)) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Length aware tables order keys of equal hash by length and bytes
+    ht = ht_create_n(same_hash_n, str_caseeq_n, NULL, HT_STR_NONE);
+    if (!ht || !ht_set_keycmp_n(ht, str_casecmp_n) ||
+        ht_set_keycmp(ht, str_casecmp)) {
+        ht_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "Key%d", i);
+        ht_insert_n(ht, key, strlen(key), (void *)(intptr_t)(i + 1));
+    }
+
+    for (int i = 0; i < KEYS && ok; i++) {
+        snprintf(key, sizeof(key), "KEY%d", i);
+        ok = ht_get_n(ht, key, strlen(key)) == (void *)(intptr_t)(i + 1);
+        ht_remove_n(ht, key, strlen(key));
+        ok = ok && !ht_get_n(ht, key, strlen(key));
+    }
+
+    ht_destroy(ht);
+
+    return ok ? 0 : EXIT_FAILURE;
+}
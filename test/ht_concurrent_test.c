@@ -0,0 +1,161 @@
+/* ht_concurrent_test.c - Test program for the lock striped concurrent table.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS (8)
+#define KEYS (20000)  // Keys of each thread
+#define SHARED (16)   // Keys every thread writes and reads
+#define ROUNDS (5000) // Writes of the shared keys by each thread
+
+typedef struct {
+    ht_concurrent_t *ct;
+    int id;
+    bool ok;
+} worker_t;
+
+/**
+ * copy_val:
+ *      Copy a string value out of the table while it's shard is locked.
+ */
+static void copy_val(const void *val, void *ctx) {
+    strcpy(ctx, val);
+}
+
+/**
+ * work:
+ *      Insert, read back and remove keys of a thread's own, while writing and
+ * reading keys shared with every other thread.
+ */
+static void *work(void *arg) {
+    worker_t *w = arg;
+    char key[32], val[32], got[32];
+
+    w->ok = true;
+
+    for (int i = 0; i < KEYS && w->ok; i++) {
+        snprintf(key, sizeof(key), "t%d-key%d", w->id, i);
+        snprintf(val, sizeof(val), "%d", i);
+        w->ok = ht_concurrent_insert(w->ct, key, val);
+
+        if (i % 4 == 0) {
+            snprintf(key, sizeof(key), "shared%d", i / 4 % SHARED);
+            snprintf(val, sizeof(val), "t%d", w->id);
+            w->ok = w->ok && ht_concurrent_insert(w->ct, key, val);
+        }
+    }
+
+    for (int i = 0; i < ROUNDS && w->ok; i++) {
+        snprintf(key, sizeof(key), "shared%d", i % SHARED);
+        // Whichever thread wrote it last, the value is whole
+        w->ok = ht_concurrent_get_with(w->ct, key, copy_val, got) &&
+                got[0] == 't' && atoi(got + 1) < THREADS;
+    }
+
+    for (int i = 0; i < KEYS && w->ok; i++) {
+        snprintf(key, sizeof(key), "t%d-key%d", w->id, i);
+        snprintf(val, sizeof(val), "%d", i);
+        w->ok = ht_concurrent_get_with(w->ct, key, copy_val, got) &&
+                strcmp(got, val) == 0;
+        if (i % 2) {
+            ht_concurrent_remove(w->ct, key);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * count_shards:
+ *      Count the entries of a table shard by shard.
+ */
+static size_t count_shards(ht_concurrent_t *ct) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < ht_concurrent_shards(ct); i++) {
+        ht_concurrent_enum_t *ce = ht_concurrent_shard_enum_create(ct, i);
+
+        while (ht_concurrent_enum_next(ce, NULL, NULL)) {
+            count++;
+        }
+
+        ht_concurrent_enum_destroy(ce);
+    }
+
+    return count;
+}
+
+int main(int argc, char **argv) {
+    ht_callbacks_t callbacks = {
+        (void *(*)(const void *))strdup, (void (*)(const void *))free,
+        (void *(*)(const void *))strdup, (void (*)(const void *))free, NULL};
+    const unsigned int flags[] = {HT_STR_NONE, HT_REHASH_INCREMENTAL,
+                                  HT_ENGINE_SWISS, HT_ENGINE_ROBINHOOD};
+    const size_t shards[] = {0, 64, 3, 1}; // 0 for the default
+    const size_t expected = THREADS * KEYS / 2 + SHARED;
+    pthread_t threads[THREADS];
+    worker_t workers[THREADS];
+    ht_concurrent_enum_t *ce = NULL;
+    const void *key = NULL, *val = NULL;
+    char buf[32];
+    size_t count = 0;
+    bool ok = true;
+
+    for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]) && ok; f++) {
+        ht_concurrent_t *ct = ht_concurrent_create(
+            fnv1a_hash_str, str_eq, &callbacks, flags[f] | HT_SEED_RANDOM,
+            shards[f]);
+
+        if (!ct) {
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0; i < THREADS; i++) {
+            workers[i].ct = ct;
+            workers[i].id = i;
+            pthread_create(threads + i, NULL, work, workers + i);
+        }
+
+        for (int i = 0; i < THREADS; i++) {
+            pthread_join(threads[i], NULL);
+            ok = ok && workers[i].ok;
+        }
+
+        count = 0;
+        ce = ht_concurrent_enum_create(ct);
+        while (ht_concurrent_enum_next(ce, &key, &val)) {
+            ok = ok && (strncmp(key, "shared", 6) == 0 || atoi(val) % 2 == 0);
+            count++;
+        }
+        ht_concurrent_enum_destroy(ce);
+
+        for (int i = 0; ok && i < THREADS; i++) {
+            snprintf(buf, sizeof(buf), "t%d-key%d", i, KEYS - 1);
+            ok = !ht_concurrent_get(ct, buf);
+        }
+
+        ok = ok && count == expected && count_shards(ct) == expected;
+
+        printf("flags %u: %d threads, %zu shards, %zu keys left %s\n",
+               flags[f], THREADS, ht_concurrent_shards(ct), count,
+               ok ? "ok" : "failed");
+
+        ht_concurrent_destroy(ct);
+    }
+
+    ok = ok && !ht_concurrent_create(fnv1a_hash_str, str_eq, NULL, 0,
+                                     (size_t)1 << 20);
+    ok = ok && !ht_concurrent_insert(NULL, "key", "val");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
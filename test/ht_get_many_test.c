@@ -0,0 +1,101 @@
+/* ht_get_many_test.c - Test program for batched lookups.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (50000)
+#define LOOKUPS (1000) // Keys looked up per batch, half of them missing
+
+static char keys[KEYS * 2][16];
+static const void *batch[LOOKUPS];
+static void *vals[LOOKUPS];
+
+/**
+ * check_table:
+ *      Fill a table with every other key, then look all keys up in batches,
+ * a few of them NULL, comparing with single lookups.
+ */
+static bool check_table(unsigned int flags) {
+    ht_t *ht = ht_create(fnv1a_hash_str, str_eq, NULL, flags);
+    bool ok = ht != NULL;
+
+    for (size_t i = 0; ok && i < KEYS * 2; i += 2) {
+        ht_insert(ht, keys[i], keys[i]);
+    }
+
+    for (size_t base = 0; ok && base < KEYS * 2; base += LOOKUPS) {
+        size_t present = 0;
+
+        for (size_t i = 0; i < LOOKUPS; i++) {
+            batch[i] = i % 97 ? keys[base + i] : NULL;
+            present += batch[i] && (base + i) % 2 == 0;
+        }
+
+        ok = ht_get_many(ht, batch, LOOKUPS, vals) == present;
+
+        for (size_t i = 0; ok && i < LOOKUPS; i++) {
+            ok = vals[i] == (batch[i] ? ht_get(ht, batch[i]) : NULL) &&
+                 vals[i] == ((base + i) % 2 || !batch[i] ? NULL : batch[i]);
+        }
+    }
+
+    // Partial batches, and none at all
+    ok = ok && ht_get_many(ht, batch, 5, vals) == 2 &&
+         vals[2] == batch[2] && ht_get_many(ht, batch, 0, vals) == 0 &&
+         ht_get_many(NULL, batch, 5, vals) == 0;
+
+    printf("flags %u: %d keys looked up in batches %s\n", flags, KEYS * 2,
+           ok ? "ok" : "failed");
+
+    ht_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *strkeys[4] = {"one", "two", "three", NULL};
+    const char *strvals[4];
+    void *intvals[4];
+    ht_strstr_t *strstr = NULL;
+    ht_strint_t *strint = NULL;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS * 2; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+
+    if (!check_table(HT_STR_NONE) || !check_table(HT_REHASH_INCREMENTAL) ||
+        !check_table(HT_ENGINE_SWISS) || !check_table(HT_ENGINE_ROBINHOOD) ||
+        !check_table(HT_STR_CASECMP)) {
+        exit(EXIT_FAILURE);
+    }
+
+    strstr = ht_strstr_create(HT_STR_NONE);
+    ht_strstr_insert(strstr, "one", "1");
+    ht_strstr_insert(strstr, "three", "3");
+    ok = ht_strstr_get_many(strstr, strkeys, 4, strvals) == 2 &&
+         strcmp(strvals[0], "1") == 0 && !strvals[1] &&
+         strcmp(strvals[2], "3") == 0 && !strvals[3];
+    ht_strstr_destroy(strstr);
+
+    strint = ht_strint_create(HT_STR_NONE);
+    for (int i = 0; i < 3; i++) {
+        ht_strint_insert(strint, strkeys[i], &i);
+    }
+    ok = ok && ht_strint_get_many(strint, strkeys, 4, intvals) == 3 &&
+         *(int *)intvals[0] == 0 && *(int *)intvals[2] == 2 && !intvals[3];
+    ht_strint_destroy(strint);
+
+    printf("typed tables looked up in batches %s\n", ok ? "ok" : "failed");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,147 @@
+/* ht_get_or_insert_test.c - Test program for single lookup upserts.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORDS (20000) // Distinct words counted
+#define REPEATS (5)   // Times the words are counted over
+
+static char words[WORDS][16];
+
+/**
+ * dup_double:
+ *      Copy a double into memory of it's own.
+ */
+static void *dup_double(const void *val) {
+    double *d = malloc(sizeof(double));
+
+    if (d) {
+        memcpy(d, val, sizeof(double));
+    }
+
+    return d;
+}
+
+/**
+ * count_words:
+ *      Count every word REPEATS times in a string->int table, checking each
+ * count as it goes, then check the totals.
+ */
+static bool count_words(unsigned int flags) {
+    ht_strint_t *ht = ht_strint_create(flags);
+    bool ok = ht != NULL;
+    int count = 0;
+
+    for (int r = 1; ok && r <= REPEATS; r++) {
+        for (size_t i = 0; ok && i < WORDS; i++) {
+            ok = ht_strint_add(ht, words[i], 1) == r;
+        }
+    }
+
+    for (size_t i = 0; ok && i < WORDS; i++) {
+        ok = ht_strint_get_val(ht, words[i], &count) && count == REPEATS;
+    }
+
+    printf("flags %u: %d words counted %d times %s\n", flags, WORDS, REPEATS,
+           ok ? "ok" : "failed");
+
+    ht_strint_destroy(ht);
+
+    return ok;
+}
+
+/**
+ * check_slots:
+ *      Store owned string values through the slots of a table copying and
+ * freeing it's values, checking the inserted flag.
+ */
+static bool check_slots(unsigned int flags) {
+    ht_callbacks_t callbacks = {
+        (void *(*)(const void *))strdup, (void (*)(const void *))free,
+        (void *(*)(const void *))strdup, (void (*)(const void *))free, NULL};
+    ht_t *ht = ht_create(fnv1a_hash_str, str_eq, &callbacks, flags);
+    bool inserted = false, ok = ht != NULL;
+    void **slot = NULL;
+
+    for (size_t i = 0; ok && i < WORDS; i++) {
+        slot = ht_get_or_insert(ht, words[i], &inserted);
+        ok = slot && inserted && !*slot;
+        if (ok) {
+            *slot = strdup(words[i]);
+        }
+    }
+
+    // Found again, the value is replaced in place
+    for (size_t i = 0; ok && i < WORDS; i += 2) {
+        slot = ht_get_or_insert(ht, words[i], &inserted);
+        ok = slot && !inserted && strcmp(*slot, words[i]) == 0;
+        if (ok) {
+            free(*slot);
+            *slot = strdup("even");
+        }
+    }
+
+    for (size_t i = 0; ok && i < WORDS; i++) {
+        ok = strcmp(ht_get(ht, words[i]), i % 2 ? words[i] : "even") == 0;
+    }
+
+    ok = ok && !ht_get_or_insert(ht, NULL, &inserted) && !inserted;
+
+    printf("flags %u: %d values stored through slots %s\n", flags, WORDS,
+           ok ? "ok" : "failed");
+
+    ht_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int flags[] = {HT_STR_NONE, HT_REHASH_INCREMENTAL,
+                                  HT_ENGINE_SWISS, HT_ENGINE_ROBINHOOD};
+    ht_callbacks_t callbacks = {
+        (void *(*)(const void *))strdup, (void (*)(const void *))free,
+        dup_double, (void (*)(const void *))free, NULL};
+    ht_strdouble_t *strdouble = NULL;
+    ht_strstr_t *packed = NULL;
+    bool ok = true;
+
+    for (size_t i = 0; i < WORDS; i++) {
+        snprintf(words[i], sizeof(words[i]), "word%zu", i);
+    }
+
+    for (size_t i = 0; ok && i < sizeof(flags) / sizeof(flags[0]); i++) {
+        ok = count_words(flags[i]) && check_slots(flags[i]);
+    }
+
+    strdouble = ht_strdouble_create(HT_STR_NONE);
+    ok = ok && ht_strdouble_add(strdouble, "total", 1.5) == 1.5 &&
+         ht_strdouble_add(strdouble, "total", 2.25) == 3.75;
+    ht_strdouble_destroy(strdouble);
+
+    // Doubles kept behind pointers, as where they are wider than one
+    strdouble = (ht_strdouble_t *)ht_create(fnv1a_hash_str, str_eq,
+                                            &callbacks, HT_STR_NONE);
+    ok = ok && ht_strdouble_add(strdouble, "total", 1.5) == 1.5 &&
+         ht_strdouble_add(strdouble, "total", 2.25) == 3.75 &&
+         ht_strdouble_add(strdouble, "other", -1) == -1 &&
+         *(double *)ht_strdouble_get(strdouble, "total") == 3.75;
+    ht_strdouble_destroy(strdouble);
+
+    // Packed pairs keep values inside their keys, there is no slot to give
+    packed = ht_strstr_create(HT_STR_PACKED);
+    ok = ok && !ht_get_or_insert((ht_t *)packed, "key", NULL);
+    ht_strstr_destroy(packed);
+
+    printf("typed adds and packed tables %s\n", ok ? "ok" : "failed");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,107 @@
+/* ht_hashed_test.c - Test program for prehashed keys shared by tables.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (20000)
+
+static char keys[KEYS][48];
+
+/**
+ * cascade_get:
+ *      Look a key up in the overrides, then in the defaults, hashing it once.
+ */
+static const char *cascade_get(ht_strstr_t *overrides, ht_strstr_t *defaults,
+                               const char *key) {
+    const ht_hashval_t hash = ht_strstr_hash_key(overrides, key);
+    const char *val = ht_strstr_get_hashed(overrides, key, hash);
+
+    return val ? val : ht_strstr_get_hashed(defaults, key, hash);
+}
+
+/**
+ * check_tables:
+ *      Fill a table of defaults and overrides of every third key through
+ * one shared hash, then check the cascade and remove the overrides again.
+ */
+static bool check_tables(unsigned int flags) {
+    ht_strstr_t *defaults = ht_strstr_create(flags | HT_SEED_RANDOM);
+    ht_strstr_t *overrides = ht_strstr_create(flags | HT_SEED_RANDOM);
+    char val[64];
+    bool ok = defaults && overrides &&
+              ht_strstr_share_seed(overrides, defaults) &&
+              ht_strstr_hash_key(overrides, keys[0]) ==
+                  ht_strstr_hash_key(defaults, keys[0]);
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        const ht_hashval_t hash = ht_strstr_hash_key(defaults, keys[i]);
+
+        ht_strstr_insert_hashed(defaults, keys[i], hash, "default");
+        if (i % 3 == 0) {
+            snprintf(val, sizeof(val), "override%zu", i);
+            ht_strstr_insert_hashed(overrides, keys[i], hash, val);
+        }
+    }
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        const char *got = cascade_get(overrides, defaults, keys[i]);
+
+        snprintf(val, sizeof(val), "override%zu", i);
+        ok = got && strcmp(got, i % 3 ? "default" : val) == 0 &&
+             ht_strstr_get(defaults, keys[i]) &&
+             !ht_strstr_get(overrides, keys[i]) == (i % 3 != 0);
+    }
+
+    for (size_t i = 0; ok && i < KEYS; i += 3) {
+        ht_strstr_remove_hashed(overrides, keys[i],
+                                ht_strstr_hash_key(defaults, keys[i]));
+        ok = !ht_strstr_get(overrides, keys[i]) &&
+             strcmp(cascade_get(overrides, defaults, keys[i]), "default") == 0;
+    }
+
+    // Only empty tables take another's seed
+    ok = ok && !ht_strstr_share_seed(defaults, overrides);
+
+    printf("flags %u: %d keys looked up through one hash %s\n", flags, KEYS,
+           ok ? "ok" : "failed");
+
+    ht_strstr_destroy(defaults);
+    ht_strstr_destroy(overrides);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_strstr_t *a = NULL, *b = NULL;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "tenant/settings/section%zu/key",
+                 i);
+    }
+
+    ok = check_tables(HT_STR_NONE) && check_tables(HT_REHASH_INCREMENTAL) &&
+         check_tables(HT_ENGINE_SWISS) && check_tables(HT_ENGINE_ROBINHOOD) &&
+         check_tables(HT_STR_CASECMP) && check_tables(HT_STR_PACKED);
+
+    // Tables hashing keys differently can't share a seed
+    a = ht_strstr_create(HT_SEED_RANDOM);
+    b = ht_strstr_create(HT_SEED_RANDOM | HT_STR_CASECMP);
+    ok = ok && !ht_strstr_share_seed(b, a) && !ht_hash_key(NULL, "key");
+    ht_strstr_destroy(a);
+    ht_strstr_destroy(b);
+
+    printf("tables hashing keys differently kept apart %s\n",
+           ok ? "ok" : "failed");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,193 @@
+/* ht_incremental_test.c - Test program for incremental rehashing.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define READERS (4)
+#define SHARED_KEYS (3000)
+#define ENUM_KEYS (3073) // Leaves a migration running
+
+typedef struct {
+    ht_strstr_t *ht;
+    bool ok;
+} reader_t;
+
+/**
+ * read_table:
+ *      Look every key of a table shared with other readers up, lookups only
+ * read so the migration running in it needs no lock.
+ */
+static void *read_table(void *arg) {
+    reader_t *r = arg;
+    char key[64], val[64];
+
+    r->ok = true;
+
+    for (size_t i = 0; r->ok && i < SHARED_KEYS; i++) {
+        snprintf(key, sizeof(key), "s%zu", i);
+        snprintf(val, sizeof(val), "%zu", i);
+        r->ok = ht_strstr_get(r->ht, key) &&
+                strcmp(ht_strstr_get(r->ht, key), val) == 0;
+    }
+
+    return NULL;
+}
+
+/**
+ * check_shared_reads:
+ *      Grow a table part way through a migration, then read it from several
+ * threads at once.
+ */
+static bool check_shared_reads(void) {
+    ht_strstr_t *ht = ht_strstr_create(HT_REHASH_INCREMENTAL);
+    pthread_t threads[READERS];
+    reader_t readers[READERS];
+    char key[64], val[64];
+    bool ok = ht != NULL;
+
+    ht_set_rehash_step((ht_t *)ht, 1);
+
+    for (size_t i = 0; ok && i < SHARED_KEYS; i++) {
+        snprintf(key, sizeof(key), "s%zu", i);
+        snprintf(val, sizeof(val), "%zu", i);
+        ht_strstr_insert(ht, key, val);
+    }
+
+    for (int i = 0; ok && i < READERS; i++) {
+        readers[i].ht = ht;
+        pthread_create(threads + i, NULL, read_table, readers + i);
+    }
+
+    for (int i = 0; ok && i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        ok = readers[i].ok;
+    }
+
+    ht_strstr_destroy(ht);
+
+    return ok;
+}
+
+/**
+ * check_enum_writes:
+ *      Replace the value of every key an enumeration visits while a migration
+ * is running, which must pause so each key is visited once, then remove keys
+ * the paused migration left in the old buckets.
+ */
+static bool check_enum_writes(void) {
+    ht_strint_t *ht = ht_strint_create(HT_REHASH_INCREMENTAL);
+    ht_enum_t *he = NULL;
+    const char *key = NULL;
+    const int *val = NULL;
+    char name[64];
+    size_t visits = 0;
+    int x = 0;
+    bool ok = ht != NULL;
+
+    for (int i = 0; ok && i < ENUM_KEYS; i++) {
+        snprintf(name, sizeof(name), "e%d", i);
+        ht_strint_insert(ht, name, &i);
+    }
+
+    he = ht_strint_enum_create(ht);
+    ok = ok && he;
+    while (ok && ht_strint_enum_next(he, &key, &val) && visits <= ENUM_KEYS) {
+        snprintf(name, sizeof(name), "%s", key);
+        x = -atoi(name + 1);
+        ok = ht_strint_insert(ht, name, &x);
+        visits++;
+    }
+
+    for (int i = 0; ok && i < ENUM_KEYS; i += 2) {
+        snprintf(name, sizeof(name), "e%d", i);
+        ht_strint_remove(ht, name);
+    }
+    ht_strint_enum_destroy(he);
+
+    for (int i = 0; ok && i < ENUM_KEYS; i++) {
+        snprintf(name, sizeof(name), "e%d", i);
+        ok = i % 2 ? ht_strint_get_val(ht, name, &x) && x == -i
+                   : !ht_strint_get(ht, name);
+    }
+
+    printf("%zu of %d keys replaced while enumerated %s\n", visits, ENUM_KEYS,
+           ok && visits == ENUM_KEYS ? "ok" : "failed");
+
+    ht_strint_destroy(ht);
+
+    return ok && visits == ENUM_KEYS;
+}
+
+int main(int argc, char **argv) {
+    ht_strstr_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const char *a = NULL;
+    const char *b = NULL;
+    const size_t len = 5000;
+    size_t count = 0;
+    char t1[64] = {'\0'};
+    char t2[64] = {'\0'};
+
+    ht = ht_strstr_create(HT_REHASH_INCREMENTAL);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Migrate a single old bucket per operation
+    ht_set_rehash_step((ht_t *)ht, 1);
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", i);
+        ht_strstr_insert(ht, t1, t2);
+
+        // Keys inserted before the table started growing must stay visible,
+        // every third key is removed below
+        if ((i / 2) % 3) {
+            snprintf(t1, sizeof(t1), "a%zu", i / 2);
+            snprintf(t2, sizeof(t2), "%zu", i / 2);
+            b = ht_strstr_get(ht, t1);
+            if (!b || strcmp(b, t2) != 0) {
+                printf("lost key=%s\n", t1);
+                ht_strstr_destroy(ht);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        if (i % 3 == 0) {
+            snprintf(t1, sizeof(t1), "a%zu", i);
+            ht_strstr_remove(ht, t1);
+        }
+    }
+
+    he = ht_strstr_enum_create(ht);
+    if (!he) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    while (ht_strstr_enum_next(he, &a, &b)) {
+        printf("key=%s, val=%s\n", a, b);
+        count++;
+    }
+
+    ht_strstr_enum_destroy(he);
+    ht_strstr_destroy(ht);
+
+    if (count != len - (len + 2) / 3 || !check_shared_reads() ||
+        !check_enum_writes()) {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
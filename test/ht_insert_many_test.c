@@ -0,0 +1,126 @@
+/* ht_insert_many_test.c - Test program for batch inserts.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (100000)
+
+static char keys[KEYS][16];
+static const void *key_ptrs[KEYS];
+static const void *val_ptrs[KEYS];
+
+/**
+ * same_order:
+ *      Check two tables enumerate the same keys in the same order.
+ */
+static bool same_order(ht_t *a, ht_t *b) {
+    ht_enum_t *ea = ht_enum_create(a), *eb = ht_enum_create(b);
+    const void *ka = NULL, *kb = NULL;
+    bool more = true, ok = ea && eb;
+
+    while (ok && more) {
+        more = ht_enum_next(ea, &ka, NULL);
+        ok = more == ht_enum_next(eb, &kb, NULL) && (!more || ka == kb);
+    }
+
+    ht_enum_destroy(ea);
+    ht_enum_destroy(eb);
+
+    return ok;
+}
+
+/**
+ * check_table:
+ *      Load a table in one batch, with and without HT_INSERT_UNIQUE, and
+ * compare it with one loaded key by key. A second batch replaces the values
+ * of half the keys.
+ */
+static bool check_table(unsigned int flags, unsigned int insert_flags) {
+    ht_t *batch = ht_create(fnv1a_hash_str, str_eq, NULL, flags);
+    ht_t *single = ht_create(fnv1a_hash_str, str_eq, NULL, flags);
+    bool ok = batch && single;
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_insert(single, keys[i], val_ptrs[i]);
+    }
+
+    ok = ok &&
+         ht_insert_many(batch, key_ptrs, val_ptrs, KEYS, insert_flags) == KEYS;
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_get(batch, keys[i]) == val_ptrs[i];
+    }
+
+    // Chained tables growing at once keep the order of key by key inserts
+    ok = ok && (flags != HT_STR_NONE || same_order(batch, single));
+
+    // Replacing values, with NULL keys skipped
+    ok = ok && ht_insert_many(batch, key_ptrs, NULL, KEYS / 2,
+                              HT_INSERT_NONE) == KEYS / 2;
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_get(batch, keys[i]) == (i < KEYS / 2 ? NULL : val_ptrs[i]);
+    }
+
+    printf("flags %u, insert flags %u: %d keys in one batch %s\n", flags,
+           insert_flags, KEYS, ok ? "ok" : "failed");
+
+    ht_destroy(batch);
+    ht_destroy(single);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int flags[] = {HT_STR_NONE, HT_REHASH_INCREMENTAL,
+                                  HT_ENGINE_SWISS, HT_ENGINE_ROBINHOOD};
+    const char *strkeys[] = {"one", "two", "one", NULL, "three"};
+    const char *strvals[] = {"1", "2", "uno", "none", "3"};
+    const int ints[] = {1, 2, 3, 4, 5};
+    ht_strstr_t *strstr = NULL;
+    ht_strint_t *strint = NULL;
+    int val = 0;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+        key_ptrs[i] = keys[i];
+        val_ptrs[i] = (void *)(intptr_t)(i + 1);
+    }
+
+    for (size_t i = 0; ok && i < sizeof(flags) / sizeof(flags[0]); i++) {
+        ok = check_table(flags[i], HT_INSERT_NONE) &&
+             check_table(flags[i], HT_INSERT_UNIQUE);
+    }
+
+    if (!ok) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Later pairs of a batch replace earlier ones with the same key
+    strstr = ht_strstr_create(HT_STR_NONE);
+    ok = ht_strstr_insert_many(strstr, strkeys, strvals, 5, HT_INSERT_NONE) ==
+             4 &&
+         strcmp(ht_strstr_get(strstr, "one"), "uno") == 0 &&
+         strcmp(ht_strstr_get(strstr, "three"), "3") == 0;
+    ht_strstr_destroy(strstr);
+
+    strint = ht_strint_create(HT_STR_NONE);
+    ok = ok &&
+         ht_strint_insert_many(strint, strkeys, ints, 5, HT_INSERT_NONE) == 4 &&
+         ht_strint_get_val(strint, "one", &val) && val == 3 &&
+         ht_strint_get_val(strint, "three", &val) && val == 5;
+    ht_strint_destroy(strint);
+
+    printf("typed tables loaded in one batch %s\n", ok ? "ok" : "failed");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
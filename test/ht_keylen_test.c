@@ -0,0 +1,147 @@
+/* ht_keylen_test.c - Test program for length delimited keys.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENTRIES (5000)
+
+/**
+ * check_slices:
+ *      Insert and look up keys sliced out of a buffer without terminators.
+ */
+static bool check_slices(unsigned int flags) {
+    const char *buf = "Host: example.orgAccept: */*Content-Length: 42";
+    ht_strstr_t *ht = NULL;
+    const char *v = NULL;
+    bool ok = true;
+
+    ht = ht_strstr_create(flags);
+    if (!ht) {
+        return false;
+    }
+
+    ht_strstr_insert_n(ht, buf, 4, "host");
+    ht_strstr_insert_n(ht, buf + 17, 6, "accept");
+    ht_strstr_insert_n(ht, buf + 28, 14, "length");
+
+    v = ht_strstr_get_n(ht, buf + 28, 14);
+    if (!v || strcmp(v, "length") != 0) {
+        ok = false;
+    }
+
+    // A prefix of a key is another key
+    if (ht_strstr_get_n(ht, buf + 28, 7)) {
+        ok = false;
+    }
+
+    // Terminated and length delimited keys are interchangeable
+    v = ht_strstr_get(ht, "Accept");
+    if (!v || strcmp(v, "accept") != 0) {
+        ok = false;
+    }
+
+    ht_strstr_remove_n(ht, buf, 4);
+    if (ht_strstr_get(ht, "Host") || !ht_strstr_get_n(ht, "Accept", 6)) {
+        ok = false;
+    }
+
+    printf("flags=%u slices %s\n", flags, ok ? "ok" : "failed");
+    ht_strstr_destroy(ht);
+
+    return ok;
+}
+
+/**
+ * check_binary:
+ *      Keys holding zero bytes in a length aware table.
+ */
+static bool check_binary(unsigned int flags) {
+    ht_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const void *key = NULL, *val = NULL;
+    unsigned char k[8] = {0};
+    size_t count = 0;
+    bool ok = true;
+
+    ht = ht_create_n(fnv1a_hash_str_n, str_eq_n, NULL, flags);
+    if (!ht) {
+        return false;
+    }
+
+    // Keys are a zero byte followed by the two bytes of i
+    for (size_t i = 0; i < ENTRIES; i++) {
+        k[1] = (unsigned char)(i & 0xff);
+        k[2] = (unsigned char)(i >> 8);
+        ht_insert_n(ht, k, 3, (void *)(i + 1));
+    }
+
+    for (size_t i = 0; i < ENTRIES; i += 2) {
+        k[1] = (unsigned char)(i & 0xff);
+        k[2] = (unsigned char)(i >> 8);
+        ht_remove_n(ht, k, 3);
+    }
+
+    for (size_t i = 0; i < ENTRIES; i++) {
+        k[1] = (unsigned char)(i & 0xff);
+        k[2] = (unsigned char)(i >> 8);
+        val = ht_get_n(ht, k, 3);
+        if ((i % 2 && val != (void *)(i + 1)) || (!(i % 2) && val)) {
+            ok = false;
+        }
+    }
+
+    he = ht_enum_create(ht);
+    while (he && ht_enum_next(he, &key, &val)) {
+        if (str_pack_len(key) != 3) {
+            ok = false;
+        }
+        count++;
+    }
+    ht_enum_destroy(he);
+
+    if (count != ENTRIES / 2) {
+        ok = false;
+    }
+
+    printf("flags=%u binary keys %s\n", flags, ok ? "ok" : "failed");
+    ht_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int flags[] = {
+        HT_STR_NONE,
+        HT_STR_PACKED,
+        HT_STR_ARENA,
+        HT_STR_PACKED | HT_STR_CASECMP,
+        HT_STR_PACKED | HT_REHASH_INCREMENTAL,
+        HT_STR_PACKED | HT_ENGINE_SWISS,
+        HT_STR_ARENA | HT_ENGINE_ROBINHOOD,
+    };
+    const unsigned int engines[] = {HT_STR_NONE, HT_REHASH_INCREMENTAL,
+                                    HT_ENGINE_SWISS, HT_ENGINE_ROBINHOOD};
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        if (!check_slices(flags[i])) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+        if (!check_binary(engines[i])) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return 0;
+}
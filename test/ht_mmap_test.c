@@ -0,0 +1,171 @@
+/* ht_mmap_test.c - Test program for snapshots looked up from a mapped file.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (50000)
+#define SNAPSHOT "ht_mmap_test.snap"
+
+static char keys[KEYS][32];
+
+/**
+ * own_hash:
+ *      A hash function of the caller's own, which snapshots can't be looked
+ * up with.
+ */
+static uint64_t own_hash(const void *key, uint64_t seed) {
+    return fnv1a_hash_str(key, seed) >> 1;
+}
+
+/**
+ * check_table:
+ *      Save a table, one value NULL and one key empty, map the snapshot and
+ * look every key and a missing one up in it.
+ */
+static bool check_table(unsigned int flags) {
+    ht_strstr_t *ht = ht_strstr_create(flags);
+    ht_mmap_t *hm = NULL;
+    bool ok = ht != NULL;
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_strstr_insert(ht, keys[i], i == 7 ? NULL : keys[(i + 1) % KEYS]);
+    }
+    ht_strstr_insert(ht, "", "empty");
+
+    ok = ok && ht_strstr_save(ht, SNAPSHOT);
+    hm = ht_strstr_open_mmap(SNAPSHOT);
+    ok = ok && hm && ht_mmap_count(hm) == KEYS + 1 &&
+         !ht_strint_open_mmap(SNAPSHOT);
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        const char *val = ht_strstr_mmap_get(hm, keys[i]);
+
+        ok = i == 7 ? !val : val && strcmp(val, keys[(i + 1) % KEYS]) == 0;
+    }
+
+    ok = ok && strcmp(ht_strstr_mmap_get(hm, ""), "empty") == 0 &&
+         !ht_strstr_mmap_get(hm, "missing") && !ht_strstr_mmap_get(hm, NULL);
+
+    if (ok && flags & HT_STR_CASECMP) {
+        ok = ht_strstr_mmap_get(hm, "KEY42") &&
+             strcmp(ht_strstr_mmap_get(hm, "KEY42"), "key43") == 0;
+    }
+
+    printf("flags %u: %d keys looked up in a mapped snapshot %s\n", flags,
+           KEYS, ok ? "ok" : "failed");
+
+    ht_mmap_close(hm);
+    ht_strstr_destroy(ht);
+
+    return ok;
+}
+
+/**
+ * check_corrupt:
+ *      Check truncated snapshots, and files that are not snapshots at all,
+ * are refused.
+ */
+static bool check_corrupt(void) {
+    ht_strstr_t *ht = ht_strstr_create(HT_STR_NONE);
+    FILE *f = NULL;
+    char *buf = NULL;
+    long size = 0;
+    bool ok = ht != NULL;
+
+    for (size_t i = 0; ok && i < 100; i++) {
+        ht_strstr_insert(ht, keys[i], keys[i]);
+    }
+    ok = ok && ht_strstr_save(ht, SNAPSHOT);
+    ht_strstr_destroy(ht);
+
+    f = fopen(SNAPSHOT, "rb");
+    ok = ok && f && fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 &&
+         (buf = malloc(size)) && fseek(f, 0, SEEK_SET) == 0 &&
+         fread(buf, 1, size, f) == (size_t)size;
+    if (f) {
+        fclose(f);
+    }
+
+    f = ok ? fopen(SNAPSHOT, "wb") : NULL;
+    ok = ok && f && fwrite(buf, 1, size - 1, f) == (size_t)size - 1;
+    if (f) {
+        fclose(f);
+    }
+    ok = ok && !ht_open_mmap(SNAPSHOT);
+
+    f = ok ? fopen(SNAPSHOT, "wb") : NULL;
+    ok = ok && f && fputs("key\tvalue\n", f) >= 0;
+    if (f) {
+        fclose(f);
+    }
+    ok = ok && !ht_open_mmap(SNAPSHOT);
+
+    free(buf);
+
+    printf("corrupt snapshots refused %s\n", ok ? "ok" : "failed");
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int flags[] = {
+        HT_STR_NONE,         HT_REHASH_INCREMENTAL, HT_ENGINE_SWISS,
+        HT_ENGINE_ROBINHOOD, HT_STR_CASECMP,        HT_STR_PACKED,
+        HT_STR_ARENA,        HT_SEED_RANDOM,        HT_HASH_WYHASH};
+    ht_strint_t *strint = NULL;
+    ht_mmap_t *hm = NULL;
+    ht_t *ht = NULL;
+    int val = 0;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+
+    for (size_t f = 0; ok && f < sizeof(flags) / sizeof(flags[0]); f++) {
+        ok = check_table(flags[f]);
+    }
+
+    // Inline values are saved as their bytes
+    strint = ht_strint_create(HT_SEED_RANDOM);
+    for (int i = 0; i < KEYS; i++) {
+        ht_strint_insert(strint, keys[i], &i);
+    }
+    ok = ok && ht_strint_save(strint, SNAPSHOT) &&
+         (hm = ht_strint_open_mmap(SNAPSHOT)) &&
+         !ht_strstr_open_mmap(SNAPSHOT);
+    for (int i = 0; ok && i < KEYS; i++) {
+        ok = ht_strint_mmap_get_val(hm, keys[i], &val) && val == i;
+    }
+    ok = ok && !ht_strint_mmap_get_val(hm, "missing", &val);
+    ht_mmap_close(hm);
+    hm = NULL;
+    ht_strint_destroy(strint);
+
+    printf("string->int snapshot %s\n", ok ? "ok" : "failed");
+
+    // Lookups can only hash keys with the library's string hashes
+    ht = ht_create(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE);
+    ok = ok && ht_save(ht, SNAPSHOT) && (hm = ht_open_mmap(SNAPSHOT)) &&
+         ht_mmap_count(hm) == 0 && !ht_mmap_get(hm, "key0");
+    ht_mmap_close(hm);
+    ht_destroy(ht);
+    ht = ht_create(own_hash, str_eq, NULL, HT_STR_NONE);
+    ok = ok && !ht_save(ht, SNAPSHOT);
+    ht_destroy(ht);
+
+    ok = ok && check_corrupt() && !ht_open_mmap("ht_mmap_test.missing");
+
+    remove(SNAPSHOT);
+
+    return ok ? 0 : EXIT_FAILURE;
+}
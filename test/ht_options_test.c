@@ -0,0 +1,199 @@
+/* ht_options_test.c - Test program for per table sizing options.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (20000)
+
+static char keys[KEYS][16];
+
+/**
+ * check_options:
+ *      Check the effective options of a table.
+ */
+static bool check_options(const ht_t *ht, double load, double growth,
+                          size_t initial, size_t max) {
+    ht_options_t opts;
+
+    ht_get_options(ht, &opts);
+    if (opts.max_load_factor != load || opts.growth_factor != growth ||
+        opts.initial_capacity != initial || opts.max_capacity != max) {
+        printf("options %g %g %zu %zu, expected %g %g %zu %zu\n",
+               opts.max_load_factor, opts.growth_factor, opts.initial_capacity,
+               opts.max_capacity, load, growth, initial, max);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * check_load:
+ *      Fill a table, checking it never holds more than load entries per
+ * bucket, then empty it and check it shrank back to it's initial capacity.
+ */
+static bool check_load(ht_t *ht, double load) {
+    ht_options_t opts;
+    bool ok = ht != NULL;
+
+    ht_get_options(ht, &opts);
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_insert(ht, keys[i], (void *)(intptr_t)(i + 1));
+        ok = i + 1 <= ht_capacity(ht) * load;
+    }
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_get(ht, keys[i]) == (void *)(intptr_t)(i + 1);
+    }
+
+    printf("load %g growth %g: %d keys in %zu buckets %s\n", load,
+           opts.growth_factor, KEYS, ht_capacity(ht), ok ? "ok" : "failed");
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_remove(ht, keys[i]);
+    }
+
+    return ok && ht_shrink_to_fit(ht) &&
+           ht_capacity(ht) == opts.initial_capacity;
+}
+
+/**
+ * check_full:
+ *      Fill a table to it's max load at it's max capacity, check new keys are
+ * refused by every insert while keys already in it are still replaced, and
+ * that removing a key makes room for another.
+ */
+static bool check_full(unsigned int flags) {
+    const ht_options_t capped = {0.5, 2, 16, 64};
+    const size_t room = 32; // max_load_factor * max_capacity
+    const void *batch[10];
+    ht_t *ht = ht_create_with_options(fnv1a_hash_str, str_eq, NULL, flags,
+                                      &capped);
+    bool ok = ht != NULL;
+
+    for (size_t i = 0; ok && i < room; i++) {
+        ok = ht_insert(ht, keys[i], keys[i]);
+    }
+
+    for (size_t i = 0; i < 10; i++) {
+        batch[i] = keys[room + i];
+    }
+    ht_insert_many(ht, batch, batch, 10, HT_INSERT_UNIQUE);
+
+    ok = ok && ht_capacity(ht) == 64 && !ht_insert(ht, keys[room], NULL) &&
+         !ht_insert_n(ht, keys[room], strlen(keys[room]), NULL) &&
+         !ht_get_or_insert(ht, keys[room], NULL) &&
+         ht_insert(ht, keys[0], keys[1]) && ht_get(ht, keys[0]) == keys[1];
+
+    for (size_t i = 0; ok && i < room + 10; i++) {
+        ok = !ht_get(ht, keys[i]) == (i >= room);
+    }
+
+    ht_remove(ht, keys[0]);
+    ok = ok && ht_insert(ht, keys[room], keys[room]) &&
+         !ht_insert(ht, keys[0], NULL);
+
+    printf("flags %u: %zu keys fill a table at it's max capacity %s\n", flags,
+           room, ok ? "ok" : "failed");
+
+    ht_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const ht_options_t sparse = {0.5, 1.5, 100, 0};
+    const ht_options_t dense = {4, 0, 0, 0};
+    const ht_options_t open = {0.5, 3, 100, 100000};
+    const ht_options_t bad[] = {{-1, 0, 0, 0},  {5, 0, 0, 0},
+                                {NAN, 0, 0, 0}, {0, 1, 0, 0},
+                                {0, 5, 0, 0},   {0, 0, 64, 32}};
+    ht_strint_t *strint = NULL;
+    ht_t *ht = NULL;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+
+    // Defaults of each engine
+    ht = ht_create(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE);
+    ok = check_options(ht, 0.75, 2, 16, (size_t)1 << 31);
+    ht_destroy(ht);
+    ht = ht_create(fnv1a_hash_str, str_eq, NULL, HT_ENGINE_SWISS);
+    ok = ok && check_options(ht, 0.875, 2, 16, (size_t)1 << 31);
+    ht_destroy(ht);
+
+    // Sparse tables with capacities that aren't powers of two
+    ht = ht_create_with_options(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE,
+                                &sparse);
+    ok = ok && check_options(ht, 0.5, 1.5, 100, (size_t)1 << 31) &&
+         check_load(ht, 0.5);
+    ht_destroy(ht);
+
+    ht = ht_create_with_options(fnv1a_hash_str, str_eq, NULL,
+                                HT_REHASH_INCREMENTAL, &sparse);
+    ok = ok && check_load(ht, 0.5);
+    ht_destroy(ht);
+
+    // Dense chained tables
+    ht = ht_create_with_options(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE,
+                                &dense);
+    ok = ok && check_load(ht, 4) && ht_capacity(ht) == 16;
+    ht_destroy(ht);
+
+    // Open addressed tables round to powers of two
+    ht = ht_create_with_options(fnv1a_hash_str, str_eq, NULL, HT_ENGINE_SWISS,
+                                &open);
+    ok = ok && check_options(ht, 0.5, 4, 128, 65536) && check_load(ht, 0.5);
+    ht_destroy(ht);
+
+    ht = ht_create_with_options(fnv1a_hash_str, str_eq, NULL,
+                                HT_ENGINE_ROBINHOOD, &open);
+    ok = ok && check_options(ht, 0.5, 4, 128, 65536) && check_load(ht, 0.5);
+    ht_destroy(ht);
+
+    // Every engine holds the same number of keys at it's max capacity
+    ok = ok && check_full(HT_STR_NONE) && check_full(HT_REHASH_INCREMENTAL) &&
+         check_full(HT_ENGINE_SWISS) && check_full(HT_ENGINE_ROBINHOOD);
+
+    if (!ok) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Invalid options leave a table as it was, and only empty tables change
+    ht = ht_create(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE);
+    for (size_t i = 0; ok && i < sizeof(bad) / sizeof(bad[0]); i++) {
+        ok = !ht_set_options(ht, bad + i);
+    }
+    ht_insert(ht, keys[0], keys[0]);
+    ok = ok && !ht_set_options(ht, &dense) &&
+         check_options(ht, 0.75, 2, 16, (size_t)1 << 31);
+    ht_destroy(ht);
+
+    strint = ht_strint_create(HT_STR_NONE);
+    ok = ok && ht_strint_set_options(strint, &sparse);
+    for (int i = 0; ok && i < KEYS; i++) {
+        ht_strint_insert(strint, keys[i], &i);
+    }
+    for (int i = 0, val = 0; ok && i < KEYS; i++) {
+        ok = ht_strint_get_val(strint, keys[i], &val) && val == i;
+    }
+
+    printf("string->int table with options %s\n", ok ? "ok" : "failed");
+
+    ht_strint_destroy(strint);
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,81 @@
+/* ht_pool_test.c - Test program for the collision chain node pool.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(CPU_32_BIT)
+static uint32_t bad_hash(const void *key, uint32_t seed) {
+    return fnv1a_hash_str(key, seed) & 0x3;
+}
+#else
+static uint64_t bad_hash(const void *key, uint64_t seed) {
+    return fnv1a_hash_str(key, seed) & 0x3;
+}
+#endif
+
+int main(int argc, char **argv) {
+    ht_t *ht = NULL;
+    const ht_callbacks_t callbacks = {
+        (void *(*)(const void *))strdup, (void (*)(const void *))free,
+        (void *(*)(const void *))strdup, (void (*)(const void *))free, NULL};
+    const size_t len = 1000;
+    size_t live = 0, spare = 0, total = 0;
+    char t1[64] = {'\0'};
+
+    // Keys only hash to 4 buckets, nearly every entry needs a chain node
+    ht = ht_create(bad_hash, str_eq, &callbacks, HT_STR_NONE);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        ht_insert(ht, t1, t1);
+    }
+
+    ht_pool_stats(ht, &live, &spare);
+    printf("after insert: live=%zu, free=%zu\n", live, spare);
+    if (live != len - 4) {
+        ht_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        ht_remove(ht, t1);
+    }
+
+    ht_pool_stats(ht, &live, &spare);
+    printf("after remove: live=%zu, free=%zu\n", live, spare);
+    if (live != 0 || spare < len - 4) {
+        ht_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+    total = spare;
+
+    // Removed nodes are recycled instead of growing the pool
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "b%zu", i);
+        ht_insert(ht, t1, t1);
+    }
+
+    ht_pool_stats(ht, &live, &spare);
+    printf("after reinsert: live=%zu, free=%zu\n", live, spare);
+    if (live != len - 4 || live + spare != total) {
+        ht_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    ht_destroy(ht);
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+/* ht_rcu_test.c - Test program for read mostly tables with lock free readers.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define READERS (6)
+#define KEYS (2000)    // Keys present throughout
+#define CHURN (2000)   // Keys written and removed as readers read
+#define ROUNDS (10)    // Passes of the writer over every key
+#define LOOKUPS (2000) // Lookups of each read section
+
+typedef struct {
+    ht_rcu_t *rcu;
+    int id;
+    bool ok;
+} reader_t;
+
+static int done;   // Set once the writer is finished
+static long live;  // Strings copied into the table and not yet freed
+
+/**
+ * copy_str:
+ *      Copy a string, counting it.
+ */
+static void *copy_str(const void *s) {
+    __atomic_fetch_add(&live, 1, __ATOMIC_RELAXED);
+    return strdup(s);
+}
+
+/**
+ * free_str:
+ *      Free a string, scribbling over it first so a reader still using it
+ * would notice.
+ */
+static void free_str(const void *s) {
+    __atomic_fetch_sub(&live, 1, __ATOMIC_RELAXED);
+    memset((void *)s, 'x', strlen(s));
+    free((void *)s);
+}
+
+/**
+ * check_val:
+ *      Check a value, "<key>=<round>", belongs to it's key.
+ */
+static bool check_val(const char *key, const char *val) {
+    const size_t len = strlen(key);
+
+    return strncmp(val, key, len) == 0 && val[len] == '=' &&
+           atoi(val + len + 1) <= ROUNDS;
+}
+
+/**
+ * read_table:
+ *      Look keys up in read sections until the writer is done. Keys always
+ * present must be found, churning keys may or may not be, and every value
+ * found must be whole until the read section is left.
+ */
+static void *read_table(void *arg) {
+    reader_t *r = arg;
+    ht_rcu_reader_t *reader = ht_rcu_reader_create(r->rcu);
+    char key[32];
+
+    r->ok = reader != NULL;
+
+    while (r->ok && !__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        ht_rcu_read_lock(reader);
+
+        for (int i = 0; r->ok && i < LOOKUPS; i++) {
+            const int n = (i * 7 + r->id) % (KEYS + CHURN);
+            const char *val = NULL;
+
+            snprintf(key, sizeof(key), n < KEYS ? "key%d" : "churn%d", n);
+            val = ht_rcu_get(reader, key);
+
+            r->ok = val ? check_val(key, val) : n >= KEYS;
+        }
+
+        ht_rcu_read_unlock(reader);
+    }
+
+    ht_rcu_reader_destroy(reader);
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    ht_callbacks_t callbacks = {copy_str, free_str, copy_str, free_str, NULL};
+    pthread_t threads[READERS];
+    reader_t readers[READERS];
+    ht_rcu_reader_t *reader = NULL;
+    char key[32], val[32];
+    bool ok = true;
+
+    ht_rcu_t *rcu = ht_rcu_create(fnv1a_hash_str, str_eq, &callbacks,
+                                  HT_SEED_RANDOM);
+    if (!rcu) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; ok && i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "key%d=0", i);
+        ok = ht_rcu_insert(rcu, key, val);
+    }
+    ok = ok && !ht_rcu_insert(NULL, key, val);
+
+    for (int i = 0; i < READERS; i++) {
+        readers[i].rcu = rcu;
+        readers[i].id = i;
+        pthread_create(threads + i, NULL, read_table, readers + i);
+    }
+
+    // Replace every value, and grow and shrink the table under the readers
+    for (int round = 1; round <= ROUNDS; round++) {
+        for (int i = 0; i < KEYS; i++) {
+            snprintf(key, sizeof(key), "key%d", i);
+            snprintf(val, sizeof(val), "key%d=%d", i, round);
+            ht_rcu_insert(rcu, key, val);
+        }
+
+        for (int i = 0; i < CHURN; i++) {
+            snprintf(key, sizeof(key), "churn%d", KEYS + i);
+            snprintf(val, sizeof(val), "churn%d=%d", KEYS + i, round);
+            ht_rcu_insert(rcu, key, val);
+        }
+
+        for (int i = 0; i < CHURN; i++) {
+            snprintf(key, sizeof(key), "churn%d", KEYS + i);
+            ht_rcu_remove(rcu, key);
+        }
+    }
+
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && readers[i].ok;
+    }
+
+    // Every replaced and removed entry is freed once readers are gone
+    ht_rcu_synchronize(rcu);
+    ok = ok && __atomic_load_n(&live, __ATOMIC_RELAXED) == KEYS * 2;
+
+    reader = ht_rcu_reader_create(rcu);
+    ht_rcu_read_lock(reader);
+    ht_rcu_read_lock(reader);
+    ht_rcu_read_unlock(reader);
+    for (int i = 0; ok && i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(val, sizeof(val), "key%d=%d", i, ROUNDS);
+        ok = ht_rcu_get(reader, key) &&
+             strcmp(ht_rcu_get(reader, key), val) == 0;
+    }
+    ht_rcu_read_unlock(reader);
+    ok = ok && !ht_rcu_get(reader, "key0");
+
+    printf("%d readers over %d rounds of writes %s\n", READERS, ROUNDS,
+           ok ? "ok" : "failed");
+
+    ht_rcu_destroy(rcu);
+    ok = ok && live == 0;
+
+    return ok ? 0 : EXIT_FAILURE;
+}
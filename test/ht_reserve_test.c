@@ -0,0 +1,141 @@
+/* ht_reserve_test.c - Test program for presized tables.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (20000)
+
+static char keys[KEYS][16];
+
+/**
+ * enum_order:
+ *      Store the indexes of the first n keys in the order a table enumerates
+ * them, returning how many were found.
+ */
+static size_t enum_order(ht_t *ht, size_t n, size_t *order) {
+    ht_enum_t *e = ht_enum_create(ht);
+    const void *key = NULL, *val = NULL;
+    size_t found = 0;
+
+    while (e && ht_enum_next(e, &key, &val)) {
+        const size_t i = (size_t)(intptr_t)val - 1;
+
+        if (i < n) {
+            order[found++] = i;
+        }
+    }
+
+    ht_enum_destroy(e);
+
+    return found;
+}
+
+/**
+ * check_table:
+ *      Fill a table created for KEYS entries and check it holds them. Tables
+ * that never move entries unless they grow must enumerate the first half of
+ * the keys in the same order once the second half is in.
+ */
+static bool check_table(unsigned int flags, bool stable) {
+    ht_t *ht = ht_create_with_capacity(fnv1a_hash_str, str_eq, NULL, flags,
+                                       KEYS);
+    size_t *before = calloc(KEYS, sizeof(*before));
+    size_t *after = calloc(KEYS, sizeof(*after));
+    size_t capacity = 0;
+    bool ok = ht && before && after;
+
+    if (ok && (flags & HT_REHASH_INCREMENTAL)) {
+        ht_set_rehash_step(ht, 1);
+    }
+
+    for (size_t i = 0; ok && i < KEYS / 2; i++) {
+        ht_insert(ht, keys[i], (void *)(intptr_t)(i + 1));
+    }
+
+    ok = ok && enum_order(ht, KEYS / 2, before) == KEYS / 2;
+
+    for (size_t i = KEYS / 2; ok && i < KEYS; i++) {
+        ht_insert(ht, keys[i], (void *)(intptr_t)(i + 1));
+    }
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_get(ht, keys[i]) == (void *)(intptr_t)(i + 1);
+    }
+
+    ok = ok && enum_order(ht, KEYS / 2, after) == KEYS / 2;
+    if (ok && stable) {
+        ok = memcmp(before, after, KEYS / 2 * sizeof(*before)) == 0;
+    }
+
+    // Reserving less than a table holds leaves it as it is
+    capacity = ht_capacity(ht);
+    ok = ok && ht_reserve(ht, 1) && ht_get(ht, keys[0]) &&
+         ht_capacity(ht) == capacity;
+
+    printf("flags %u: %d keys in a presized table %s\n", flags, KEYS,
+           ok ? "ok" : "failed");
+
+    free(before);
+    free(after);
+    ht_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_strint_t *strint = NULL;
+    ht_t *ht = NULL;
+    int val = 0;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+
+    if (!check_table(HT_STR_NONE, true) ||
+        !check_table(HT_REHASH_INCREMENTAL, true) ||
+        !check_table(HT_ENGINE_SWISS, true) ||
+        !check_table(HT_ENGINE_ROBINHOOD, false)) {
+        exit(EXIT_FAILURE);
+    }
+
+    // No engine holds more entries than a size_t can count
+    ht = ht_create(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE);
+    if (!ht || ht_reserve(ht, (size_t)-1) || ht_reserve(NULL, 1) ||
+        ht_create_with_capacity(fnv1a_hash_str, str_eq, NULL,
+                                HT_ENGINE_SWISS, (size_t)-1)) {
+        ht_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+    ht_destroy(ht);
+
+    strint = ht_strint_create(HT_STR_NONE);
+    if (!strint || !ht_strint_reserve(strint, KEYS)) {
+        ht_strint_destroy(strint);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < KEYS; i++) {
+        ht_strint_insert(strint, keys[i], &i);
+    }
+
+    for (int i = 0; i < KEYS && ok; i++) {
+        ok = ht_strint_get_val(strint, keys[i], &val) && val == i;
+    }
+
+    printf("%d keys in a presized string->int table %s\n", KEYS,
+           ok ? "ok" : "failed");
+
+    ht_strint_destroy(strint);
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+/* ht_resize_threads_test.c - Test program for migrations split between
+ * threads.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (300000)
+#define RESERVED (2000000) // Entries a filled table is reserved for
+
+static char keys[KEYS][16];
+
+/**
+ * clustered_hash:
+ *      Hash keys onto every 64th bucket only, so chains grow long enough to
+ * be indexed.
+ */
+static uint64_t clustered_hash(const void *key, uint64_t seed) {
+    return fnv1a_hash_str(key, seed) << 6;
+}
+
+/**
+ * same_tables:
+ *      Check two tables enumerate the same entries in the same order.
+ */
+static bool same_tables(ht_t *a, ht_t *b) {
+    ht_enum_t *ea = ht_enum_create(a), *eb = ht_enum_create(b);
+    const void *ka = NULL, *kb = NULL, *va = NULL, *vb = NULL;
+    size_t live_a = 0, live_b = 0, free_nodes = 0, count = 0;
+    bool more_a = true, more_b = true, ok = ea && eb;
+
+    while (ok && more_a) {
+        more_a = ht_enum_next(ea, &ka, &va);
+        more_b = ht_enum_next(eb, &kb, &vb);
+        ok = more_a == more_b && (!more_a || (ka == kb && va == vb));
+        count += more_a;
+    }
+
+    ht_enum_destroy(ea);
+    ht_enum_destroy(eb);
+
+    ht_pool_stats(a, &live_a, &free_nodes);
+    ht_pool_stats(b, &live_b, &free_nodes);
+
+    return ok && count == KEYS && live_a == live_b &&
+           ht_capacity(a) == ht_capacity(b);
+}
+
+/**
+ * check_tables:
+ *      Fill a table migrating on one thread and one migrating on several
+ * alike, growing them, then reserve room for more and compare them.
+ */
+static bool check_tables(ht_hash hfunc, unsigned int flags) {
+    ht_t *serial = ht_create(hfunc, str_eq, NULL, flags);
+    ht_t *split = ht_create(hfunc, str_eq, NULL, flags);
+    bool ok = serial && split;
+
+    ht_set_resize_threads(split, 4);
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_insert(serial, keys[i], (void *)(intptr_t)(i + 1));
+        ht_insert(split, keys[i], (void *)(intptr_t)(i + 1));
+    }
+
+    ok = ok && same_tables(serial, split);
+
+    ok = ok && ht_reserve(serial, RESERVED) && ht_reserve(split, RESERVED) &&
+         same_tables(serial, split);
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_get(split, keys[i]) == (void *)(intptr_t)(i + 1);
+    }
+
+    printf("flags %u: %d keys migrated by 4 threads %s\n", flags, KEYS,
+           ok ? "ok" : "failed");
+
+    ht_destroy(serial);
+    ht_destroy(split);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_t *ht = NULL;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+
+    ok = check_tables(fnv1a_hash_str, HT_STR_NONE) &&
+         check_tables(fnv1a_hash_str, HT_REHASH_INCREMENTAL) &&
+         check_tables(clustered_hash, HT_STR_NONE);
+
+    // Open addressed tables ignore resize threads
+    ht = ht_create(fnv1a_hash_str, str_eq, NULL, HT_ENGINE_SWISS);
+    ht_set_resize_threads(ht, 4);
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_insert(ht, keys[i], keys[i]);
+    }
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_get(ht, keys[i]) == keys[i];
+    }
+    ht_destroy(ht);
+
+    printf("open addressed table with resize threads %s\n",
+           ok ? "ok" : "failed");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
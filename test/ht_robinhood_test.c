@@ -0,0 +1,94 @@
+/* ht_robinhood_test.c - Test program for the Robin Hood storage engine.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+    ht_strstr_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const char *a = NULL;
+    const char *b = NULL;
+    const size_t len = 500;
+    const size_t rounds = 20;
+    size_t count = 0;
+    char t1[64] = {'\0'};
+    char t2[64] = {'\0'};
+
+    ht = ht_strstr_create(HT_ENGINE_ROBINHOOD);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+#if defined(CPU_64_BIT)
+
+    // Create a collision - 64 bit hash (0x8FCF3BE2DE898214)
+    ht_strstr_insert(ht, "gMPflVXtwGDXbIhP73TX", "banana");
+    ht_strstr_insert(ht, "LtHf1prlU1bCeYZEdqWf", "pineapple");
+
+    ht_strstr_remove(ht, "gMPflVXtwGDXbIhP73TX");
+
+    if (ht_strstr_get(ht, "gMPflVXtwGDXbIhP73TX") ||
+        strcmp(ht_strstr_get(ht, "LtHf1prlU1bCeYZEdqWf"), "pineapple") != 0) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    ht_strstr_remove(ht, "LtHf1prlU1bCeYZEdqWf");
+
+#endif
+
+    // Churn, each round inserts a window of keys and removes the last one
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < len; i++) {
+            snprintf(t1, sizeof(t1), "k%zu", r * len + i);
+            snprintf(t2, sizeof(t2), "%zu", r);
+            ht_strstr_insert(ht, t1, t2);
+        }
+
+        for (size_t i = 0; r && i < len; i++) {
+            snprintf(t1, sizeof(t1), "k%zu", (r - 1) * len + i);
+            ht_strstr_remove(ht, t1);
+        }
+    }
+
+    for (size_t i = 0; i < rounds * len; i++) {
+        snprintf(t1, sizeof(t1), "k%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", rounds - 1);
+        b = ht_strstr_get(ht, t1);
+        if ((i < (rounds - 1) * len && b) ||
+            (i >= (rounds - 1) * len && (!b || strcmp(b, t2) != 0))) {
+            printf("unexpected value for key=%s\n", t1);
+            ht_strstr_destroy(ht);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    he = ht_strstr_enum_create(ht);
+    if (!he) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    while (ht_strstr_enum_next(he, &a, &b)) {
+        printf("key=%s, val=%s\n", a, b);
+        count++;
+    }
+
+    ht_strstr_enum_destroy(he);
+    ht_strstr_destroy(ht);
+
+    if (count != len) {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* ht_shrink_test.c - Test program for shrinking tables.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (50000)
+#define KEPT (KEYS / 100) // Keys left after a purge
+
+static char keys[KEYS][16];
+
+/**
+ * check_kept:
+ *      Check a table holds exactly the first kept keys.
+ */
+static bool check_kept(ht_t *ht, size_t kept) {
+    for (size_t i = 0; i < KEYS; i++) {
+        void *val = ht_get(ht, keys[i]);
+
+        if (i < kept ? val != (void *)(intptr_t)(i + 1) : val != NULL) {
+            printf("key %s wrong after shrinking\n", keys[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * check_table:
+ *      Fill a table, purge all but KEPT keys so it shrinks as they go, then
+ * shrink it to fit and refill it before emptying it again.
+ */
+static bool check_table(unsigned int flags) {
+    ht_t *ht = ht_create(fnv1a_hash_str, str_eq, NULL, flags);
+    const void *key = NULL;
+    size_t live = 0, free_nodes = 0, seen = 0;
+    ht_enum_t *e = NULL;
+    bool ok = ht != NULL;
+
+    if (ok && (flags & HT_REHASH_INCREMENTAL)) {
+        ht_set_rehash_step(ht, 1);
+    }
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_insert(ht, keys[i], (void *)(intptr_t)(i + 1));
+    }
+
+    for (size_t i = KEYS; ok && i > KEPT; i--) {
+        ht_remove(ht, keys[i - 1]);
+    }
+
+    ok = ok && check_kept(ht, KEPT) && ht_shrink_to_fit(ht) &&
+         check_kept(ht, KEPT);
+
+    // Chain nodes of the peak are released with the old pool
+    ht_pool_stats(ht, &live, &free_nodes);
+    ok = ok && free_nodes <= KEPT;
+
+    for (size_t i = KEPT; ok && i < KEYS; i++) {
+        ht_insert(ht, keys[i], (void *)(intptr_t)(i + 1));
+    }
+
+    ok = ok && check_kept(ht, KEYS);
+
+    // Tables don't move entries under an enumeration
+    e = ok ? ht_enum_create(ht) : NULL;
+    ok = ok && !ht_shrink_to_fit(ht);
+    while (e && ht_enum_next(e, &key, NULL)) {
+        seen++;
+    }
+    ht_enum_destroy(e);
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ht_remove(ht, keys[i]);
+    }
+
+    ok = ok && seen == KEYS && check_kept(ht, 0) && ht_shrink_to_fit(ht);
+
+    printf("flags %u: purged, shrunk and refilled %d keys %s\n", flags, KEYS,
+           ok ? "ok" : "failed");
+
+    ht_destroy(ht);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_strstr_t *strstr = NULL;
+    ht_t *ht = NULL;
+    bool ok = true;
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+
+    if (!check_table(HT_STR_NONE) || !check_table(HT_REHASH_INCREMENTAL) ||
+        !check_table(HT_ENGINE_SWISS) || !check_table(HT_ENGINE_ROBINHOOD)) {
+        exit(EXIT_FAILURE);
+    }
+
+    // A reserved table keeps it's capacity through removes
+    ht = ht_create_with_capacity(fnv1a_hash_str, str_eq, NULL, HT_STR_NONE,
+                                 KEYS);
+    for (size_t i = 0; ht && i < KEYS; i++) {
+        ht_insert(ht, keys[i], (void *)(intptr_t)(i + 1));
+        ht_remove(ht, keys[i]);
+    }
+    ok = ht && check_kept(ht, 0);
+    ht_destroy(ht);
+
+    strstr = ht_strstr_create(HT_STR_NONE);
+    for (size_t i = 0; strstr && i < KEYS; i++) {
+        ht_strstr_insert(strstr, keys[i], keys[i]);
+    }
+    for (size_t i = 0; strstr && i < KEYS; i += 2) {
+        ht_strstr_remove(strstr, keys[i]);
+    }
+    ok = ok && strstr && ht_strstr_shrink_to_fit(strstr);
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        const char *val = ht_strstr_get(strstr, keys[i]);
+
+        ok = i % 2 ? val && strcmp(val, keys[i]) == 0 : val == NULL;
+    }
+
+    printf("string->string table shrunk to fit %s\n", ok ? "ok" : "failed");
+
+    ht_strstr_destroy(strstr);
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,121 @@
+/* ht_siphash_test.c - Test program for the keyed string hashes.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEEDS (64)
+#define MAX_LEN (100)
+
+// Pairs of keys with equal FNV1A hashes under the default seed
+#if defined(CPU_32_BIT)
+static const char *pairs[][2] = {{"costarring", "liquid"},
+                                 {"declinate", "macallums"},
+                                 {"altarage", "zinke"},
+                                 {"altarages", "zinkes"}};
+#else
+static const char *pairs[][2] = {
+    {"8yn0iYCKYHlIj4-BwPqk", "GReLUrM4wMqfg9yzV3KQ"},
+    {"gMPflVXtwGDXbIhP73TX", "LtHf1prlU1bCeYZEdqWf"},
+    {"pFuM83THhM-Qw8FI5FKo", ".jPx7rOtTDteKAwvfOEo"},
+    {"7mohtcOFVz", "c1E51sSEyx"},
+    {"6a5x-VbtXk", "f_2k7GG-4v"}};
+#endif
+
+#define PAIRS (sizeof(pairs) / sizeof(pairs[0]))
+
+/**
+ * check_pairs:
+ *      Keys colliding under FNV1A don't under the keyed hash, whatever the
+ * seed.
+ */
+static bool check_pairs(void) {
+    for (size_t i = 0; i < PAIRS; i++) {
+        if (fnv1a_hash_str(pairs[i][0], FNV1A_OFFSET) !=
+            fnv1a_hash_str(pairs[i][1], FNV1A_OFFSET)) {
+            printf("%s and %s don't collide under FNV1A\n", pairs[i][0],
+                   pairs[i][1]);
+            return false;
+        }
+
+        for (unsigned int seed = 1; seed <= SEEDS; seed++) {
+            if (sip_hash_str(pairs[i][0], seed) ==
+                sip_hash_str(pairs[i][1], seed)) {
+                printf("%s and %s collide with seed %u\n", pairs[i][0],
+                       pairs[i][1], seed);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * check_variants:
+ *      Terminated and length delimited keys hash alike, case insensitive
+ * hashes equal the hash of the lower case key, and the seed changes the hash,
+ * at every length.
+ */
+static bool check_variants(void) {
+    char key[MAX_LEN + 1], lower[MAX_LEN + 1];
+
+    for (size_t len = 0; len <= MAX_LEN; len++) {
+        for (size_t i = 0; i < len; i++) {
+            key[i] = "Content-Type: Text/HTML; charset=UTF-8"[(i * 7) % 38];
+            lower[i] = (char)tolower((unsigned char)key[i]);
+        }
+        key[len] = lower[len] = '\0';
+
+        if (sip_hash_str(key, 42) != sip_hash_str_n(key, len, 42) ||
+            sip_hash_str_casecmp(key, 42) != sip_hash_str(lower, 42) ||
+            sip_hash_str_casecmp_n(key, len, 42) != sip_hash_str(lower, 42) ||
+            sip_hash_str(key, 42) == sip_hash_str(key, 43)) {
+            printf("hash variants differ at length %zu\n", len);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    ht_strstr_t *ht = NULL;
+    const char *val = NULL;
+
+    if (!check_pairs() || !check_variants()) {
+        exit(EXIT_FAILURE);
+    }
+
+    ht = ht_strstr_create(HT_SEED_RANDOM | HT_STR_CASECMP);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < PAIRS; i++) {
+        ht_strstr_insert(ht, pairs[i][0], pairs[i][1]);
+        ht_strstr_insert(ht, pairs[i][1], pairs[i][0]);
+    }
+
+    for (size_t i = 0; i < PAIRS; i++) {
+        val = ht_strstr_get(ht, pairs[i][0]);
+        if (!val || strcmp(val, pairs[i][1]) != 0) {
+            ht_strstr_destroy(ht);
+            exit(EXIT_FAILURE);
+        }
+        printf("key=%s, val=%s\n", pairs[i][0], val);
+    }
+
+    ht_strstr_destroy(ht);
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/* ht_strinline_test.c - Test program for short keys stored in table slots.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENTRIES (5000)
+#define MAX_KEY (40) // Keys run from 1 to MAX_KEY bytes, inline or not
+
+/**
+ * make_str:
+ *      Write a string unique to i and prefix, padded to len bytes.
+ */
+static void make_str(char *buf, size_t size, const char *prefix, size_t i,
+                     size_t len) {
+    size_t n = (size_t)snprintf(buf, size, "%s%zu", prefix, i);
+
+    while (n < len && n + 1 < size) {
+        buf[n++] = '-';
+    }
+    buf[n] = '\0';
+}
+
+/**
+ * check_strstr:
+ *      Fill, change and empty a string->string table, with pairs moving into
+ * and out of their slots as values change length.
+ */
+static bool check_strstr(unsigned int flags) {
+    ht_strstr_t *ht = ht_strstr_create(flags | HT_STR_INLINE);
+    ht_enum_t *he = NULL;
+    const char *a = NULL, *b = NULL;
+    char key[64], val[64];
+    size_t count = 0;
+    bool ok = ht != NULL;
+
+    for (size_t i = 0; ok && i < ENTRIES; i++) {
+        make_str(key, sizeof(key), "k", i, i % MAX_KEY + 1);
+        make_str(val, sizeof(val), "v", i, i * 7 % 30);
+        ok = ht_strstr_insert(ht, key, val);
+    }
+
+    // Odd keys get values of another length, even keys are removed
+    for (size_t i = 0; ok && i < ENTRIES; i++) {
+        make_str(key, sizeof(key), "k", i, i % MAX_KEY + 1);
+        if (i % 2) {
+            make_str(val, sizeof(val), "w", i, 30 - i * 7 % 30);
+            ok = ht_strstr_insert(ht, key, val);
+        } else {
+            ht_strstr_remove(ht, key);
+        }
+    }
+
+    for (size_t i = 0; ok && i < ENTRIES; i++) {
+        make_str(key, sizeof(key), "k", i, i % MAX_KEY + 1);
+        make_str(val, sizeof(val), "w", i, 30 - i * 7 % 30);
+        b = ht_strstr_get(ht, key);
+        ok = i % 2 ? b && strcmp(b, val) == 0 : !b;
+    }
+
+    he = ht_strstr_enum_create(ht);
+    while (ok && ht_strstr_enum_next(he, &a, &b)) {
+        ok = str_pack_len(a) == strlen(a) && a[0] == 'k' && b[0] == 'w';
+        count++;
+    }
+    ht_strstr_enum_destroy(he);
+
+    ok = ok && count == ENTRIES / 2;
+
+    // A NULL value and the longest keys the slots hold and don't
+    ok = ok && ht_strstr_insert(ht, "key", NULL) && !ht_strstr_get(ht, "key");
+    ok = ok && ht_strstr_insert(ht, "twenty-seven bytes long key", "x") &&
+         ht_strstr_insert(ht, "twenty-eight bytes long key!", "y") &&
+         strcmp(ht_strstr_get(ht, "twenty-seven bytes long key"), "x") == 0 &&
+         strcmp(ht_strstr_get(ht, "twenty-eight bytes long key!"), "y") == 0;
+
+    printf("strstr flags=%u: %zu entries %s\n", flags, count,
+           ok ? "ok" : "failed");
+
+    ht_strstr_destroy(ht);
+
+    return ok;
+}
+
+/**
+ * check_strint:
+ *      Count keys of every length in a string->int table with both keys and
+ * values stored in it's slots.
+ */
+static bool check_strint(unsigned int flags) {
+    ht_strint_t *ht = ht_strint_create(flags | HT_STR_INLINE);
+    char key[64];
+    int val = 0;
+    bool ok = ht != NULL;
+
+    for (size_t round = 0; ok && round < 3; round++) {
+        for (size_t i = 0; i < ENTRIES; i++) {
+            make_str(key, sizeof(key), "k", i, i % MAX_KEY + 1);
+            ht_strint_add(ht, key, (int)i);
+        }
+    }
+
+    for (size_t i = 0; ok && i < ENTRIES; i += 3) {
+        make_str(key, sizeof(key), "k", i, i % MAX_KEY + 1);
+        ht_strint_remove(ht, key);
+    }
+
+    for (size_t i = 0; ok && i < ENTRIES; i++) {
+        make_str(key, sizeof(key), "k", i, i % MAX_KEY + 1);
+        ok = i % 3 ? ht_strint_get_val(ht, key, &val) && val == (int)i * 3
+                   : !ht_strint_get(ht, key);
+    }
+
+    printf("strint flags=%u %s\n", flags, ok ? "ok" : "failed");
+
+    ht_strint_destroy(ht);
+
+    return ok;
+}
+
+/**
+ * check_refused:
+ *      Tables that can't keep keys in their slots say so.
+ */
+static bool check_refused(void) {
+    ht_t *chained = ht_create_n(fnv1a_hash_str_n, str_eq_n, NULL, 0);
+    ht_t *plain = ht_create(fnv1a_hash_str, str_eq, NULL, HT_ENGINE_SWISS);
+    ht_t *full = ht_create_n(fnv1a_hash_str_n, str_eq_n, NULL,
+                             HT_ENGINE_ROBINHOOD);
+    ht_t *arena = ht_create_n(fnv1a_hash_str_n, str_eq_n, NULL,
+                              HT_ENGINE_SWISS);
+    bool ok = chained && plain && full && arena;
+
+    ok = ok && !ht_set_inline_keys(chained) && !ht_set_inline_keys(plain);
+    ok = ok && ht_insert(full, "key", NULL) && !ht_set_inline_keys(full);
+    ok = ok && ht_set_str_arena(arena, false) && !ht_set_inline_keys(arena);
+
+    printf("refused %s\n", ok ? "ok" : "failed");
+
+    ht_destroy(chained);
+    ht_destroy(plain);
+    ht_destroy(full);
+    ht_destroy(arena);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int flags[] = {HT_STR_NONE, HT_STR_CASECMP,
+                                  HT_ENGINE_ROBINHOOD, HT_STR_ARENA};
+    bool ok = check_refused();
+
+    for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+        ok = check_strstr(flags[f]) && ok;
+        ok = check_strint(flags[f]) && ok;
+    }
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -32,8 +32,19 @@ int main(int argc, char **argv) {
     b = ht_strint_get(ht, "Abc");
     printf("%d: %p, %p\n", *((int *)b), a, b);
 
+    int v = 0;
+    if (!ht_strint_get_val(ht, "ABC", &v) || v != 456) {
+        ht_strint_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
     ht_strint_remove(ht, "abC");
 
+    if (ht_strint_get_val(ht, "abc", &v)) {
+        ht_strint_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
     const size_t len = 20;
     char a_key[64] = {'\0'};
     int a_val = 0;
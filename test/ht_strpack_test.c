@@ -0,0 +1,67 @@
+/* ht_strpack_test.c - Test program for packed string keys.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+    ht_strstr_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const char *a = NULL;
+    const char *b = NULL;
+    const size_t len = 100;
+    char t1[64] = {'\0'};
+    char t2[64] = {'\0'};
+
+    ht = ht_strstr_create(HT_STR_PACKED | HT_STR_CASECMP);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+    ht_strstr_insert(ht, "Content-Type", "text/plain");
+    ht_strstr_insert(ht, "content-type", "text/html");
+    ht_strstr_insert(ht, "Content-Length", NULL);
+
+    b = ht_strstr_get(ht, "CONTENT-TYPE");
+    if (!b || strcmp(b, "text/html") != 0 ||
+        ht_strstr_get(ht, "Content-Length")) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    ht_strstr_remove(ht, "Content-Length");
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", (i * 100) + i + (i / 2));
+        ht_strstr_insert(ht, t1, t2);
+    }
+
+    he = ht_strstr_enum_create(ht);
+    if (!he) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    while (ht_strstr_enum_next(he, &a, &b)) {
+        printf("key=%s, len=%zu, val=%s\n", a, str_pack_len(a), b);
+        if (str_pack_len(a) != strlen(a)) {
+            ht_strstr_enum_destroy(he);
+            ht_strstr_destroy(ht);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ht_strstr_enum_destroy(he);
+    ht_strstr_destroy(ht);
+
+    return 0;
+}
@@ -52,7 +52,15 @@ int main(int argc, char **argv) {
     }
 
     ht_strstr_enum_destroy(he);
+
+    // An enumeration object outliving the table ends it's enumeration
+    he = ht_strstr_enum_create(ht);
     ht_strstr_destroy(ht);
+    if (!he || ht_strstr_enum_next(he, &a, &b)) {
+        ht_strstr_enum_destroy(he);
+        exit(EXIT_FAILURE);
+    }
+    ht_strstr_enum_destroy(he);
 
     return 0;
 }
@@ -0,0 +1,98 @@
+/* ht_swiss_test.c - Test program for the swiss table storage engine.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+    ht_strstr_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const char *a = NULL;
+    const char *b = NULL;
+    const size_t len = 1000;
+    size_t count = 0;
+    char t1[64] = {'\0'};
+    char t2[64] = {'\0'};
+
+    ht = ht_strstr_create(HT_ENGINE_SWISS);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+#if defined(CPU_64_BIT)
+
+    // Create a collision - 64 bit hash (0x4EAC0C95540867E4)
+    ht_strstr_insert(ht, "8yn0iYCKYHlIj4-BwPqk", "apple");
+    ht_strstr_insert(ht, "GReLUrM4wMqfg9yzV3KQ", "orange");
+
+    ht_strstr_remove(ht, "8yn0iYCKYHlIj4-BwPqk");
+
+    if (ht_strstr_get(ht, "8yn0iYCKYHlIj4-BwPqk") ||
+        strcmp(ht_strstr_get(ht, "GReLUrM4wMqfg9yzV3KQ"), "orange") != 0) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    ht_strstr_remove(ht, "GReLUrM4wMqfg9yzV3KQ");
+
+#endif
+
+    // Grow the table through several resizes
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", (i * 100) + i + (i / 2));
+        ht_strstr_insert(ht, t1, t2);
+    }
+
+    // Leave tombstones behind
+    for (size_t i = 0; i < len; i += 2) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        ht_strstr_remove(ht, t1);
+    }
+
+    // Replace values of the remaining keys
+    for (size_t i = 1; i < len; i += 2) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", i);
+        ht_strstr_insert(ht, t1, t2);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", i);
+        b = ht_strstr_get(ht, t1);
+        if ((i % 2 == 0 && b) || (i % 2 && (!b || strcmp(b, t2) != 0))) {
+            printf("unexpected value for key=%s\n", t1);
+            ht_strstr_destroy(ht);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    he = ht_strstr_enum_create(ht);
+    if (!he) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    while (ht_strstr_enum_next(he, &a, &b)) {
+        printf("key=%s, val=%s\n", a, b);
+        count++;
+    }
+
+    ht_strstr_enum_destroy(he);
+    ht_strstr_destroy(ht);
+
+    if (count != len / 2) {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
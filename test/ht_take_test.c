@@ -0,0 +1,181 @@
+/* ht_take_test.c - Test program for handing entries to tables and back.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (20000)
+
+static long copies; // Strings copied by a table's callbacks
+static long live;   // Strings allocated and not yet freed
+
+/**
+ * clustered_hash:
+ *      Hash keys onto every 64th bucket only, so chains grow long enough to
+ * be indexed.
+ */
+static uint64_t clustered_hash(const void *key, uint64_t seed) {
+    return fnv1a_hash_str(key, seed) << 6;
+}
+
+/**
+ * new_str:
+ *      Allocate a formatted string, counting it.
+ */
+static char *new_str(const char *fmt, size_t n) {
+    char *s = malloc(32);
+
+    if (s) {
+        snprintf(s, 32, fmt, n);
+        live++;
+    }
+
+    return s;
+}
+
+/**
+ * copy_str:
+ *      Copy a string, counting it.
+ */
+static void *copy_str(const void *s) {
+    copies++;
+    live++;
+    return strdup(s);
+}
+
+/**
+ * free_str:
+ *      Free a string, counting it.
+ */
+static void free_str(const void *s) {
+    live--;
+    free((void *)s);
+}
+
+/**
+ * check_table:
+ *      Hand keys and values to a table, replace some, then take them all back
+ * in turn by ht_take, ht_remove_take and ht_remove, checking no string is
+ * copied and every one is freed exactly once.
+ */
+static bool check_table(ht_hash hfunc, unsigned int flags) {
+    ht_callbacks_t callbacks = {copy_str, free_str, copy_str, free_str, NULL};
+    ht_t *ht = ht_create(hfunc, str_eq, &callbacks, flags);
+    char key[32], *val = NULL;
+    void *taken_key = NULL, *taken_val = NULL;
+    bool ok = ht != NULL;
+
+    copies = live = 0;
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        ok = ht_insert_take(ht, new_str("key%zu", i), new_str("val%zu", i));
+    }
+
+    // Replacing frees the old value and the key handed in again
+    for (size_t i = 0; ok && i < KEYS; i += 3) {
+        ok = ht_insert_take(ht, new_str("key%zu", i), new_str("new%zu", i));
+    }
+
+    ok = ok && live == KEYS * 2;
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        val = ht_get(ht, key);
+        ok = val && atoi(val + 3) == (int)i &&
+             strncmp(val, i % 3 ? "val" : "new", 3) == 0;
+    }
+
+    for (size_t i = 0; ok && i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+
+        switch (i % 3) {
+        case 0:
+            val = ht_take(ht, key);
+            ok = val && strncmp(val, "new", 3) == 0 && !ht_get(ht, key) &&
+                 !ht_take(ht, key);
+            free_str(val);
+            break;
+        case 1:
+            ok = ht_remove_take(ht, key, &taken_key, &taken_val) &&
+                 strcmp(taken_key, key) == 0 &&
+                 atoi((char *)taken_val + 3) == (int)i && !ht_get(ht, key) &&
+                 !ht_remove_take(ht, key, &taken_key, &taken_val);
+            free_str(taken_key);
+            free_str(taken_val);
+            break;
+        default:
+            ht_remove(ht, key);
+            ok = !ht_get(ht, key);
+            break;
+        }
+    }
+
+    ok = ok && copies == 0 && live == 0;
+
+    // Copies and adopted entries live side by side
+    ht_insert(ht, "copied", "1");
+    ok = ok && ht_insert_take(ht, new_str("taken%zu", 0), new_str("%zu", 2));
+    ht_destroy(ht);
+
+    ok = ok && copies == 2 && live == 0;
+
+    printf("flags %u: %d keys handed over and taken back %s\n", flags, KEYS,
+           ok ? "ok" : "failed");
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_strstr_t *strstr = NULL;
+    ht_strint_t *strint = NULL;
+    void *taken_key = NULL, *taken_val = NULL;
+    char *val = NULL;
+    int n = 0;
+    bool ok = true;
+
+    ok = check_table(fnv1a_hash_str, HT_STR_NONE) &&
+         check_table(fnv1a_hash_str, HT_REHASH_INCREMENTAL) &&
+         check_table(clustered_hash, HT_STR_NONE) &&
+         check_table(fnv1a_hash_str, HT_ENGINE_SWISS) &&
+         check_table(fnv1a_hash_str, HT_ENGINE_ROBINHOOD);
+
+    strstr = ht_strstr_create(HT_STR_NONE);
+    ok = ok && ht_strstr_insert_take(strstr, strdup("one"), strdup("1")) &&
+         strcmp(ht_strstr_get(strstr, "one"), "1") == 0;
+    val = ht_strstr_take(strstr, "one");
+    ok = ok && val && strcmp(val, "1") == 0 && !ht_strstr_get(strstr, "one");
+    free(val);
+    ht_strstr_destroy(strstr);
+
+    // Packed tables allocate their entries themselves
+    strstr = ht_strstr_create(HT_STR_PACKED);
+    ht_strstr_insert(strstr, "one", "1");
+    ok = ok && !ht_strstr_insert_take(strstr, "two", "2") &&
+         !ht_strstr_take(strstr, "one") && ht_strstr_get(strstr, "one");
+    ht_strstr_destroy(strstr);
+
+    // Inline values are copied in and handed back in the pointer's bytes
+    strint = ht_strint_create(HT_STR_NONE);
+    n = 42;
+    ok = ok && ht_insert_take((ht_t *)strint, strdup("answer"), &n) &&
+         *(int *)ht_strint_get(strint, "answer") == 42 &&
+         ht_remove_take((ht_t *)strint, "answer", &taken_key, &taken_val) &&
+         strcmp(taken_key, "answer") == 0 && !ht_strint_get(strint, "answer");
+    memcpy(&n, &taken_val, sizeof(n));
+    ok = ok && n == 42;
+    free(taken_key);
+    ht_strint_destroy(strint);
+
+    printf("typed tables handed entries and taken back %s\n",
+           ok ? "ok" : "failed");
+
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,167 @@
+/* ht_wyhash_collision_test.c - Test program for the word at a time hashes.
+ *
+ * Project: libhashtable
+ * URL: https://github.com/berrym/libhashtable
+ * License: MIT
+ * Copyright (c) Michael Berry <trismegustis@gmail.com> 2024
+ */
+
+#include "ht.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS (100000)
+#define LONG_KEY (1100)
+
+/**
+ * cmp_hash:
+ *      qsort comparison of two hash values.
+ */
+static int cmp_hash(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * count_collisions:
+ *      Hash KEYS short keys and keys of every length up to LONG_KEY, which
+ * differ only in their last byte, and count equal hashes.
+ */
+static size_t count_collisions(void) {
+    uint64_t *hashes = calloc(KEYS + LONG_KEY, sizeof(*hashes));
+    char *key = calloc(LONG_KEY + 1, 1);
+    size_t n = 0, collisions = 0;
+
+    if (!hashes || !key) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < KEYS; i++) {
+        snprintf(key, LONG_KEY, "key%zu", i);
+        hashes[n++] = wy_hash_str(key, FNV1A_OFFSET);
+    }
+
+    // Long keys go through the striped kernel
+    memset(key, 'x', LONG_KEY);
+    for (size_t len = 1; len <= LONG_KEY; len++) {
+        key[len - 1] = 'y';
+        hashes[n++] = wy_hash_str_n(key, len, FNV1A_OFFSET);
+        key[len - 1] = 'x';
+    }
+
+    qsort(hashes, n, sizeof(*hashes), cmp_hash);
+    for (size_t i = 1; i < n; i++) {
+        if (hashes[i] == hashes[i - 1]) {
+            collisions++;
+        }
+    }
+
+    free(hashes);
+    free(key);
+
+    return collisions;
+}
+
+/**
+ * check_variants:
+ *      Terminated and length delimited keys hash alike, and case insensitive
+ * hashes equal the hash of the lower case key, at every length.
+ */
+static bool check_variants(void) {
+    char *key = calloc(LONG_KEY + 1, 1);
+    char *lower = calloc(LONG_KEY + 1, 1);
+    bool ok = true;
+
+    if (!key || !lower) {
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t len = 0; len <= LONG_KEY && ok; len++) {
+        for (size_t i = 0; i < len; i++) {
+            key[i] = "Content-Type: Text/HTML; charset=UTF-8"[(i * 7) % 38];
+            lower[i] = (char)tolower((unsigned char)key[i]);
+        }
+        key[len] = lower[len] = '\0';
+
+        ok = wy_hash_str(key, 42) == wy_hash_str_n(key, len, 42) &&
+             wy_hash_str_casecmp(key, 42) == wy_hash_str(lower, 42) &&
+             wy_hash_str_casecmp_n(key, len, 42) == wy_hash_str(lower, 42) &&
+             (len == 0 || wy_hash_str(key, 42) != wy_hash_str(key, 43));
+        if (!ok) {
+            printf("hash variants differ at length %zu\n", len);
+        }
+    }
+
+    free(key);
+    free(lower);
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    ht_strstr_t *ht = NULL;
+    ht_enum_t *he = NULL;
+    const char *a = NULL;
+    const char *b = NULL;
+    const size_t len = 20;
+    size_t collisions = 0;
+    char t1[64] = {'\0'};
+    char t2[64] = {'\0'};
+
+    if (!check_variants()) {
+        exit(EXIT_FAILURE);
+    }
+
+    collisions = count_collisions();
+    printf("%zu hash collisions among %d keys\n", collisions,
+           KEYS + LONG_KEY);
+
+#if defined(CPU_64_BIT)
+    if (collisions) {
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    ht = ht_strstr_create(HT_HASH_WYHASH | HT_SEED_RANDOM | HT_STR_CASECMP);
+    if (!ht) {
+        exit(EXIT_FAILURE);
+    }
+
+    ht_strstr_insert(ht, "Content-Type", "apple");
+    ht_strstr_insert(ht, "content-type", "orange");
+    ht_strstr_remove(ht, "CONTENT-TYPE");
+    if (ht_strstr_get(ht, "Content-Type")) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        snprintf(t1, sizeof(t1), "a%zu", i);
+        snprintf(t2, sizeof(t2), "%zu", (i * 100) + i + (i / 2));
+        ht_strstr_insert(ht, t1, t2);
+    }
+
+    he = ht_strstr_enum_create(ht);
+    if (!he) {
+        ht_strstr_destroy(ht);
+        exit(EXIT_FAILURE);
+    }
+
+    while (ht_strstr_enum_next(he, &a, &b)) {
+        printf("key=%s, val=%s\n", a, b);
+        if (strcmp(ht_strstr_get(ht, a), b) != 0) {
+            ht_strstr_enum_destroy(he);
+            ht_strstr_destroy(ht);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ht_strstr_enum_destroy(he);
+    ht_strstr_destroy(ht);
+
+    return 0;
+}